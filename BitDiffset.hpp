@@ -0,0 +1,620 @@
+#ifndef BITDIFFSET_HPP
+#define BITDIFFSET_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define BITDIFFSET_X86 1
+#endif
+
+#include "CpuFeatures.hpp"
+#include "Diffset.hpp"
+
+/*!
+ * \brief The BitKernels struct
+ * Word kernels of BitDiffset. The best variant for the running CPU is
+ * picked once, on first use.
+ */
+struct BitKernels
+{
+    typedef std::uint64_t word_type;
+
+    /*!
+     * \brief andnot_function writes minuend & ~subtrahend to result and returns its popcount
+     */
+    typedef std::size_t ( * andnot_function )( const word_type * minuend, const word_type * subtrahend, word_type * result, std::size_t n_words );
+
+    /*!
+     * \brief andnot_count_function popcount of minuend & ~subtrahend
+     */
+    typedef std::size_t ( * andnot_count_function )( const word_type * minuend, const word_type * subtrahend, std::size_t n_words );
+
+    /*!
+     * \brief tid_sum_function sum of the positions of the set bits
+     */
+    typedef std::uint64_t ( * tid_sum_function )( const word_type * words, std::size_t n_words );
+
+    andnot_function andnot;
+    andnot_count_function andnot_count;
+    tid_sum_function tid_sum;
+    const char * name;
+
+    /*!
+     * \brief get
+     * \return
+     */
+    static const BitKernels & get()
+    {
+        static const BitKernels kernels = select();
+        return kernels;
+    }
+
+private:
+    /*!
+     * \brief position_masks bit k of a position is set for the bits in position_masks[ k ]
+     */
+    static const word_type * position_masks()
+    {
+        static const word_type masks[ 6 ] = {
+            0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+            0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+        };
+        return masks;
+    }
+
+    template < bool store >
+    /*!
+     * \brief andnot_scalar
+     * \param minuend
+     * \param subtrahend
+     * \param result
+     * \param n_words
+     * \return
+     */
+    static std::size_t andnot_scalar( const word_type * minuend, const word_type * subtrahend, word_type * result, std::size_t n_words )
+    {
+        std::size_t count = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            const word_type word = minuend[ index ] & ~subtrahend[ index ];
+            if ( store ) {
+                result[ index ] = word;
+            }
+            count += __builtin_popcountll( word );
+        }
+        return count;
+    }
+
+    /*!
+     * \brief tid_sum_scalar
+     * \param words
+     * \param n_words
+     * \return
+     */
+    static std::uint64_t tid_sum_scalar( const word_type * words, std::size_t n_words )
+    {
+        const word_type * masks = position_masks();
+        std::uint64_t sum = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            const word_type word = words[ index ];
+            if ( word ) {
+                sum += std::uint64_t( index ) * 64 * __builtin_popcountll( word );
+                for ( unsigned int bit = 0; bit < 6; ++ bit ) {
+                    sum += std::uint64_t( __builtin_popcountll( word & masks[ bit ] ) ) << bit;
+                }
+            }
+        }
+        return sum;
+    }
+
+#ifdef BITDIFFSET_X86
+    template < bool store >
+    /*!
+     * \brief andnot_popcnt
+     * \param minuend
+     * \param subtrahend
+     * \param result
+     * \param n_words
+     * \return
+     */
+    __attribute__(( target( "popcnt" ) ))
+    static std::size_t andnot_popcnt( const word_type * minuend, const word_type * subtrahend, word_type * result, std::size_t n_words )
+    {
+        std::size_t count = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            const word_type word = minuend[ index ] & ~subtrahend[ index ];
+            if ( store ) {
+                result[ index ] = word;
+            }
+            count += _mm_popcnt_u64( word );
+        }
+        return count;
+    }
+
+    /*!
+     * \brief tid_sum_popcnt
+     * \param words
+     * \param n_words
+     * \return
+     */
+    __attribute__(( target( "popcnt" ) ))
+    static std::uint64_t tid_sum_popcnt( const word_type * words, std::size_t n_words )
+    {
+        const word_type * masks = position_masks();
+        std::uint64_t sum = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            const word_type word = words[ index ];
+            if ( word ) {
+                sum += std::uint64_t( index ) * 64 * _mm_popcnt_u64( word );
+                for ( unsigned int bit = 0; bit < 6; ++ bit ) {
+                    sum += std::uint64_t( _mm_popcnt_u64( word & masks[ bit ] ) ) << bit;
+                }
+            }
+        }
+        return sum;
+    }
+
+    template < bool store >
+    /*!
+     * \brief andnot_avx2 popcount by nibble lookup (Mula)
+     * \param minuend
+     * \param subtrahend
+     * \param result
+     * \param n_words
+     * \return
+     */
+    __attribute__(( target( "avx2,popcnt" ) ))
+    static std::size_t andnot_avx2( const word_type * minuend, const word_type * subtrahend, word_type * result, std::size_t n_words )
+    {
+        const __m256i lookup = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+        const __m256i low_mask = _mm256_set1_epi8( 0x0f );
+        __m256i total = _mm256_setzero_si256();
+        std::size_t index = 0;
+        for ( ; index + 4 <= n_words; index += 4 ) {
+            const __m256i l = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( minuend + index ) );
+            const __m256i r = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( subtrahend + index ) );
+            const __m256i word = _mm256_andnot_si256( r, l );
+            if ( store ) {
+                _mm256_storeu_si256( reinterpret_cast< __m256i * >( result + index ), word );
+            }
+            const __m256i low = _mm256_and_si256( word, low_mask );
+            const __m256i high = _mm256_and_si256( _mm256_srli_epi16( word, 4 ), low_mask );
+            const __m256i bytes = _mm256_add_epi8( _mm256_shuffle_epi8( lookup, low ), _mm256_shuffle_epi8( lookup, high ) );
+            total = _mm256_add_epi64( total, _mm256_sad_epu8( bytes, _mm256_setzero_si256() ) );
+        }
+        std::size_t count = _mm256_extract_epi64( total, 0 ) + _mm256_extract_epi64( total, 1 )
+                + _mm256_extract_epi64( total, 2 ) + _mm256_extract_epi64( total, 3 );
+        for ( ; index < n_words; ++ index ) {
+            const word_type word = minuend[ index ] & ~subtrahend[ index ];
+            if ( store ) {
+                result[ index ] = word;
+            }
+            count += _mm_popcnt_u64( word );
+        }
+        return count;
+    }
+
+    /*!
+     * \brief all_lanes
+     * The AVX-512 kernels use the zero-masked forms of the intrinsics, with
+     * every lane, where the plain forms start from an undefined register
+     * GCC 12 warns about.
+     */
+    static constexpr __mmask8 all_lanes = 0xff;
+
+    /*!
+     * \brief reduce_add_avx512
+     * \param total
+     * \return the sum of the lanes of total
+     */
+    __attribute__(( target( "avx512f" ) ))
+    static inline std::uint64_t reduce_add_avx512( const __m512i total )
+    {
+        const __m256i half = _mm256_add_epi64( _mm512_maskz_extracti64x4_epi64( 0xf, total, 0 ), _mm512_maskz_extracti64x4_epi64( 0xf, total, 1 ) );
+        const __m128i quarter = _mm_add_epi64( _mm256_castsi256_si128( half ), _mm256_extracti128_si256( half, 1 ) );
+        return std::uint64_t( _mm_cvtsi128_si64( quarter ) ) + std::uint64_t( _mm_extract_epi64( quarter, 1 ) );
+    }
+
+    template < bool store >
+    /*!
+     * \brief andnot_avx512
+     * \param minuend
+     * \param subtrahend
+     * \param result
+     * \param n_words
+     * \return
+     */
+    __attribute__(( target( "avx512f,avx512vpopcntdq" ) ))
+    static std::size_t andnot_avx512( const word_type * minuend, const word_type * subtrahend, word_type * result, std::size_t n_words )
+    {
+        __m512i total = _mm512_setzero_si512();
+        std::size_t index = 0;
+        for ( ; index + 8 <= n_words; index += 8 ) {
+            const __m512i word = _mm512_maskz_andnot_epi64( all_lanes, _mm512_loadu_si512( subtrahend + index ), _mm512_loadu_si512( minuend + index ) );
+            if ( store ) {
+                _mm512_storeu_si512( result + index, word );
+            }
+            total = _mm512_add_epi64( total, _mm512_popcnt_epi64( word ) );
+        }
+        if ( index < n_words ) {
+            const __mmask8 tail = __mmask8( ( 1u << ( n_words - index ) ) - 1 );
+            const __m512i word = _mm512_maskz_andnot_epi64( tail, _mm512_maskz_loadu_epi64( tail, subtrahend + index ),
+                                                            _mm512_maskz_loadu_epi64( tail, minuend + index ) );
+            if ( store ) {
+                _mm512_mask_storeu_epi64( result + index, tail, word );
+            }
+            total = _mm512_add_epi64( total, _mm512_popcnt_epi64( word ) );
+        }
+        return reduce_add_avx512( total );
+    }
+
+    /*!
+     * \brief tid_sum_avx512
+     * \param words
+     * \param n_words
+     * \return
+     */
+    __attribute__(( target( "avx512f,avx512vpopcntdq" ) ))
+    static std::uint64_t tid_sum_avx512( const word_type * words, std::size_t n_words )
+    {
+        const word_type * masks = position_masks();
+        __m512i total = _mm512_setzero_si512();
+        __m512i base = _mm512_setr_epi64( 0, 64, 128, 192, 256, 320, 384, 448 );
+        const __m512i step = _mm512_set1_epi64( 512 );
+        for ( std::size_t index = 0; index < n_words; index += 8 ) {
+            const __mmask8 lanes = ( n_words - index >= 8 ) ? __mmask8( 0xff ) : __mmask8( ( 1u << ( n_words - index ) ) - 1 );
+            const __m512i word = _mm512_maskz_loadu_epi64( lanes, words + index );
+            total = _mm512_add_epi64( total, _mm512_maskz_mul_epu32( all_lanes, _mm512_popcnt_epi64( word ), base ) );
+            for ( unsigned int bit = 0; bit < 6; ++ bit ) {
+                const __m512i masked = _mm512_and_si512( word, _mm512_set1_epi64( masks[ bit ] ) );
+                total = _mm512_add_epi64( total, _mm512_maskz_slli_epi64( all_lanes, _mm512_popcnt_epi64( masked ), bit ) );
+            }
+            base = _mm512_add_epi64( base, step );
+        }
+        return reduce_add_avx512( total );
+    }
+#endif
+
+    /*!
+     * \brief count_only
+     */
+    template < std::size_t ( * andnot_kernel )( const word_type *, const word_type *, word_type *, std::size_t ) >
+    static std::size_t count_only( const word_type * minuend, const word_type * subtrahend, std::size_t n_words )
+    {
+        return andnot_kernel( minuend, subtrahend, nullptr, n_words );
+    }
+
+    /*!
+     * \brief select
+     * \return
+     */
+    static BitKernels select()
+    {
+        BitKernels kernels;
+        kernels.andnot = &andnot_scalar< true >;
+        kernels.andnot_count = &count_only< &andnot_scalar< false > >;
+        kernels.tid_sum = &tid_sum_scalar;
+        kernels.name = "scalar";
+#ifdef BITDIFFSET_X86
+        const CpuFeatures & cpu = CpuFeatures::get();
+        if ( cpu.avx512f && cpu.avx512vpopcntdq ) {
+            kernels.andnot = &andnot_avx512< true >;
+            kernels.andnot_count = &count_only< &andnot_avx512< false > >;
+            kernels.tid_sum = &tid_sum_avx512;
+            kernels.name = "avx512";
+        }
+        else if ( cpu.avx2 && cpu.popcnt ) {
+            kernels.andnot = &andnot_avx2< true >;
+            kernels.andnot_count = &count_only< &andnot_avx2< false > >;
+            kernels.tid_sum = &tid_sum_popcnt;
+            kernels.name = "avx2";
+        }
+        else if ( cpu.popcnt ) {
+            kernels.andnot = &andnot_popcnt< true >;
+            kernels.andnot_count = &count_only< &andnot_popcnt< false > >;
+            kernels.tid_sum = &tid_sum_popcnt;
+            kernels.name = "popcnt";
+        }
+#endif
+        return kernels;
+    }
+};
+
+/*!
+ * \brief The BitDiffset class
+ * Diffset stored as a fixed-width bitset over the transaction space: bit tid
+ * is set when tid belongs to the diffset. Every diffset of one run has the
+ * same width, so a difference is a word-wise AND-NOT.
+ */
+class BitDiffset
+{
+public:
+    typedef BitKernels::word_type word_type;
+
+    /*!
+     * \brief The const_iterator class walks the set bits in increasing order
+     */
+    class const_iterator : public std::iterator< std::forward_iterator_tag, TID, std::ptrdiff_t, const TID *, TID >
+    {
+    public:
+        /*!
+         * \brief const_iterator
+         * \param words
+         * \param n_words
+         * \param index
+         */
+        const_iterator( const word_type * words, const std::size_t n_words, const std::size_t index ) :
+            _words( words ),
+            _n_words( n_words ),
+            _index( index ),
+            _word( index < n_words ? words[ index ] : 0 ) {
+            skip_empty();
+        }
+
+        /*!
+         * \brief operator *
+         * \return
+         */
+        inline TID operator * () const
+        {
+            return TID( _index * 64 + __builtin_ctzll( _word ) );
+        }
+
+        /*!
+         * \brief operator ++
+         * \return
+         */
+        inline const_iterator & operator ++ ()
+        {
+            _word &= _word - 1;
+            skip_empty();
+            return *this;
+        }
+
+        /*!
+         * \brief operator ++
+         * \return
+         */
+        inline const_iterator operator ++ ( int )
+        {
+            const_iterator copy( *this );
+            ++ ( *this );
+            return copy;
+        }
+
+        /*!
+         * \brief operator ==
+         * \param other
+         * \return
+         */
+        inline bool operator == ( const const_iterator & other ) const
+        {
+            return ( _index == other._index ) && ( _word == other._word );
+        }
+
+        /*!
+         * \brief operator !=
+         * \param other
+         * \return
+         */
+        inline bool operator != ( const const_iterator & other ) const
+        {
+            return ! ( *this == other );
+        }
+
+    private:
+        /*!
+         * \brief skip_empty
+         */
+        inline void skip_empty()
+        {
+            while ( ( 0 == _word ) && ( _index < _n_words ) ) {
+                if ( ++ _index < _n_words ) {
+                    _word = _words[ _index ];
+                }
+            }
+        }
+
+    private:
+        const word_type * _words;
+        std::size_t _n_words;
+        std::size_t _index;
+        word_type _word;
+    };
+
+    /*!
+     * \brief BitDiffset
+     */
+    BitDiffset() :
+        _size( 0 ) {}
+
+    template < typename tid_range >
+    /*!
+     * \brief BitDiffset
+     * \param diffset sorted tids, a Diffset or any range of TID
+     * \param transaction_counter largest tid
+     */
+    BitDiffset( const tid_range & diffset, const TID transaction_counter ) :
+        _words( transaction_counter / 64 + 1, 0 ),
+        _size( diffset.size() )
+    {
+        for ( const auto & tid : diffset ) {
+            _words[ tid / 64 ] |= word_type( 1 ) << ( tid % 64 );
+        }
+    }
+
+    /*!
+     * \brief difference
+     * \param minuend
+     * \param subtrahend
+     * \param result minuend \ subtrahend, its words are reused
+     */
+    static void difference( const BitDiffset & minuend, const BitDiffset & subtrahend, BitDiffset & result )
+    {
+        assert( minuend.n_words() == subtrahend.n_words() );
+        result._words.resize( minuend.n_words() );
+        result._size = BitKernels::get().andnot( minuend.words(), subtrahend.words(), result._words.data(), minuend.n_words() );
+    }
+
+    /*!
+     * \brief bounded_words words a bounded difference takes between two looks at its size
+     */
+    static constexpr std::size_t bounded_words = 256;
+
+    /*!
+     * \brief difference stops once the result holds more than limit tids
+     * \param minuend
+     * \param subtrahend
+     * \param result minuend \ subtrahend, or more than limit of its tids if it stopped early
+     * \param limit
+     */
+    static void difference( const BitDiffset & minuend, const BitDiffset & subtrahend, BitDiffset & result, const std::size_t limit )
+    {
+        assert( minuend.n_words() == subtrahend.n_words() );
+        const std::size_t n_words = minuend.n_words();
+        const BitKernels & kernels = BitKernels::get();
+        result._words.resize( n_words );
+        result._size = 0;
+        // std::min takes references, and bounded_words has no definition to bind them to
+        const std::size_t step = bounded_words;
+        for ( std::size_t first = 0; ( first < n_words ) && ( result._size <= limit ); first += step ) {
+            result._size += kernels.andnot( minuend.words() + first, subtrahend.words() + first, result._words.data() + first, std::min( step, n_words - first ) );
+        }
+    }
+
+    /*!
+     * \brief difference_size
+     * \param minuend
+     * \param subtrahend
+     * \return | minuend \ subtrahend |
+     */
+    static unsigned int difference_size( const BitDiffset & minuend, const BitDiffset & subtrahend )
+    {
+        assert( minuend.n_words() == subtrahend.n_words() );
+        return BitKernels::get().andnot_count( minuend.words(), subtrahend.words(), minuend.n_words() );
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline unsigned int size() const
+    {
+        return _size;
+    }
+
+    /*!
+     * \brief empty
+     * \return
+     */
+    inline bool empty() const
+    {
+        return 0 == _size;
+    }
+
+    /*!
+     * \brief contains
+     * \param tid
+     * \return
+     */
+    inline bool contains( const TID tid ) const
+    {
+        return ( std::size_t( tid / 64 ) < _words.size() ) && ( ( _words[ tid / 64 ] >> ( tid % 64 ) ) & 1 );
+    }
+
+    /*!
+     * \brief n_words
+     * \return
+     */
+    inline std::size_t n_words() const
+    {
+        return _words.size();
+    }
+
+    /*!
+     * \brief words
+     * \return
+     */
+    inline const word_type * words() const
+    {
+        return _words.data();
+    }
+
+    /*!
+     * \brief cbegin
+     * \return
+     */
+    inline const_iterator cbegin() const
+    {
+        return const_iterator( _words.data(), _words.size(), 0 );
+    }
+
+    /*!
+     * \brief cend
+     * \return
+     */
+    inline const_iterator cend() const
+    {
+        return const_iterator( _words.data(), _words.size(), _words.size() );
+    }
+
+    /*!
+     * \brief begin
+     * \return
+     */
+    inline const_iterator begin() const
+    {
+        return cbegin();
+    }
+
+    /*!
+     * \brief end
+     * \return
+     */
+    inline const_iterator end() const
+    {
+        return cend();
+    }
+
+    /*!
+     * \brief operator ==
+     * \param other
+     * \return
+     */
+    inline bool operator == ( const BitDiffset & other ) const
+    {
+        return ( _size == other._size ) && ( _words == other._words );
+    }
+
+private:
+    std::vector < word_type > _words;
+    unsigned int _size;
+};
+
+/*!
+ * \brief tid_sum
+ * \param diffset
+ * \return sum of the tids, wrapped like the sum of a Diffset
+ */
+inline int tid_sum( const BitDiffset & diffset )
+{
+    return int( std::uint32_t( BitKernels::get().tid_sum( diffset.words(), diffset.n_words() ) ) );
+}
+
+/*!
+ * \brief count_mistakes
+ * \param diffset
+ * \param other
+ * \return number of tids of other missing in diffset
+ */
+inline unsigned int count_mistakes( const BitDiffset & diffset, const BitDiffset & other )
+{
+    return BitDiffset::difference_size( other, diffset );
+}
+
+#endif // BITDIFFSET_HPP
@@ -0,0 +1,302 @@
+#ifndef BUFFEREDWRITER_HPP
+#define BUFFEREDWRITER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*!
+ * \brief The WriteMode enum
+ */
+enum class WriteMode
+{
+    Buffered,
+    Direct,
+    Mmap
+};
+
+/*!
+ * \brief The BufferedWriter class
+ * Appends bytes to a file through one large page-aligned buffer. Buffered
+ * mode hands full buffers to write(2); Direct opens the file with O_DIRECT
+ * (falling back to Buffered where the file system refuses it) so the result
+ * does not go through the page cache; Mmap grows the file and copies into a
+ * shared mapping of its tail.
+ */
+class BufferedWriter
+{
+public:
+    /*!
+     * \brief alignment of the buffer, the writes and the mapped windows
+     */
+    static constexpr std::size_t alignment = 4096;
+
+    /*!
+     * \brief buffer_size
+     */
+    static constexpr std::size_t buffer_size = 1 << 20;
+
+    /*!
+     * \brief window_size bytes mapped at a time in Mmap mode
+     */
+    static constexpr std::size_t window_size = 64 << 20;
+
+    /*!
+     * \brief BufferedWriter
+     * \param filename
+     * \param mode
+     */
+    BufferedWriter( const std::string & filename, const WriteMode mode = WriteMode::Buffered ) :
+        _mode( mode ),
+        _fd( -1 ),
+        _buffer( nullptr ),
+        _capacity( 0 ),
+        _used( 0 ),
+        _written( 0 ),
+        _window_offset( 0 ),
+        _owns_fd( true )
+    {
+        const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+        if ( WriteMode::Direct == _mode ) {
+            _fd = ::open( filename.c_str(), flags | O_DIRECT, 0644 );
+            if ( -1 == _fd ) {
+                _mode = WriteMode::Buffered;
+            }
+        }
+        if ( WriteMode::Mmap == _mode ) {
+            _fd = ::open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        }
+        else if ( -1 == _fd ) {
+            _fd = ::open( filename.c_str(), flags, 0644 );
+        }
+        if ( -1 == _fd ) {
+            throw std::runtime_error( "Cannot open file: " + filename );
+        }
+        if ( WriteMode::Mmap == _mode ) {
+            try {
+                map_window();
+            }
+            catch ( ... ) {
+                ::close( _fd );
+                throw;
+            }
+        }
+        else {
+            void * buffer = nullptr;
+            if ( ::posix_memalign( &buffer, alignment, buffer_size ) ) {
+                ::close( _fd );
+                throw std::bad_alloc();
+            }
+            _buffer = static_cast< char * >( buffer );
+            _capacity = buffer_size;
+        }
+    }
+
+    /*!
+     * \brief BufferedWriter writes in Buffered mode to a descriptor it does not own, a pipe or a socket
+     * \param fd left open by close
+     */
+    explicit BufferedWriter( const int fd ) :
+        _mode( WriteMode::Buffered ),
+        _fd( fd ),
+        _buffer( nullptr ),
+        _capacity( 0 ),
+        _used( 0 ),
+        _written( 0 ),
+        _window_offset( 0 ),
+        _owns_fd( false )
+    {
+        void * buffer = nullptr;
+        if ( ::posix_memalign( &buffer, alignment, buffer_size ) ) {
+            throw std::bad_alloc();
+        }
+        _buffer = static_cast< char * >( buffer );
+        _capacity = buffer_size;
+    }
+
+    BufferedWriter( const BufferedWriter & ) = delete;
+    BufferedWriter & operator = ( const BufferedWriter & ) = delete;
+
+    /*!
+     * \brief ~BufferedWriter
+     */
+    ~BufferedWriter()
+    {
+        try {
+            close();
+        }
+        catch ( const std::exception & ) {
+        }
+    }
+
+    /*!
+     * \brief write
+     * \param data
+     * \param size
+     */
+    inline void write( const char * data, std::size_t size )
+    {
+        while ( size ) {
+            if ( _used == _capacity ) {
+                drain();
+            }
+            const std::size_t chunk = std::min( size, _capacity - _used );
+            std::memcpy( _buffer + _used, data, chunk );
+            _used += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    /*!
+     * \brief reserve
+     * \param size at most alignment
+     * \return room for size bytes, to be committed with commit
+     */
+    inline char * reserve( const std::size_t size )
+    {
+        if ( _capacity - _used < size ) {
+            drain();
+        }
+        return _buffer + _used;
+    }
+
+    /*!
+     * \brief commit
+     * \param size bytes of the last reserve actually used
+     */
+    inline void commit( const std::size_t size )
+    {
+        _used += size;
+    }
+
+    /*!
+     * \brief size
+     * \return bytes written so far
+     */
+    inline std::size_t size() const
+    {
+        return _written + _used;
+    }
+
+    /*!
+     * \brief close writes what is left and truncates the file to its size
+     * \param sync waits until the file is on the device
+     */
+    inline void close( const bool sync = false )
+    {
+        if ( -1 == _fd ) {
+            return;
+        }
+        const int fd = _fd;
+        if ( WriteMode::Mmap == _mode ) {
+            _written += _used;
+            _used = 0;
+            ::munmap( _buffer, _capacity );
+            _buffer = nullptr;
+        }
+        else {
+            if ( WriteMode::Direct == _mode ) {
+                // The tail is not a whole number of blocks
+                ::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) & ~O_DIRECT );
+            }
+            write_all( _buffer, _used );
+            std::free( _buffer );
+            _buffer = nullptr;
+        }
+        _fd = -1;
+        if ( ! _owns_fd ) {
+            return;
+        }
+        const bool truncated = ( 0 == ::ftruncate( fd, _written ) );
+        const bool synced = ! sync || ( 0 == ::fsync( fd ) );
+        if ( ( 0 != ::close( fd ) ) || ! truncated || ! synced ) {
+            throw std::runtime_error( std::string( "Cannot write result: " ) + std::strerror( errno ) );
+        }
+    }
+
+private:
+    /*!
+     * \brief drain empties the buffer, or moves the mapping past it
+     */
+    inline void drain()
+    {
+        if ( WriteMode::Mmap == _mode ) {
+            ::munmap( _buffer, _capacity );
+            _buffer = nullptr;
+            _window_offset += _capacity;
+            _written += _used;
+            map_window();
+            return;
+        }
+        if ( WriteMode::Direct == _mode ) {
+            // O_DIRECT only takes whole blocks, the rest stays in the buffer
+            const std::size_t aligned = _used - _used % alignment;
+            write_all( _buffer, aligned );
+            std::memmove( _buffer, _buffer + aligned, _used - aligned );
+            _used -= aligned;
+            return;
+        }
+        write_all( _buffer, _used );
+        _used = 0;
+    }
+
+    /*!
+     * \brief write_all
+     * \param data
+     * \param size
+     */
+    inline void write_all( const char * data, std::size_t size )
+    {
+        while ( size ) {
+            const ssize_t written = ::write( _fd, data, size );
+            if ( written < 0 ) {
+                if ( EINTR == errno ) {
+                    continue;
+                }
+                throw std::runtime_error( std::string( "Cannot write result: " ) + std::strerror( errno ) );
+            }
+            data += written;
+            size -= written;
+            _written += written;
+        }
+    }
+
+    /*!
+     * \brief map_window grows the file and maps the window starting at _window_offset
+     */
+    inline void map_window()
+    {
+        if ( 0 != ::ftruncate( _fd, _window_offset + window_size ) ) {
+            throw std::runtime_error( std::string( "Cannot write result: " ) + std::strerror( errno ) );
+        }
+        void * window = ::mmap( nullptr, window_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, _window_offset );
+        if ( MAP_FAILED == window ) {
+            throw std::runtime_error( std::string( "Cannot map result: " ) + std::strerror( errno ) );
+        }
+        _buffer = static_cast< char * >( window );
+        _capacity = window_size;
+        _used = 0;
+    }
+
+private:
+    WriteMode _mode;
+    int _fd;
+    char * _buffer;
+    std::size_t _capacity;
+    std::size_t _used;
+    std::size_t _written;
+    std::size_t _window_offset;
+    bool _owns_fd;
+};
+
+#endif // BUFFEREDWRITER_HPP
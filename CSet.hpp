@@ -1,29 +1,838 @@
 #ifndef CSET_HPP
 #define CSET_HPP
 
-#include <unordered_map>
-
-#include "Tidset.hpp"
 #include "Itemset.hpp"
 #include "Diffset.hpp"
+#include "ItemMask.hpp"
 
-#include <tuple>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 /*!
- * \brief cset_key_t
+ * \brief The CSetStatistics struct
  */
-typedef std::pair< Diffset, int > cset_key_t; // Diffset, parent hashkey
+struct CSetStatistics
+{
+    CSetStatistics() :
+        generators( 0 ),
+        classes( 0 ),
+        slots( 0 ),
+        max_probe_length( 0 ),
+        mean_probe_length( 0 ),
+        max_chain_length( 0 ),
+        mean_chain_length( 0 ),
+        bytes( 0 ) {}
+
+    /*!
+     * \brief operator += accumulates the statistics of another set
+     * \param other
+     * \return
+     */
+    inline CSetStatistics & operator += ( const CSetStatistics & other )
+    {
+        if ( classes + other.classes ) {
+            mean_probe_length = ( mean_probe_length * classes + other.mean_probe_length * other.classes ) / ( classes + other.classes );
+            mean_chain_length = ( mean_chain_length * classes + other.mean_chain_length * other.classes ) / ( classes + other.classes );
+        }
+        generators += other.generators;
+        classes += other.classes;
+        slots += other.slots;
+        max_probe_length = std::max( max_probe_length, other.max_probe_length );
+        max_chain_length = std::max( max_chain_length, other.max_chain_length );
+        bytes += other.bytes;
+        return *this;
+    }
+
+    std::size_t generators;
+    std::size_t classes;
+    std::size_t slots;
+    std::size_t max_probe_length;
+    double mean_probe_length;
+    std::size_t max_chain_length;
+    double mean_chain_length;
+    std::size_t bytes;
+};
 
 /*!
- * \brief cset_val_t
+ * \brief operator <<
+ * \param os
+ * \param statistics
+ * \return
  */
-typedef std::pair< Itemset, unsigned int > cset_val_t; // Itemset, support
+inline std::ostream & operator << ( std::ostream & os, const CSetStatistics & statistics )
+{
+    os << "CSet generators: " << statistics.generators << '\n'
+       << "CSet classes: " << statistics.classes << " in " << statistics.slots << " slots\n"
+       << "CSet probe length: mean " << statistics.mean_probe_length << " max " << statistics.max_probe_length << '\n'
+       << "CSet chain length: mean " << statistics.mean_chain_length << " max " << statistics.max_chain_length << '\n'
+       << "CSet bytes per generator: " << ( statistics.generators ? double( statistics.bytes ) / statistics.generators : 0.0 ) << '\n';
+    return os;
+}
+
+template < typename item_type >
+/*!
+ * \brief The BasicCSet class
+ * Generator index. Generators with the same hashkey and support (the only
+ * ones is_subsumed compares a candidate with) form a class; classes live in
+ * an open-addressing table with linear probing and every class chains its
+ * generators. Itemsets are stored back to back in one item array, and the
+ * diffsets are not kept at all.
+ * Every generator carries a signature of its items and every class the
+ * intersection of its generators' signatures, so a subset query rejects
+ * most classes and generators without reading a single item. The
+ * signature of a SmallItem is the exact mask of the items, and settles the
+ * query on its own.
+ */
+class BasicCSet
+{
+public:
+    typedef std::vector < item_type > itemset_type;
+    typedef typename ItemTraits< item_type >::signature_type signature_type;
+
+    /*!
+     * \brief BasicCSet
+     */
+    BasicCSet() :
+        _n_classes( 0 ),
+        _n_erased( 0 )
+    {
+        _entries.push_back( Entry() ); // index 0 ends a chain
+    }
+
+    /*!
+     * \brief mix
+     * \param hashkey
+     * \param support
+     * \return well-mixed 64 bit hash of a class (splitmix64 finalizer)
+     */
+    static inline std::uint64_t mix( const int hashkey, const unsigned int support )
+    {
+        std::uint64_t x = ( std::uint64_t( std::uint32_t( hashkey ) ) << 32 ) | support;
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    /*!
+     * \brief signature
+     * \param first
+     * \param last
+     * \return A being a subset of B requires signature( A ) to be a subset of signature( B )
+     */
+    static inline signature_type signature( const item_type * first, const item_type * last )
+    {
+        return ItemTraits< item_type >::signature( first, last );
+    }
+
+    template < typename node_itemset_type >
+    /*!
+     * \brief insert
+     * \param hashkey
+     * \param itemset sorted items
+     * \param support
+     * \return index of the generator, for for_entry
+     */
+    inline std::uint32_t insert( const int hashkey, const node_itemset_type & itemset, const unsigned int support )
+    {
+        return insert( hashkey, itemset.data(), itemset.data() + itemset.size(), support, ItemTraits< item_type >::signature( itemset ) );
+    }
+
+    /*!
+     * \brief insert
+     * \param hashkey
+     * \param first
+     * \param last
+     * \param support
+     * \return index of the generator, for for_entry
+     */
+    inline std::uint32_t insert( const int hashkey, const item_type * first, const item_type * last, const unsigned int support )
+    {
+        return insert( hashkey, first, last, support, signature( first, last ) );
+    }
+
+    /*!
+     * \brief insert
+     * \param hashkey
+     * \param first
+     * \param last
+     * \param support
+     * \param signature of [first, last)
+     * \return index of the generator, for for_entry
+     */
+    inline std::uint32_t insert( const int hashkey, const item_type * first, const item_type * last, const unsigned int support, const signature_type & signature )
+    {
+        if ( 2 * ( _n_classes + 1 ) > _slots.size() ) {
+            grow();
+        }
+        Slot & slot = _slots[ find_slot( hashkey, support ) ];
+        Entry entry;
+        entry.offset = _items.size();
+        entry.next = slot.head;
+        entry.support = support;
+        entry.signature = signature;
+        if ( ! slot.head ) {
+            slot.hashkey = hashkey;
+            slot.support = support;
+            slot.common = ItemTraits< item_type >::fold( entry.signature );
+            ++ _n_classes;
+        }
+        else {
+            slot.common &= ItemTraits< item_type >::fold( entry.signature );
+        }
+        _items.insert( _items.end(), first, last );
+        slot.head = _entries.size();
+        _entries.push_back( entry );
+        return slot.head;
+    }
+
+    template < typename node_itemset_type >
+    /*!
+     * \brief has_subset
+     * \param hashkey
+     * \param support
+     * \param itemset sorted items
+     * \return true if a generator of the class is a subset of itemset
+     */
+    inline bool has_subset( const int hashkey, const unsigned int support, const node_itemset_type & itemset ) const
+    {
+        return has_subset( hashkey, support, itemset.data(), itemset.data() + itemset.size(), ItemTraits< item_type >::signature( itemset ) );
+    }
+
+    /*!
+     * \brief has_subset
+     * \param hashkey
+     * \param support
+     * \param first
+     * \param last
+     * \return true if a generator of the class is a subset of [first, last)
+     */
+    inline bool has_subset( const int hashkey, const unsigned int support, const item_type * first, const item_type * last ) const
+    {
+        return has_subset( hashkey, support, first, last, signature( first, last ) );
+    }
+
+    /*!
+     * \brief has_subset
+     * \param hashkey
+     * \param support
+     * \param first
+     * \param last
+     * \param query signature of [first, last)
+     * \return true if a generator of the class is a subset of [first, last)
+     */
+    inline bool has_subset( const int hashkey, const unsigned int support, const item_type * first, const item_type * last, const signature_type & query ) const
+    {
+        if ( _slots.empty() ) {
+            return false;
+        }
+        const Slot & slot = _slots[ find_slot( hashkey, support ) ];
+        if ( ! slot.head ) {
+            return false;
+        }
+        // Every generator of the class has the common bits
+        if ( slot.common & ~ ItemTraits< item_type >::fold( query ) ) {
+            return false;
+        }
+        for ( std::uint32_t index = slot.head; index; index = _entries[ index ].next ) {
+            if ( ! ( _entries[ index ].signature & ~ query )
+                 && ( ItemTraits< item_type >::exact || std::includes( first, last, items_begin( index ), items_end( index ) ) ) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each calls function( first, last, support ) for every generator in insertion order
+     * \param function
+     */
+    inline void for_each( const function_type & function ) const
+    {
+        for ( std::uint32_t index = 1; index < _entries.size(); ++ index ) {
+            if ( ! is_erased( index ) ) {
+                function( items_begin( index ), items_end( index ), _entries[ index ].support );
+            }
+        }
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_entry calls function( first, last, support ) for the generator insert returned index for, unless it was erased
+     * \param index
+     * \param function
+     */
+    inline void for_entry( const std::uint32_t index, const function_type & function ) const
+    {
+        if ( ! is_erased( index ) ) {
+            function( items_begin( index ), items_end( index ), _entries[ index ].support );
+        }
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each_entry calls function( hashkey, support, first, last ) for every generator in insertion order
+     * \param function
+     */
+    inline void for_each_entry( const function_type & function ) const
+    {
+        std::vector < int > hashkeys( _entries.size() );
+        for ( const auto & slot : _slots ) {
+            for ( std::uint32_t index = slot.head; index; index = _entries[ index ].next ) {
+                hashkeys[ index ] = slot.hashkey;
+            }
+        }
+        for ( std::uint32_t index = 1; index < _entries.size(); ++ index ) {
+            if ( ! is_erased( index ) ) {
+                function( hashkeys[ index ], _entries[ index ].support, items_begin( index ), items_end( index ) );
+            }
+        }
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each_class calls function( hashkey, support, first, last ) for every generator, class by class
+     * \param function
+     */
+    inline void for_each_class( const function_type & function ) const
+    {
+        for ( const auto & slot : _slots ) {
+            for ( std::uint32_t index = slot.head; index; index = _entries[ index ].next ) {
+                if ( ! is_erased( index ) ) {
+                    function( slot.hashkey, slot.support, items_begin( index ), items_end( index ) );
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief remove_subsumed erases every generator with a proper subset in its class
+     */
+    inline void remove_subsumed()
+    {
+        for ( const auto & slot : _slots ) {
+            for ( std::uint32_t index = slot.head; index; index = _entries[ index ].next ) {
+                for ( std::uint32_t other = slot.head; other; other = _entries[ other ].next ) {
+                    if ( ( length( other ) < length( index ) ) && ! is_erased( other )
+                         && ! ( _entries[ other ].signature & ~ _entries[ index ].signature )
+                         && ( ItemTraits< item_type >::exact || std::includes( items_begin( index ), items_end( index ), items_begin( other ), items_end( other ) ) ) ) {
+                        erase( index );
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief merge moves the generators of other into this set
+     * \param other
+     */
+    inline void merge( BasicCSet && other )
+    {
+        other.for_each_class( [this]( const int hashkey, const unsigned int support, const item_type * first, const item_type * last ) {
+            insert( hashkey, first, last, support );
+        } );
+        other = BasicCSet();
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        return _entries.size() - 1 - _n_erased;
+    }
+
+    /*!
+     * \brief empty
+     * \return
+     */
+    inline bool empty() const
+    {
+        return 0 == size();
+    }
+
+    /*!
+     * \brief statistics
+     * \return
+     */
+    inline CSetStatistics statistics() const
+    {
+        CSetStatistics statistics;
+        statistics.generators = size();
+        statistics.classes = _n_classes;
+        statistics.slots = _slots.size();
+        std::size_t probes = 0;
+        std::size_t chains = 0;
+        for ( std::size_t position = 0; position < _slots.size(); ++ position ) {
+            const Slot & slot = _slots[ position ];
+            if ( ! slot.head ) {
+                continue;
+            }
+            const std::size_t home = mix( slot.hashkey, slot.support ) & ( _slots.size() - 1 );
+            const std::size_t probe_length = ( ( position - home ) & ( _slots.size() - 1 ) ) + 1;
+            probes += probe_length;
+            statistics.max_probe_length = std::max( statistics.max_probe_length, probe_length );
+            std::size_t chain_length = 0;
+            for ( std::uint32_t index = slot.head; index; index = _entries[ index ].next ) {
+                ++ chain_length;
+            }
+            chains += chain_length;
+            statistics.max_chain_length = std::max( statistics.max_chain_length, chain_length );
+        }
+        if ( _n_classes ) {
+            statistics.mean_probe_length = double( probes ) / _n_classes;
+            statistics.mean_chain_length = double( chains ) / _n_classes;
+        }
+        statistics.bytes = _slots.capacity() * sizeof( Slot ) + _entries.capacity() * sizeof( Entry )
+                + _items.capacity() * sizeof( item_type ) + _erased.capacity() / 8;
+        return statistics;
+    }
+
+private:
+    /*!
+     * \brief The Slot struct is a class: hashkey, support, the head of its chain and the bits common to its folded signatures
+     */
+    struct Slot
+    {
+        Slot() :
+            common( 0 ),
+            hashkey( 0 ),
+            support( 0 ),
+            head( 0 ) {}
+
+        std::uint64_t common;
+        int hashkey;
+        std::uint32_t support;
+        std::uint32_t head;
+    };
+
+    /*!
+     * \brief The Entry struct is a generator, its items start at offset
+     */
+    struct Entry
+    {
+        Entry() :
+            offset( 0 ),
+            signature(),
+            next( 0 ),
+            support( 0 ) {}
+
+        std::uint64_t offset;
+        signature_type signature;
+        std::uint32_t next;
+        std::uint32_t support;
+    };
+
+    /*!
+     * \brief find_slot
+     * \param hashkey
+     * \param support
+     * \return the slot of the class, or the empty slot it would take
+     */
+    inline std::size_t find_slot( const int hashkey, const unsigned int support ) const
+    {
+        const std::size_t mask = _slots.size() - 1;
+        std::size_t position = mix( hashkey, support ) & mask;
+        while ( _slots[ position ].head
+                && ( ( _slots[ position ].hashkey != hashkey ) || ( _slots[ position ].support != support ) ) ) {
+            position = ( position + 1 ) & mask;
+        }
+        return position;
+    }
+
+    /*!
+     * \brief grow doubles the table, keeping the load factor at most one half
+     */
+    inline void grow()
+    {
+        std::vector < Slot > slots( _slots.empty() ? 64 : 2 * _slots.size() );
+        slots.swap( _slots );
+        for ( const auto & slot : slots ) {
+            if ( slot.head ) {
+                _slots[ find_slot( slot.hashkey, slot.support ) ] = slot;
+            }
+        }
+    }
+
+    /*!
+     * \brief items_begin
+     * \param index
+     * \return
+     */
+    inline const item_type * items_begin( const std::uint32_t index ) const
+    {
+        return _items.data() + _entries[ index ].offset;
+    }
+
+    /*!
+     * \brief items_end
+     * \param index
+     * \return
+     */
+    inline const item_type * items_end( const std::uint32_t index ) const
+    {
+        return _items.data() + ( ( index + 1 < _entries.size() ) ? _entries[ index + 1 ].offset : _items.size() );
+    }
+
+    /*!
+     * \brief length
+     * \param index
+     * \return
+     */
+    inline std::size_t length( const std::uint32_t index ) const
+    {
+        return items_end( index ) - items_begin( index );
+    }
+
+    /*!
+     * \brief is_erased
+     * \param index
+     * \return
+     */
+    inline bool is_erased( const std::uint32_t index ) const
+    {
+        return ( index < _erased.size() ) && _erased[ index ];
+    }
+
+    /*!
+     * \brief erase
+     * \param index
+     */
+    inline void erase( const std::uint32_t index )
+    {
+        if ( _erased.size() < _entries.size() ) {
+            _erased.resize( _entries.size(), false );
+        }
+        _erased[ index ] = true;
+        ++ _n_erased;
+    }
+
+private:
+    std::vector < Slot > _slots;
+    std::vector < Entry > _entries;
+    std::vector < item_type > _items;
+    std::vector < bool > _erased;
+    std::size_t _n_classes;
+    std::size_t _n_erased;
+};
 
 /*!
  * \brief CSet
  */
-typedef std::unordered_multimap< cset_key_t, cset_val_t, diffset_hash > CSet;
+typedef BasicCSet< Item > CSet;
+
+/*!
+ * \brief The InsertionLog class
+ * Generators a task inserted into a BasicConcurrentCSet, in the order it
+ * inserted them, with the logs of the tasks it spawned where it spawned
+ * them. A depth-first walk of the logs gives the order of the serial
+ * traversal. An insert is logged to the log a Scope set on its thread.
+ */
+class InsertionLog
+{
+public:
+    /*!
+     * \brief The Scope class sets the log of the calling thread while it lives
+     */
+    class Scope
+    {
+    public:
+        explicit Scope( InsertionLog & log ) :
+            _previous( current() )
+        {
+            current() = &log;
+        }
+
+        ~Scope()
+        {
+            current() = _previous;
+        }
+
+        Scope( const Scope & ) = delete;
+        Scope & operator = ( const Scope & ) = delete;
+
+    private:
+        InsertionLog * _previous;
+    };
+
+    /*!
+     * \brief current
+     * \return the log of the calling thread, or nullptr
+     */
+    static InsertionLog *& current()
+    {
+        static thread_local InsertionLog * log = nullptr;
+        return log;
+    }
+
+    /*!
+     * \brief append
+     * \param id of an inserted generator
+     */
+    inline void append( const std::uint64_t id )
+    {
+        _records.push_back( id );
+    }
+
+    /*!
+     * \brief spawn
+     * \return the log of a task spawned at this point
+     */
+    inline InsertionLog & spawn()
+    {
+        _children.push_back( std::unique_ptr< InsertionLog >( new InsertionLog() ) );
+        _records.push_back( spawned | ( _children.size() - 1 ) );
+        return *_children.back();
+    }
+
+    /*!
+     * \brief empty
+     * \return
+     */
+    inline bool empty() const
+    {
+        return _records.empty();
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each calls function( id ) for every generator logged, depth first
+     * \param function
+     */
+    inline void for_each( const function_type & function ) const
+    {
+        for ( const std::uint64_t record : _records ) {
+            if ( record & spawned ) {
+                _children[ record & ~ spawned ]->for_each( function );
+            }
+            else {
+                function( record );
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint64_t spawned = std::uint64_t( 1 ) << 63; //!< a record of a spawned task's log
+
+    std::vector < std::uint64_t > _records;
+    std::vector < std::unique_ptr < InsertionLog > > _children;
+};
+
+template < typename item_type >
+/*!
+ * \brief The BasicConcurrentCSet class
+ * CSet split into independently locked shards. A generator goes to the shard
+ * selected by its class, so everything is_subsumed has to look at for a node
+ * lives in one shard.
+ */
+class BasicConcurrentCSet
+{
+public:
+    typedef BasicCSet< item_type > cset_type;
+    typedef typename cset_type::itemset_type itemset_type;
+
+    /*!
+     * \brief BasicConcurrentCSet
+     * \param n_shards
+     */
+    explicit BasicConcurrentCSet( const unsigned int n_shards = 256 ) :
+        _shards( n_shards ? n_shards : 1 ) {}
+
+    BasicConcurrentCSet( const BasicConcurrentCSet & ) = delete;
+    BasicConcurrentCSet & operator = ( const BasicConcurrentCSet & ) = delete;
+
+    /*!
+     * \brief signature
+     * \param first
+     * \param last
+     * \return A being a subset of B requires signature( A ) to be a subset of signature( B )
+     */
+    static inline typename cset_type::signature_type signature( const item_type * first, const item_type * last )
+    {
+        return cset_type::signature( first, last );
+    }
+
+    template < typename node_itemset_type >
+    /*!
+     * \brief insert
+     * \param hashkey
+     * \param itemset
+     * \param support
+     */
+    inline void insert( const int hashkey, const node_itemset_type & itemset, const unsigned int support )
+    {
+        const std::size_t index = shard_index( hashkey, support );
+        Shard & shard = _shards[ index ];
+        std::uint64_t id = 0;
+        {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            id = ( std::uint64_t( index ) << 32 ) | shard.c_set.insert( hashkey, itemset, support );
+        }
+        if ( InsertionLog * log = InsertionLog::current() ) {
+            log->append( id );
+        }
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief visit calls function with the locked shard holding the class
+     * \param hashkey
+     * \param support
+     * \param function
+     * \return
+     */
+    inline bool visit( const int hashkey, const unsigned int support, const function_type & function ) const
+    {
+        const Shard & shard = shard_of( hashkey, support );
+        std::lock_guard< std::mutex > lock( shard.mutex );
+        return function( shard.c_set );
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        std::size_t size = 0;
+        for ( const auto & shard : _shards ) {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            size += shard.c_set.size();
+        }
+        return size;
+    }
+
+    /*!
+     * \brief statistics
+     * \return statistics of all shards together
+     */
+    inline CSetStatistics statistics() const
+    {
+        CSetStatistics statistics;
+        for ( const auto & shard : _shards ) {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            statistics += shard.c_set.statistics();
+        }
+        return statistics;
+    }
+
+    /*!
+     * \brief remove_subsumed
+     */
+    inline void remove_subsumed()
+    {
+        for ( auto & shard : _shards ) {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            shard.c_set.remove_subsumed();
+        }
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each calls function( first, last, support ) for every generator, in the order of the log, or shard by shard without one
+     * \param function
+     */
+    inline void for_each( const function_type & function ) const
+    {
+        if ( ! _log.empty() ) {
+            _log.for_each( [&]( const std::uint64_t id ) {
+                const Shard & shard = _shards[ id >> 32 ];
+                std::lock_guard< std::mutex > lock( shard.mutex );
+                shard.c_set.for_entry( std::uint32_t( id ), function );
+            } );
+            return;
+        }
+        for ( const auto & shard : _shards ) {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            shard.c_set.for_each( function );
+        }
+    }
+
+    /*!
+     * \brief log
+     * \return the log for_each follows, of the inserts of the tasks of a traversal
+     */
+    inline InsertionLog & log()
+    {
+        return _log;
+    }
+
+    /*!
+     * \brief merge moves every shard into one CSet
+     * \return
+     */
+    inline cset_type merge()
+    {
+        cset_type c_set;
+        for ( auto & shard : _shards ) {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            c_set.merge( std::move( shard.c_set ) );
+        }
+        return c_set;
+    }
+
+private:
+    /*!
+     * \brief The Shard struct
+     */
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        cset_type c_set;
+    };
+
+    /*!
+     * \brief shard_of
+     * \param hashkey
+     * \param support
+     * \return
+     */
+    inline Shard & shard_of( const int hashkey, const unsigned int support )
+    {
+        return _shards[ shard_index( hashkey, support ) ];
+    }
+
+    /*!
+     * \brief shard_of
+     * \param hashkey
+     * \param support
+     * \return
+     */
+    inline const Shard & shard_of( const int hashkey, const unsigned int support ) const
+    {
+        return _shards[ shard_index( hashkey, support ) ];
+    }
+
+    /*!
+     * \brief shard_index
+     * \param hashkey
+     * \param support
+     * \return
+     */
+    inline std::size_t shard_index( const int hashkey, const unsigned int support ) const
+    {
+        return ( cset_type::mix( hashkey, support ) >> 40 ) % _shards.size();
+    }
+
+private:
+    std::vector < Shard > _shards;
+    InsertionLog _log;
+};
+
+/*!
+ * \brief ConcurrentCSet
+ */
+typedef BasicConcurrentCSet< Item > ConcurrentCSet;
 
 /*!
  * \brief operator <<
@@ -32,10 +841,17 @@ typedef std::unordered_multimap< cset_key_t, cset_val_t, diffset_hash > CSet;
  * \return
  */
 ///*
-inline std::ostream & operator << ( std::ostream & os, const CSet & c_set )
+template < typename item_type >
+inline std::ostream & operator << ( std::ostream & os, const BasicCSet< item_type > & c_set )
 {
-    std::for_each( c_set.cbegin(), c_set.cend(), [&]( CSet::const_reference entries ) {
-        os << entries.second.first << ' ' << entries.second.second <<  '\n';
+    c_set.for_each( [&]( const item_type * first, const item_type * last, const unsigned int support ) {
+        if ( first != last ) {
+            os << '(';
+            for ( const item_type * item = first; item != last; ++ item ) {
+                os << +*item << ( ( item + 1 != last ) ? ' ' : ')' );
+            }
+        }
+        os << ' ' << support << '\n';
     } );
     return os;
 }
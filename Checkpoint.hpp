@@ -0,0 +1,274 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "BufferedWriter.hpp"
+#include "MappedFile.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/stat.h>
+
+/*!
+ * \brief The CheckpointSettings struct
+ * Where and how often a serial run saves its state, and whether it starts
+ * from the state a previous run saved.
+ */
+struct CheckpointSettings
+{
+    CheckpointSettings() :
+        interval( 300 ),
+        resume( false ) {}
+
+    /*!
+     * \brief enabled
+     * \return
+     */
+    inline bool enabled() const
+    {
+        return ! filename.empty();
+    }
+
+    std::string filename;
+    unsigned int interval; //!< seconds between two checkpoints
+    bool resume;
+};
+
+/*!
+ * \brief The CheckpointHeader struct
+ * Identifies the run a checkpoint belongs to: a checkpoint is only resumed
+ * by a run mining the same vertical database with the same parameters.
+ */
+struct CheckpointHeader
+{
+    /*!
+     * \brief version of the file layout
+     */
+    static constexpr std::uint32_t version_number = 3;
+
+    /*!
+     * \brief make
+     * \param item_size bytes of an item
+     * \param min_sup
+     * \param max_len longest itemset mined, 0 for no bound
+     * \param order sibling order
+     * \param transaction_counter
+     * \param n_items items of the vertical database
+     * \return
+     */
+    static CheckpointHeader make( const std::uint32_t item_size, const std::uint32_t min_sup, const std::uint32_t max_len, const std::uint32_t order, const std::uint64_t transaction_counter, const std::uint64_t n_items )
+    {
+        CheckpointHeader header;
+        std::memset( &header, 0, sizeof( header ) );
+        std::memcpy( header.magic, "TKGCKPT", sizeof( header.magic ) );
+        header.version = version_number;
+        header.item_size = item_size;
+        header.min_sup = min_sup;
+        header.max_len = max_len;
+        header.order = order;
+        header.transaction_counter = transaction_counter;
+        header.n_items = n_items;
+        return header;
+    }
+
+    /*!
+     * \brief operator ==
+     * \param other
+     * \return
+     */
+    inline bool operator == ( const CheckpointHeader & other ) const
+    {
+        return 0 == std::memcmp( this, &other, sizeof( CheckpointHeader ) );
+    }
+
+    char magic[ 8 ];
+    std::uint32_t version;
+    std::uint32_t item_size;
+    std::uint32_t min_sup;
+    std::uint32_t max_len;
+    std::uint32_t order;
+    std::uint32_t reserved;
+    std::uint64_t transaction_counter;
+    std::uint64_t n_items;
+};
+
+/*!
+ * \brief The CheckpointWriter class
+ * Writes a checkpoint next to its final name and renames it into place
+ * once it is complete and on disk, so a crash while writing leaves the
+ * previous checkpoint intact. Values are stored in the byte order of the
+ * machine.
+ */
+class CheckpointWriter
+{
+public:
+    /*!
+     * \brief CheckpointWriter
+     * \param filename
+     * \param header
+     */
+    CheckpointWriter( const std::string & filename, const CheckpointHeader & header ) :
+        _filename( filename ),
+        _writer( filename + ".tmp" )
+    {
+        put( &header, 1 );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief put
+     * \param value
+     */
+    inline void put( const value_type value )
+    {
+        put( &value, 1 );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief put
+     * \param values
+     * \param count
+     */
+    inline void put( const value_type * values, const std::size_t count )
+    {
+        _writer.write( reinterpret_cast< const char * >( values ), count * sizeof( value_type ) );
+    }
+
+    /*!
+     * \brief commit replaces the previous checkpoint with this one
+     */
+    inline void commit()
+    {
+        _writer.close( true );
+        if ( 0 != std::rename( ( _filename + ".tmp" ).c_str(), _filename.c_str() ) ) {
+            throw std::runtime_error( "Cannot write checkpoint: " + _filename );
+        }
+    }
+
+private:
+    std::string _filename;
+    BufferedWriter _writer;
+};
+
+/*!
+ * \brief The CheckpointReader class
+ */
+class CheckpointReader
+{
+public:
+    /*!
+     * \brief CheckpointReader
+     * \param filename
+     */
+    explicit CheckpointReader( const std::string & filename ) :
+        _file( filename ),
+        _position( 0 )
+    {
+        get( &_header, 1 );
+    }
+
+    /*!
+     * \brief exists
+     * \param filename
+     * \return
+     */
+    static bool exists( const std::string & filename )
+    {
+        struct stat status;
+        return 0 == ::stat( filename.c_str(), &status );
+    }
+
+    /*!
+     * \brief header
+     * \return
+     */
+    inline const CheckpointHeader & header() const
+    {
+        return _header;
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief get
+     * \return
+     */
+    inline value_type get()
+    {
+        value_type value;
+        get( &value, 1 );
+        return value;
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief get
+     * \param values
+     * \param count
+     */
+    inline void get( value_type * values, const std::size_t count )
+    {
+        const std::size_t size = count * sizeof( value_type );
+        if ( _file.size() - _position < size ) {
+            throw std::runtime_error( "Truncated checkpoint" );
+        }
+        std::memcpy( values, _file.data() + _position, size );
+        _position += size;
+    }
+
+private:
+    MappedFile _file;
+    std::size_t _position;
+    CheckpointHeader _header;
+};
+
+/*!
+ * \brief The CheckpointTimer class
+ * Tells the traversal when a checkpoint is due. The clock is only read
+ * every steps_per_check steps.
+ */
+class CheckpointTimer
+{
+public:
+    /*!
+     * \brief steps_per_check
+     */
+    static constexpr unsigned int steps_per_check = 1024;
+
+    /*!
+     * \brief CheckpointTimer
+     * \param interval seconds between two checkpoints
+     */
+    explicit CheckpointTimer( const unsigned int interval ) :
+        _interval( interval ),
+        _steps( 0 ),
+        _last( std::chrono::steady_clock::now() ) {}
+
+    /*!
+     * \brief due
+     * \return true once every interval, starting the next interval
+     */
+    inline bool due()
+    {
+        if ( ++ _steps % steps_per_check ) {
+            return false;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if ( now - _last < _interval ) {
+            return false;
+        }
+        _last = now;
+        return true;
+    }
+
+private:
+    std::chrono::seconds _interval;
+    unsigned int _steps;
+    std::chrono::steady_clock::time_point _last;
+};
+
+#endif // CHECKPOINT_HPP
@@ -0,0 +1,519 @@
+#ifndef CLOSURES_HPP
+#define CLOSURES_HPP
+
+#include "Talky-G.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace Talky_G
+{
+
+/*!
+ * \brief The TransactionItems class
+ * Horizontal view of a vertical database: the dense ids of the items of
+ * every transaction, transactions back to back.
+ */
+class TransactionItems
+{
+public:
+    /*!
+     * \brief TransactionItems
+     * \param vertical
+     */
+    explicit TransactionItems( const VerticalDatabase & vertical ) :
+        _offsets( std::size_t( vertical.transaction_counter ) + 2, 0 )
+    {
+        // Tids run from 1 to transaction_counter; the first pass counts, the second fills
+        for ( int pass = 0; pass < 2; ++ pass ) {
+            for ( std::size_t item = 0; item < vertical.size(); ++ item ) {
+                for_each_tid( vertical, item, [&]( const TID tid ) {
+                    if ( pass ) {
+                        _items[ _offsets[ tid ] ++ ] = std::uint32_t( item );
+                    }
+                    else {
+                        ++ _offsets[ tid + 1 ];
+                    }
+                } );
+            }
+            if ( ! pass ) {
+                for ( std::size_t tid = 1; tid < _offsets.size(); ++ tid ) {
+                    _offsets[ tid ] += _offsets[ tid - 1 ];
+                }
+                _items.resize( _offsets.back() );
+            }
+        }
+        // Filling moved every offset to the start of the next transaction
+        for ( std::size_t tid = _offsets.size() - 1; tid; -- tid ) {
+            _offsets[ tid ] = _offsets[ tid - 1 ];
+        }
+        _offsets[ 0 ] = 0;
+    }
+
+    /*!
+     * \brief begin
+     * \param tid
+     * \return
+     */
+    inline const std::uint32_t * begin( const TID tid ) const
+    {
+        return _items.data() + _offsets[ tid ];
+    }
+
+    /*!
+     * \brief end
+     * \param tid
+     * \return
+     */
+    inline const std::uint32_t * end( const TID tid ) const
+    {
+        return _items.data() + _offsets[ tid + 1 ];
+    }
+
+private:
+    template < typename function_type >
+    /*!
+     * \brief for_each_tid calls function( tid ) for every transaction holding item
+     * \param vertical
+     * \param item
+     * \param function
+     */
+    static inline void for_each_tid( const VerticalDatabase & vertical, const std::size_t item, const function_type & function )
+    {
+        const DiffsetView tids = vertical.item_tids( item );
+        if ( vertical.is_tidset( item ) ) {
+            for ( const TID tid : tids ) {
+                function( tid );
+            }
+            return;
+        }
+        auto it = tids.cbegin();
+        for ( TID tid = 1; tid <= vertical.transaction_counter; ++ tid ) {
+            if ( ( tids.cend() != it ) && ( *it == tid ) ) {
+                ++ it;
+            }
+            else {
+                function( tid );
+            }
+        }
+    }
+
+    std::vector < std::uint64_t > _offsets;
+    std::vector < std::uint32_t > _items;
+};
+
+template < typename diffset_type >
+/*!
+ * \brief The ClosureIndex class
+ * Closure of a generator: the items in every one of its transactions. It
+ * holds the generator and the closure of its parent, so the intersection of
+ * its transactions starts from one of them less that bound, and stops once
+ * nothing is left; most generators add nothing to their parent's closure
+ * and take a few transactions.
+ * The traversal is depth first, so the parent of a generator is the last
+ * one saved a level above. The transactions of a diffset node follow from
+ * its parent's, kept as a bitmap per level that is only built as far as
+ * the intersections of its descendants read it.
+ */
+class ClosureIndex
+{
+public:
+    /*!
+     * \brief ClosureIndex
+     * \param vertical
+     */
+    explicit ClosureIndex( const VerticalDatabase & vertical ) :
+        _transactions( vertical ),
+        _n_words( std::size_t( vertical.transaction_counter ) / 64 + 1 )
+    {
+        // The root holds every transaction, tids 1 to transaction_counter
+        _levels.push_back( Level( _none.cbegin() ) );
+        Level & root = _levels.front();
+        root.tids.assign( _n_words, ~ std::uint64_t( 0 ) );
+        root.tids.front() &= ~ std::uint64_t( 1 );
+        const std::size_t tail = ( std::size_t( vertical.transaction_counter ) + 1 ) % 64;
+        if ( tail ) {
+            root.tids.back() &= ( std::uint64_t( 1 ) << tail ) - 1;
+        }
+        root.built = _n_words;
+        for ( std::size_t item = 0; item < vertical.size(); ++ item ) {
+            if ( vertical.supports[ item ] == unsigned( vertical.transaction_counter ) ) {
+                root.closure.push_back( std::uint32_t( item ) );
+            }
+        }
+    }
+
+    template < typename item_type >
+    /*!
+     * \brief closure
+     * \param node saved generator
+     * \param closure receives the dense ids of the closure, ascending
+     */
+    inline void closure( const BasicNode< diffset_type, item_type > & node, std::vector < std::uint32_t > & closure )
+    {
+        const std::size_t depth = node.itemset().size();
+        while ( _levels.size() <= depth ) {
+            _levels.push_back( Level( _none.cbegin() ) );
+        }
+        const std::vector < std::uint32_t > & parent_closure = _levels[ depth - 1 ].closure;
+        _bound.clear();
+        std::set_union( parent_closure.cbegin(), parent_closure.cend(), node.itemset().cbegin(), node.itemset().cend(), std::back_inserter( _bound ), []( const std::uint32_t l, const std::uint32_t r ) {
+            return l < r;
+        } );
+        bool first = true;
+        for_each_tid( node, depth, [&]( const TID tid ) {
+            _buffer.clear();
+            if ( first ) {
+                std::set_difference( _transactions.begin( tid ), _transactions.end( tid ), _bound.cbegin(), _bound.cend(), std::back_inserter( _buffer ) );
+                first = false;
+            }
+            else {
+                std::set_intersection( _candidates.cbegin(), _candidates.cend(), _transactions.begin( tid ), _transactions.end( tid ), std::back_inserter( _buffer ) );
+            }
+            _candidates.swap( _buffer );
+            return ! _candidates.empty();
+        } );
+        closure.clear();
+        std::set_union( _bound.cbegin(), _bound.cend(), _candidates.cbegin(), _candidates.cend(), std::back_inserter( closure ) );
+        _candidates.clear();
+        Level & level = _levels[ depth ];
+        level.diffset = &node.diffset();
+        level.is_tidset = node.is_tidset();
+        level.next = node.diffset().cbegin();
+        level.built = 0;
+        level.tids.resize( _n_words );
+        level.closure = closure;
+    }
+
+private:
+    /*!
+     * \brief The Level struct
+     * Last generator saved at a depth: its closure and the bitmap of its
+     * transactions, built up to a word, with the next tid of its diffset or
+     * tidset to apply.
+     */
+    struct Level
+    {
+        explicit Level( const typename diffset_type::const_iterator & next ) :
+            diffset( nullptr ),
+            is_tidset( false ),
+            next( next ),
+            built( 0 ) {}
+
+        const diffset_type * diffset;
+        bool is_tidset;
+        typename diffset_type::const_iterator next;
+        std::size_t built; //!< words of tids built
+        std::vector < std::uint64_t > tids;
+        std::vector < std::uint32_t > closure;
+    };
+
+    /*!
+     * \brief build extends the bitmap of the transactions at depth up to word last, included
+     * \param depth
+     * \param last
+     */
+    inline void build( const std::size_t depth, const std::size_t last )
+    {
+        Level & level = _levels[ depth ];
+        if ( level.built > last ) {
+            return;
+        }
+        const TID end = TID( ( last + 1 ) * 64 );
+        if ( level.is_tidset ) {
+            std::fill( level.tids.begin() + level.built, level.tids.begin() + last + 1, 0 );
+            for ( ; ( level.diffset->cend() != level.next ) && ( *level.next < end ); ++ level.next ) {
+                level.tids[ *level.next / 64 ] |= std::uint64_t( 1 ) << ( *level.next % 64 );
+            }
+        }
+        else {
+            build( depth - 1, last );
+            const std::vector < std::uint64_t > & parent_tids = _levels[ depth - 1 ].tids;
+            std::copy( parent_tids.cbegin() + level.built, parent_tids.cbegin() + last + 1, level.tids.begin() + level.built );
+            for ( ; ( level.diffset->cend() != level.next ) && ( *level.next < end ); ++ level.next ) {
+                level.tids[ *level.next / 64 ] &= ~ ( std::uint64_t( 1 ) << ( *level.next % 64 ) );
+            }
+        }
+        level.built = last + 1;
+    }
+
+    template < typename item_type, typename function_type >
+    /*!
+     * \brief for_each_tid calls function( tid ) for the transactions of node, ascending, until it returns false
+     * \param node
+     * \param depth
+     * \param function
+     */
+    inline void for_each_tid( const BasicNode< diffset_type, item_type > & node, const std::size_t depth, const function_type & function )
+    {
+        if ( node.is_tidset() ) {
+            for ( auto tid = node.diffset().cbegin(); tid != node.diffset().cend(); ++ tid ) {
+                if ( ! function( *tid ) ) {
+                    return;
+                }
+            }
+            return;
+        }
+        // The parent's transactions less the diffset, a word of the parent at a time
+        const std::vector < std::uint64_t > & tids = _levels[ depth - 1 ].tids;
+        auto removed = node.diffset().cbegin();
+        for ( std::size_t index = 0; index < _n_words; ++ index ) {
+            build( depth - 1, index );
+            for ( std::uint64_t word = tids[ index ]; word; word &= word - 1 ) {
+                const TID tid = TID( index * 64 + __builtin_ctzll( word ) );
+                while ( ( node.diffset().cend() != removed ) && ( *removed < tid ) ) {
+                    ++ removed;
+                }
+                if ( ( node.diffset().cend() != removed ) && ( *removed == tid ) ) {
+                    continue;
+                }
+                if ( ! function( tid ) ) {
+                    return;
+                }
+            }
+        }
+    }
+
+    const TransactionItems _transactions;
+    const std::size_t _n_words;
+    const diffset_type _none; //!< start of the cursors of levels not saved yet
+    std::vector < Level > _levels; //!< level 0 is the root, every transaction
+    std::vector < std::uint32_t > _bound;
+    std::vector < std::uint32_t > _candidates;
+    std::vector < std::uint32_t > _buffer;
+};
+
+/*!
+ * \brief The ClosureWriter class
+ * Writes every closed itemset once, the first time a generator has it as
+ * its closure, and for every generator the index of its closure in that
+ * result, one per line, in the order the generators are written. The
+ * closures met are kept as dense ids back to back, and looked up by index.
+ */
+class ClosureWriter
+{
+public:
+    /*!
+     * \brief ClosureWriter
+     * \param labels label of every dense item id
+     * \param sink receives the closed itemsets
+     * \param map_filename
+     * \param mode
+     */
+    ClosureWriter( const std::vector < Item > & labels, GeneratorSink & sink, const std::string & map_filename, const WriteMode mode = WriteMode::Buffered ) :
+        _labels( labels ),
+        _sink( sink ),
+        _map( map_filename, mode ),
+        _offsets( 1, 0 ),
+        _indexes( 1024, ClosureHash( *this ), ClosureEqual( *this ) ) {}
+
+    /*!
+     * \brief operator ()
+     * \param first dense ids of the closure of a generator, ascending
+     * \param last
+     * \param support
+     */
+    inline void operator ()( const std::uint32_t * first, const std::uint32_t * last, const unsigned int support )
+    {
+        // The closure is looked up as the next one, and kept if it is new
+        _items.insert( _items.end(), first, last );
+        _offsets.push_back( _items.size() );
+        const auto got = _indexes.insert( _offsets.size() - 2 );
+        if ( got.second ) {
+            _itemset.clear();
+            for ( ; first != last; ++ first ) {
+                _itemset.push_back( _labels[ *first ] );
+            }
+            std::sort( _itemset.begin(), _itemset.end() );
+            _sink( _itemset.data(), _itemset.data() + _itemset.size(), support );
+        }
+        else {
+            _offsets.pop_back();
+            _items.resize( _offsets.back() );
+        }
+        char * out = _map.reserve( 32 );
+        char * end = TextSink::format( std::int64_t( *got.first ), out );
+        *end ++ = '\n';
+        _map.commit( end - out );
+    }
+
+    /*!
+     * \brief close
+     */
+    inline void close()
+    {
+        _sink.close();
+        _map.close();
+    }
+
+    /*!
+     * \brief count
+     * \return closed itemsets written
+     */
+    inline std::size_t count() const
+    {
+        return _indexes.size();
+    }
+
+private:
+    /*!
+     * \brief The ClosureHash class
+     */
+    class ClosureHash
+    {
+    public:
+        explicit ClosureHash( const ClosureWriter & writer ) :
+            _writer( writer ) {}
+
+        inline std::size_t operator ()( const std::uint64_t index ) const
+        {
+            std::size_t hash = _writer.length( index );
+            for ( auto item = _writer.begin( index ); item != _writer.end( index ); ++ item ) {
+                hash = hash * 1000003u ^ std::size_t( *item );
+            }
+            return hash;
+        }
+
+    private:
+        const ClosureWriter & _writer;
+    };
+
+    /*!
+     * \brief The ClosureEqual class
+     */
+    class ClosureEqual
+    {
+    public:
+        explicit ClosureEqual( const ClosureWriter & writer ) :
+            _writer( writer ) {}
+
+        inline bool operator ()( const std::uint64_t l, const std::uint64_t r ) const
+        {
+            return ( _writer.length( l ) == _writer.length( r ) ) && std::equal( _writer.begin( l ), _writer.end( l ), _writer.begin( r ) );
+        }
+
+    private:
+        const ClosureWriter & _writer;
+    };
+
+    inline const std::uint32_t * begin( const std::uint64_t index ) const
+    {
+        return _items.data() + _offsets[ index ];
+    }
+
+    inline const std::uint32_t * end( const std::uint64_t index ) const
+    {
+        return _items.data() + _offsets[ index + 1 ];
+    }
+
+    inline std::size_t length( const std::uint64_t index ) const
+    {
+        return _offsets[ index + 1 ] - _offsets[ index ];
+    }
+
+    const std::vector < Item > & _labels;
+    GeneratorSink & _sink;
+    BufferedWriter _map;
+    Itemset _itemset;
+    std::vector < std::uint32_t > _items; //!< dense ids of the closures, back to back
+    std::vector < std::uint64_t > _offsets;
+    std::unordered_set< std::uint64_t, ClosureHash, ClosureEqual > _indexes;
+};
+
+template< typename cset_type, typename diffset_type >
+/*!
+ * \brief The ClosureCSet struct
+ * CSet of a run writing the closure of every generator it saves, alongside
+ * the generators cset_type writes. Generators shorter than min_len are not
+ * written, nor are their closures.
+ */
+struct ClosureCSet
+{
+    ClosureCSet( cset_type & c_set, ClosureIndex< diffset_type > & index, ClosureWriter & writer, const unsigned int min_len = 0 ) :
+        c_set( c_set ),
+        index( index ),
+        writer( writer ),
+        min_len( min_len ) {}
+
+    cset_type & c_set;
+    ClosureIndex< diffset_type > & index;
+    ClosureWriter & writer;
+    const unsigned int min_len;
+    std::vector < std::uint32_t > closure; //!< reused buffer
+};
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief is_subsumed
+ * \param c_set
+ * \param node
+ * \return
+ */
+inline bool is_subsumed( const ClosureCSet< cset_type, diffset_type > & c_set, const BasicNode< diffset_type, item_type > & node )
+{
+    return is_subsumed( c_set.c_set, node );
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief save
+ * \param c_set
+ * \param child
+ */
+inline void save( ClosureCSet< cset_type, diffset_type > & c_set, const BasicNode< diffset_type, item_type > & child )
+{
+    save( c_set.c_set, child );
+    // Every generator, its children start from its closure
+    c_set.index.closure( child, c_set.closure );
+    if ( child.itemset().size() >= c_set.min_len ) {
+        c_set.writer( c_set.closure.data(), c_set.closure.data() + c_set.closure.size(), child.sup() );
+    }
+}
+
+template< typename cset_type, typename diffset_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline auto saved_generators( ClosureCSet< cset_type, diffset_type > & c_set ) -> decltype( saved_generators( c_set.c_set ) )
+{
+    return saved_generators( c_set.c_set );
+}
+
+template< typename cset_type, typename diffset_type >
+/*!
+ * \brief replay
+ * \param c_set
+ */
+inline void replay( ClosureCSet< cset_type, diffset_type > & c_set )
+{
+    replay( c_set.c_set );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g_closures streams the generators to sink and their closures to closures while mining
+ * \param vertical
+ * \param min_sup
+ * \param sink
+ * \param closures
+ * \param order of the children of every node, one saving subsets first
+ * \param bounds generators to report, without top_k
+ * \return statistics of the generator index
+ */
+inline CSetStatistics talky_g_closures( const VerticalDatabase & vertical, const unsigned int min_sup, GeneratorSink & sink, ClosureWriter & closures, const SiblingOrder order = SiblingOrder::Support, const SearchBounds & bounds = SearchBounds() )
+{
+    auto c_set = BasicCSet< item_type >();
+    LabelWriter writer( vertical.items, sink );
+    StreamingCSet< item_type > streaming_c_set( c_set, writer, bounds.min_len );
+    ClosureIndex< diffset_type > index( vertical );
+    ClosureCSet< StreamingCSet< item_type >, diffset_type > closure_c_set( streaming_c_set, index, closures, bounds.min_len );
+    talky_g_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, closure_c_set, order );
+    return c_set.statistics();
+}
+
+}
+
+#endif // CLOSURES_HPP
@@ -0,0 +1,56 @@
+#ifndef CPUFEATURES_HPP
+#define CPUFEATURES_HPP
+
+/*!
+ * \brief The CpuFeatures struct
+ * Instruction set extensions of the running CPU, detected once at startup.
+ * Kernels compiled for an extension are only selected when it is present.
+ */
+struct CpuFeatures
+{
+    bool popcnt;
+    bool sse42;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+    bool avx512vpopcntdq;
+
+    /*!
+     * \brief get
+     * \return
+     */
+    static const CpuFeatures & get()
+    {
+        static const CpuFeatures features = detect();
+        return features;
+    }
+
+private:
+    /*!
+     * \brief detect
+     * \return
+     */
+    static CpuFeatures detect()
+    {
+        CpuFeatures features;
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+        __builtin_cpu_init();
+        features.popcnt = __builtin_cpu_supports( "popcnt" );
+        features.sse42 = __builtin_cpu_supports( "sse4.2" );
+        features.avx2 = __builtin_cpu_supports( "avx2" );
+        features.avx512f = __builtin_cpu_supports( "avx512f" );
+        features.avx512bw = __builtin_cpu_supports( "avx512bw" );
+        features.avx512vpopcntdq = __builtin_cpu_supports( "avx512vpopcntdq" );
+#else
+        features.popcnt = false;
+        features.sse42 = false;
+        features.avx2 = false;
+        features.avx512f = false;
+        features.avx512bw = false;
+        features.avx512vpopcntdq = false;
+#endif
+        return features;
+    }
+};
+
+#endif // CPUFEATURES_HPP
@@ -3,10 +3,203 @@
 
 #include "Itemset.hpp"
 
+#include <ostream>
+
+/*!
+ * \brief The Transaction class
+ * Items of one transaction, a view into the Database holding them.
+ */
+class Transaction
+{
+public:
+    typedef const Item * const_iterator;
+
+    /*!
+     * \brief Transaction
+     * \param first
+     * \param last
+     */
+    Transaction( const Item * first, const Item * last ) :
+        _first( first ),
+        _last( last ) {}
+
+    inline const_iterator begin() const
+    {
+        return _first;
+    }
+
+    inline const_iterator end() const
+    {
+        return _last;
+    }
+
+    inline const_iterator cbegin() const
+    {
+        return _first;
+    }
+
+    inline const_iterator cend() const
+    {
+        return _last;
+    }
+
+    inline std::size_t size() const
+    {
+        return _last - _first;
+    }
+
+    inline bool empty() const
+    {
+        return _first == _last;
+    }
+
+    inline const Item & operator []( const std::size_t index ) const
+    {
+        return _first[ index ];
+    }
+
+private:
+    const Item * _first;
+    const Item * _last;
+};
+
 /*!
- * \brief Database
+ * \brief The Database class
+ * Transactions stored CSR-style: the items of all transactions back to back,
+ * and the offset of every transaction's first item.
  */
-typedef std::vector < Itemset > Database;
+class Database
+{
+public:
+    /*!
+     * \brief Database
+     */
+    Database() :
+        _offsets( 1, 0 ) {}
+
+    /*!
+     * \brief size
+     * \return number of transactions
+     */
+    inline std::size_t size() const
+    {
+        return _offsets.size() - 1;
+    }
+
+    /*!
+     * \brief empty
+     * \return
+     */
+    inline bool empty() const
+    {
+        return 1 == _offsets.size();
+    }
+
+    /*!
+     * \brief operator []
+     * \param index
+     * \return
+     */
+    inline Transaction operator []( const std::size_t index ) const
+    {
+        return Transaction( _items.data() + _offsets[ index ], _items.data() + _offsets[ index + 1 ] );
+    }
+
+    /*!
+     * \brief push_back
+     * \param itemset
+     */
+    inline void push_back( const Itemset & itemset )
+    {
+        _items.insert( _items.end(), itemset.cbegin(), itemset.cend() );
+        _offsets.push_back( _items.size() );
+    }
+
+    /*!
+     * \brief push_item appends an item to the transaction being built
+     * \param item
+     */
+    inline void push_item( const Item item )
+    {
+        _items.push_back( item );
+    }
+
+    /*!
+     * \brief end_transaction closes the transaction being built
+     */
+    inline void end_transaction()
+    {
+        _offsets.push_back( _items.size() );
+    }
+
+    /*!
+     * \brief reserve
+     * \param n_transactions
+     * \param n_items
+     */
+    inline void reserve( const std::size_t n_transactions, const std::size_t n_items )
+    {
+        _offsets.reserve( n_transactions + 1 );
+        _items.reserve( n_items );
+    }
+
+    /*!
+     * \brief offsets
+     * \return size() + 1 offsets into items()
+     */
+    inline const std::vector < std::size_t > & offsets() const
+    {
+        return _offsets;
+    }
+
+    /*!
+     * \brief items
+     * \return
+     */
+    inline const std::vector < Item > & items() const
+    {
+        return _items;
+    }
+
+    /*!
+     * \brief resize makes room for the transactions and items that concatenate copies in
+     * \param n_transactions
+     * \param n_items
+     */
+    inline void resize( const std::size_t n_transactions, const std::size_t n_items )
+    {
+        _offsets.assign( n_transactions + 1, 0 );
+        _items.resize( n_items );
+    }
+
+    /*!
+     * \brief copy_to copies every transaction into database, starting at a transaction and an item
+     * \param database sized with resize
+     * \param first_transaction
+     * \param first_item
+     */
+    inline void copy_to( Database & database, const std::size_t first_transaction, const std::size_t first_item ) const
+    {
+        std::copy( _items.cbegin(), _items.cend(), database._items.begin() + first_item );
+        for ( std::size_t index = 1; index < _offsets.size(); ++ index ) {
+            database._offsets[ first_transaction + index ] = first_item + _offsets[ index ];
+        }
+    }
+
+    /*!
+     * \brief swap
+     * \param other
+     */
+    inline void swap( Database & other )
+    {
+        _offsets.swap( other._offsets );
+        _items.swap( other._items );
+    }
+
+private:
+    std::vector < std::size_t > _offsets;
+    std::vector < Item > _items;
+};
 
 /*!
  * \brief operator <<
@@ -16,12 +209,12 @@ typedef std::vector < Itemset > Database;
  */
 inline std::ostream & operator << ( std::ostream & os, const Database & database )
 {
-    std::for_each( database.cbegin(), database.cend(), [&]( const Itemset & itemset ) {
-        std::for_each( itemset.cbegin(), itemset.cend(), [&]( const Item & item ) {
+    for ( std::size_t index = 0; index < database.size(); ++ index ) {
+        for ( const auto & item : database[ index ] ) {
             os << item << ' ';
-        } );
+        }
         os << '\n';
-    } );
+    }
     return os;
 }
 
@@ -5,11 +5,21 @@
 
 #include "Itemset.hpp"
 #include "Database.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 
 /*!
  * \brief The DatabaseReader class
+ * Reads "tid;item;item;..." lines: the first field of a line is skipped,
+ * the other fields are items, blank lines are ignored. A file is mapped and
+ * split into chunks ending at line breaks, the chunks are parsed in parallel
+ * by a hand-written integer scanner and concatenated into the Database.
+ * nfields is the expected number of fields per line and sizes the buffers.
  */
 template < unsigned int nfields >
 class DatabaseReader
@@ -17,6 +27,11 @@ class DatabaseReader
 private:
     static constexpr unsigned int number_of_fields = nfields;
 
+    /*!
+     * \brief min_chunk_size bytes below which a chunk is not worth a task
+     */
+    static constexpr std::size_t min_chunk_size = 1 << 20;
+
 public:
     /*!
      * \brief operator ()
@@ -25,29 +40,66 @@ public:
      */
     inline void operator ()(std::ifstream & data_stream, Database & database) const
     {
-        const char delim = ';';
-        std::string s;
-        Itemset itemset;
-        Item item;
-        std::string item_stirng;
-        while ( ! data_stream.eof() ) {
-            std::getline( data_stream, s );
-            if ( !s.empty() ) {
-                std::istringstream stringstream( s );
-                itemset.clear();
-                item_stirng.clear();
-                bool first_skipped = false;
-                while ( std::getline( stringstream, item_stirng, delim ) ) {
-                    if ( ! first_skipped ) {
-                        first_skipped = true;
-                        continue;
-                    }
-                    std::istringstream buff( item_stirng );
-                    buff >> item;
-                    itemset.push_back( item );
-                }
-                database.push_back( itemset );
+        const std::string data( ( std::istreambuf_iterator< char >( data_stream ) ), std::istreambuf_iterator< char >() );
+        database = Database();
+        parse( data.data(), data.data() + data.size(), database );
+    }
+
+    /*!
+     * \brief operator ()
+     * \param filename
+     * \param database
+     * \param n_threads
+     */
+    inline void operator ()(const std::string & filename, Database & database, const unsigned int n_threads) const
+    {
+        const MappedFile file( filename );
+        const char * const first = file.data();
+        const char * const last = first + file.size();
+        std::size_t n_chunks = n_threads ? n_threads : 1;
+        n_chunks = std::max< std::size_t >( 1, std::min( 4 * n_chunks, file.size() / min_chunk_size ) );
+        // Chunk bounds, every chunk but the last ends just after a line break
+        std::vector < const char * > bounds( 1, first );
+        for ( std::size_t chunk = 1; chunk < n_chunks; ++ chunk ) {
+            const char * bound = std::max( bounds.back(), first + file.size() * chunk / n_chunks );
+            const char * line_break = static_cast< const char * >( std::memchr( bound, '\n', last - bound ) );
+            bounds.push_back( line_break ? line_break + 1 : last );
+        }
+        bounds.push_back( last );
+        n_chunks = bounds.size() - 1;
+
+        database = Database();
+        if ( 1 == n_chunks ) {
+            parse( first, last, database );
+            return;
+        }
+        ThreadPool pool( n_threads );
+        std::vector < Database > chunks( n_chunks );
+        {
+            TaskGroup group( pool );
+            for ( std::size_t chunk = 0; chunk < n_chunks; ++ chunk ) {
+                group.run( [&, chunk] {
+                    parse( bounds[ chunk ], bounds[ chunk + 1 ], chunks[ chunk ] );
+                } );
             }
+            group.wait();
+        }
+        std::vector < std::size_t > first_transactions( 1, 0 );
+        std::vector < std::size_t > first_items( 1, 0 );
+        for ( const auto & chunk : chunks ) {
+            first_transactions.push_back( first_transactions.back() + chunk.size() );
+            first_items.push_back( first_items.back() + chunk.items().size() );
+        }
+        database.resize( first_transactions.back(), first_items.back() );
+        {
+            TaskGroup group( pool );
+            for ( std::size_t chunk = 0; chunk < n_chunks; ++ chunk ) {
+                group.run( [&, chunk] {
+                    chunks[ chunk ].copy_to( database, first_transactions[ chunk ], first_items[ chunk ] );
+                    Database().swap( chunks[ chunk ] );
+                } );
+            }
+            group.wait();
         }
     }
 
@@ -61,6 +113,99 @@ public:
         DatabaseReader reader;
         reader( data_stream, database );
     }
+
+    /*!
+     * \brief read_database
+     * \param filename
+     * \param database
+     * \param n_threads
+     */
+    static void read_database(const std::string & filename, Database & database, const unsigned int n_threads)
+    {
+        DatabaseReader reader;
+        reader( filename, database, n_threads );
+    }
+
+    /*!
+     * \brief parse appends the transactions of the lines in [first, last)
+     * A field without digits is not an item and is skipped.
+     * \param first
+     * \param last
+     * \param database
+     */
+    static void parse( const char * first, const char * last, Database & database )
+    {
+        const std::size_t n_lines = std::count( first, last, '\n' ) + 1;
+        database.reserve( database.size() + n_lines, database.items().size() + n_lines * ( number_of_fields - 1 ) );
+        const char delim = ';';
+        while ( first != last ) {
+            const char * line_end = static_cast< const char * >( std::memchr( first, '\n', last - first ) );
+            if ( ! line_end ) {
+                line_end = last;
+            }
+            const char * field = first;
+            while ( ( field != line_end ) && is_space( *field ) ) {
+                ++ field;
+            }
+            if ( field != line_end ) {
+                // Skip the first field
+                field = std::find( field, line_end, delim );
+                while ( field != line_end ) {
+                    ++ field;
+                    Item item;
+                    if ( scan( field, line_end, item ) ) {
+                        database.push_item( item );
+                    }
+                    field = std::find( field, line_end, delim );
+                }
+                database.end_transaction();
+            }
+            first = ( line_end == last ) ? last : line_end + 1;
+        }
+    }
+
+private:
+    /*!
+     * \brief is_space
+     * \param c
+     * \return
+     */
+    static inline bool is_space( const char c )
+    {
+        return ( ' ' == c ) || ( '\t' == c ) || ( '\r' == c );
+    }
+
+    /*!
+     * \brief scan reads an optionally signed decimal integer after leading blanks
+     * \param field advanced past the integer
+     * \param last
+     * \param item
+     * \return false if the field holds no digits
+     */
+    static inline bool scan( const char * & field, const char * last, Item & item )
+    {
+        const char * it = field;
+        while ( ( it != last ) && is_space( *it ) ) {
+            ++ it;
+        }
+        bool negative = false;
+        if ( ( it != last ) && ( ( '-' == *it ) || ( '+' == *it ) ) ) {
+            negative = ( '-' == *it );
+            ++ it;
+        }
+        const char * const digits = it;
+        long long value = 0;
+        while ( ( it != last ) && ( static_cast< unsigned char >( *it - '0' ) < 10 ) ) {
+            value = 10 * value + ( *it - '0' );
+            ++ it;
+        }
+        if ( it == digits ) {
+            return false;
+        }
+        item = static_cast< Item >( negative ? - value : value );
+        field = it;
+        return true;
+    }
 };
 
 #endif // DATABASEREADER_HPP
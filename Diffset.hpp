@@ -5,6 +5,7 @@
 #include <iostream>
 #include <tuple>
 #include <algorithm>
+#include <numeric>
 
 #include "Typedefs.hpp"
 
@@ -23,30 +24,42 @@ typedef std::vector< TID > Diffset;
  */
 typedef std::vector< TID > Tidset;
 
+/*!
+ * \brief tid_sum
+ * \param diffset
+ * \return
+ */
+inline int tid_sum( const Diffset & diffset )
+{
+    return std::accumulate( diffset.cbegin(), diffset.cend(), 0 );
+}
+
 /*!
  * \brief The diffset_hash class
  */
 class diffset_hash {
 public:
+    template < typename diffset_type >
     /*!
      * \brief operator ()
      * \param diffset_pair
      * \return
      */
-    inline int operator ()( const std::pair< const Diffset&, int > & diffset_pair ) const
+    inline int operator ()( const std::pair< diffset_type, int > & diffset_pair ) const
     {
-        return std::accumulate( diffset_pair.first.cbegin(), diffset_pair.first.cend(), diffset_pair.second, std::minus<TID>() );
+        return hash( diffset_pair.first, diffset_pair.second );
     }
 
+    template < typename diffset_type >
     /*!
      * \brief hash
-     * \param diffset_pair
+     * \param diffset
+     * \param parent_hashkey
      * \return
      */
-    inline static int hash( const std::pair< const Diffset&, int > & diffset_pair )
+    inline static int hash( const diffset_type & diffset, const int parent_hashkey )
     {
-        static const diffset_hash hash;
-        return hash( diffset_pair );
+        return parent_hashkey - tid_sum( diffset );
     }
 };
 
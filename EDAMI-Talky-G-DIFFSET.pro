@@ -10,6 +10,7 @@ QT       -= gui
 TARGET = EDAMI-Talky-G-DIFFSET
 CONFIG   += console
 CONFIG   -= app_bundle
+CONFIG   += thread
 
 TEMPLATE = app
 
@@ -23,13 +24,36 @@ HEADERS += \
     Typedefs.hpp \
     Node.hpp \
     CSet.hpp \
-    ResultSaver.hpp \
     DatabaseReader.hpp \
     Item.hpp \
     Itemset.hpp \
     Tidset.hpp \
     Database.hpp \
     Talky-G.hpp \
-    Diffset.hpp
+    Diffset.hpp \
+    Options.hpp \
+    ThreadPool.hpp \
+    ParallelTalky-G.hpp \
+    CpuFeatures.hpp \
+    BitDiffset.hpp \
+    VerticalDatabase.hpp \
+    NodeArena.hpp \
+    BufferedWriter.hpp \
+    GeneratorSink.hpp \
+    MappedFile.hpp \
+    VerticalDatabaseCache.hpp \
+    Checkpoint.hpp \
+    SearchStatistics.hpp \
+    SetKernels.hpp \
+    SearchBounds.hpp \
+    ItemMask.hpp \
+    IncrementalState.hpp \
+    IncrementalTalky-G.hpp \
+    OutOfCore.hpp \
+    OutOfCoreTalky-G.hpp \
+    MiningServer.hpp \
+    ShardMerge.hpp \
+    ShardedTalky-G.hpp \
+    Closures.hpp
 
 QMAKE_CXX = g++-4.7
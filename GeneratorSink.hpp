@@ -0,0 +1,447 @@
+#ifndef GENERATORSINK_HPP
+#define GENERATORSINK_HPP
+
+#include "BufferedWriter.hpp"
+#include "Itemset.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief The GeneratorSink class
+ * Receives the generators as the traversal finds them.
+ */
+class GeneratorSink
+{
+public:
+    /*!
+     * \brief GeneratorSink
+     */
+    GeneratorSink() :
+        _count( 0 ) {}
+
+    virtual ~GeneratorSink() {}
+
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    inline void operator ()( const Item * first, const Item * last, const unsigned int support )
+    {
+        ++ _count;
+        write( first, last, support );
+    }
+
+    /*!
+     * \brief close flushes everything written so far
+     */
+    virtual void close() = 0;
+
+    /*!
+     * \brief count
+     * \return generators received
+     */
+    inline std::size_t count() const
+    {
+        return _count;
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support ) = 0;
+
+private:
+    std::size_t _count;
+};
+
+/*!
+ * \brief The TextSink class writes "(i1 i2 ...) support" lines, the format of the CSet stream operator
+ */
+class TextSink : public GeneratorSink
+{
+public:
+    /*!
+     * \brief TextSink
+     * \param filename
+     * \param mode
+     */
+    TextSink( const std::string & filename, const WriteMode mode = WriteMode::Buffered ) :
+        _writer( filename, mode ) {}
+
+    /*!
+     * \brief TextSink writes to a descriptor that close leaves open
+     * \param fd
+     */
+    explicit TextSink( const int fd ) :
+        _writer( fd ) {}
+
+    /*!
+     * \brief close
+     */
+    virtual void close()
+    {
+        _writer.close();
+    }
+
+    /*!
+     * \brief write_line writes a line of text between the generators
+     * \param line without its line break
+     */
+    inline void write_line( const std::string & line )
+    {
+        _writer.write( line.data(), line.size() );
+        _writer.write( "\n", 1 );
+    }
+
+    /*!
+     * \brief format
+     * \param value
+     * \param out
+     * \return end of the decimal digits written at out
+     */
+    static inline char * format( const std::int64_t value, char * out )
+    {
+        std::uint64_t magnitude = value;
+        if ( value < 0 ) {
+            *out ++ = '-';
+            magnitude = 0 - magnitude;
+        }
+        char digits[ 20 ];
+        char * digit = digits;
+        do {
+            *digit ++ = char( '0' + magnitude % 10 );
+            magnitude /= 10;
+        } while ( magnitude );
+        while ( digit != digits ) {
+            *out ++ = *-- digit;
+        }
+        return out;
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support )
+    {
+        // Room for a parenthesis, a separator and a number, reserved per number
+        constexpr std::size_t max_field = 16;
+        if ( first != last ) {
+            char * out = _writer.reserve( max_field );
+            *out = '(';
+            _writer.commit( 1 );
+            for ( const Item * item = first; item != last; ++ item ) {
+                out = _writer.reserve( max_field );
+                char * end = format( *item, out );
+                *end ++ = ( item + 1 != last ) ? ' ' : ')';
+                _writer.commit( end - out );
+            }
+        }
+        char * out = _writer.reserve( 2 * max_field );
+        char * end = out;
+        *end ++ = ' ';
+        end = format( support, end );
+        *end ++ = '\n';
+        _writer.commit( end - out );
+    }
+
+private:
+    BufferedWriter _writer;
+};
+
+/*!
+ * \brief The BinaryResult struct
+ * Layout of a binary result: the magic and the version, then one record
+ * per generator, all numbers LEB128 varints:
+ * n_items, support, zigzag( first item ), then the gaps to the next items.
+ */
+struct BinaryResult
+{
+    static constexpr std::size_t magic_size = 4;
+    static constexpr unsigned int version = 1;
+
+    /*!
+     * \brief magic
+     * \return
+     */
+    static inline const char * magic()
+    {
+        return "TKGB";
+    }
+
+    /*!
+     * \brief put_varint
+     * \param value
+     * \param out
+     * \return
+     */
+    static inline char * put_varint( std::uint64_t value, char * out )
+    {
+        while ( value >= 0x80 ) {
+            *out ++ = char( value | 0x80 );
+            value >>= 7;
+        }
+        *out ++ = char( value );
+        return out;
+    }
+
+    template < typename iterator_type >
+    /*!
+     * \brief get_varint
+     * \param first advanced past the varint
+     * \param last
+     * \param value
+     * \return false if the input ends inside the varint
+     */
+    static inline bool get_varint( iterator_type & first, const iterator_type & last, std::uint64_t & value )
+    {
+        value = 0;
+        for ( unsigned int shift = 0; ( first != last ) && ( shift < 64 ); shift += 7 ) {
+            const unsigned char byte = *first;
+            ++ first;
+            value |= std::uint64_t( byte & 0x7f ) << shift;
+            if ( ! ( byte & 0x80 ) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*!
+     * \brief zigzag
+     * \param item
+     * \return
+     */
+    static inline std::uint64_t zigzag( const Item item )
+    {
+        const std::int64_t value = item;
+        return ( std::uint64_t( value ) << 1 ) ^ std::uint64_t( value >> 63 );
+    }
+
+    /*!
+     * \brief unzigzag
+     * \param value
+     * \return
+     */
+    static inline Item unzigzag( const std::uint64_t value )
+    {
+        return Item( std::int64_t( value >> 1 ) ^ - std::int64_t( value & 1 ) );
+    }
+};
+
+/*!
+ * \brief The BinarySink class
+ */
+class BinarySink : public GeneratorSink
+{
+public:
+    /*!
+     * \brief BinarySink
+     * \param filename
+     * \param mode
+     */
+    BinarySink( const std::string & filename, const WriteMode mode = WriteMode::Buffered ) :
+        _writer( filename, mode )
+    {
+        char header[ 16 ];
+        char * end = std::copy( BinaryResult::magic(), BinaryResult::magic() + BinaryResult::magic_size, header );
+        end = BinaryResult::put_varint( BinaryResult::version, end );
+        _writer.write( header, end - header );
+    }
+
+    /*!
+     * \brief close
+     */
+    virtual void close()
+    {
+        _writer.close();
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support )
+    {
+        constexpr std::size_t max_varint = 10;
+        char * out = _writer.reserve( 3 * max_varint );
+        char * end = BinaryResult::put_varint( last - first, out );
+        end = BinaryResult::put_varint( support, end );
+        if ( first != last ) {
+            end = BinaryResult::put_varint( BinaryResult::zigzag( *first ), end );
+        }
+        _writer.commit( end - out );
+        for ( const Item * item = first + 1; item < last; ++ item ) {
+            out = _writer.reserve( max_varint );
+            end = BinaryResult::put_varint( std::uint64_t( std::int64_t( *item ) - std::int64_t( *( item - 1 ) ) ), out );
+            _writer.commit( end - out );
+        }
+    }
+
+private:
+    BufferedWriter _writer;
+};
+
+/*!
+ * \brief The SweepSink class
+ * Receives the generators mined at the lowest of several minimal supports
+ * and passes each one on to the sinks of the minimal supports it reaches.
+ * Whether an itemset is a generator does not depend on the minimal
+ * support, so every sink gets exactly the result of a run at its own.
+ */
+class SweepSink : public GeneratorSink
+{
+public:
+    /*!
+     * \brief add
+     * \param min_sup
+     * \param sink receives the generators of support min_sup or more
+     */
+    inline void add( const unsigned int min_sup, std::unique_ptr< GeneratorSink > sink )
+    {
+        const auto position = std::find_if( _sinks.begin(), _sinks.end(), [min_sup]( const Entry & entry ) {
+            return min_sup < entry.first;
+        } );
+        _sinks.insert( position, Entry( min_sup, std::move( sink ) ) );
+    }
+
+    /*!
+     * \brief close
+     */
+    virtual void close()
+    {
+        for ( auto & entry : _sinks ) {
+            entry.second->close();
+        }
+    }
+
+    /*!
+     * \brief size
+     * \return number of sinks
+     */
+    inline std::size_t size() const
+    {
+        return _sinks.size();
+    }
+
+    /*!
+     * \brief min_sup
+     * \param index of a sink, in ascending order of minimal support
+     * \return
+     */
+    inline unsigned int min_sup( const std::size_t index ) const
+    {
+        return _sinks[ index ].first;
+    }
+
+    /*!
+     * \brief sink
+     * \param index of a sink, in ascending order of minimal support
+     * \return
+     */
+    inline const GeneratorSink & sink( const std::size_t index ) const
+    {
+        return *_sinks[ index ].second;
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support )
+    {
+        for ( auto & entry : _sinks ) {
+            if ( support < entry.first ) {
+                break;
+            }
+            ( *entry.second )( first, last, support );
+        }
+    }
+
+private:
+    typedef std::pair< unsigned int, std::unique_ptr< GeneratorSink > > Entry;
+
+    std::vector < Entry > _sinks;
+};
+
+/*!
+ * \brief The BinaryResultConverter class turns a binary result back into the text format
+ */
+class BinaryResultConverter
+{
+public:
+    /*!
+     * \brief operator ()
+     * \param binary_stream
+     * \param sink
+     * \return false if binary_stream is not a complete binary result
+     */
+    inline bool operator ()( std::ifstream & binary_stream, GeneratorSink & sink ) const
+    {
+        std::istreambuf_iterator< char > first( binary_stream );
+        const std::istreambuf_iterator< char > last;
+        for ( std::size_t index = 0; index < BinaryResult::magic_size; ++ index ) {
+            if ( ( first == last ) || ( *first != BinaryResult::magic()[ index ] ) ) {
+                return false;
+            }
+            ++ first;
+        }
+        std::uint64_t version = 0;
+        if ( ! BinaryResult::get_varint( first, last, version ) || ( BinaryResult::version != version ) ) {
+            return false;
+        }
+        Itemset itemset;
+        std::uint64_t n_items = 0;
+        std::uint64_t support = 0;
+        std::uint64_t value = 0;
+        while ( first != last ) {
+            if ( ! BinaryResult::get_varint( first, last, n_items ) || ! BinaryResult::get_varint( first, last, support ) ) {
+                return false;
+            }
+            itemset.clear();
+            for ( std::uint64_t index = 0; index < n_items; ++ index ) {
+                if ( ! BinaryResult::get_varint( first, last, value ) ) {
+                    return false;
+                }
+                itemset.push_back( index ? Item( itemset.back() + std::int64_t( value ) ) : BinaryResult::unzigzag( value ) );
+            }
+            sink( itemset.data(), itemset.data() + itemset.size(), support );
+        }
+        return true;
+    }
+
+    /*!
+     * \brief convert
+     * \param binary_stream
+     * \param sink
+     * \return
+     */
+    static bool convert( std::ifstream & binary_stream, GeneratorSink & sink )
+    {
+        BinaryResultConverter converter;
+        return converter( binary_stream, sink );
+    }
+};
+
+#endif // GENERATORSINK_HPP
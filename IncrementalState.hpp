@@ -0,0 +1,248 @@
+#ifndef INCREMENTALSTATE_HPP
+#define INCREMENTALSTATE_HPP
+
+#include "GeneratorSink.hpp"
+#include "VerticalDatabaseCache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief The GeneratorList class
+ * Sink keeping the generators it receives in memory, items back to back,
+ * and passing them on to another sink if it has one.
+ */
+class GeneratorList : public GeneratorSink
+{
+public:
+    /*!
+     * \brief GeneratorList
+     * \param next sink the generators are passed on to, or nullptr
+     */
+    explicit GeneratorList( GeneratorSink * next = nullptr ) :
+        _next( next ),
+        _offsets( 1, 0 ) {}
+
+    /*!
+     * \brief close
+     */
+    virtual void close()
+    {
+        if ( _next ) {
+            _next->close();
+        }
+    }
+
+    /*!
+     * \brief forward_to
+     * \param next sink the generators received from now on are passed on to, or nullptr
+     */
+    inline void forward_to( GeneratorSink * next )
+    {
+        _next = next;
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        return _supports.size();
+    }
+
+    template < typename function_type >
+    /*!
+     * \brief for_each calls function( first, last, support ) for every generator in the order received
+     * \param function
+     */
+    inline void for_each( const function_type & function ) const
+    {
+        for ( std::size_t index = 0; index < size(); ++ index ) {
+            function( _items.data() + _offsets[ index ], _items.data() + _offsets[ index + 1 ], _supports[ index ] );
+        }
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support )
+    {
+        _items.insert( _items.end(), first, last );
+        _offsets.push_back( _items.size() );
+        _supports.push_back( support );
+        if ( _next ) {
+            ( *_next )( first, last, support );
+        }
+    }
+
+private:
+    GeneratorSink * _next;
+    std::vector < Item > _items;
+    std::vector < std::uint64_t > _offsets;
+    std::vector < unsigned int > _supports;
+};
+
+/*!
+ * \brief The IncrementalState class
+ * What an incremental run needs from the run before it: the vertical
+ * database of every transaction so far, every item kept, in prefix.vdb (the
+ * layout of VerticalDatabaseCache), and the generators mined from it in
+ * prefix.gen: a header, then the support, the length and the items of
+ * every generator. The header ties the generators to the vertical database
+ * they were mined from. Both files are written next to their names and
+ * renamed into place.
+ */
+class IncrementalState
+{
+public:
+    /*!
+     * \brief version of the generator file layout
+     */
+    static constexpr std::uint32_t version = 1;
+
+    /*!
+     * \brief The Header struct
+     */
+    struct Header
+    {
+        char magic[ 8 ];
+        std::uint32_t version;
+        std::uint32_t min_sup;
+        std::uint64_t transaction_counter;
+        std::uint64_t n_items;
+        std::uint64_t n_generators;
+    };
+
+    /*!
+     * \brief vertical_filename
+     * \param prefix
+     * \return
+     */
+    static std::string vertical_filename( const std::string & prefix )
+    {
+        return prefix + ".vdb";
+    }
+
+    /*!
+     * \brief generators_filename
+     * \param prefix
+     * \return
+     */
+    static std::string generators_filename( const std::string & prefix )
+    {
+        return prefix + ".gen";
+    }
+
+    /*!
+     * \brief save
+     * \param prefix
+     * \param vertical every transaction so far, every item kept
+     * \param min_sup the generators were mined with
+     * \param generators
+     */
+    static void save( const std::string & prefix, const VerticalDatabase & vertical, const unsigned int min_sup, const GeneratorList & generators )
+    {
+        const std::string filename = generators_filename( prefix );
+        {
+            const Header header = make_header( vertical, min_sup, generators.size() );
+            BufferedWriter writer( filename + ".tmp" );
+            writer.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+            generators.for_each( [&writer]( const Item * first, const Item * last, const unsigned int support ) {
+                const std::uint32_t fields[ 2 ] = { support, std::uint32_t( last - first ) };
+                writer.write( reinterpret_cast< const char * >( fields ), sizeof( fields ) );
+                writer.write( reinterpret_cast< const char * >( first ), ( last - first ) * sizeof( Item ) );
+            } );
+            writer.close( true );
+        }
+        // The vertical database may be mapped from its previous file, which outlives the rename
+        VerticalDatabaseCache::save( vertical_filename( prefix ) + ".tmp", vertical, 1, std::string() );
+        rename( vertical_filename( prefix ) );
+        rename( filename );
+    }
+
+    /*!
+     * \brief load
+     * \param prefix
+     * \param vertical
+     * \param min_sup the generators were mined with
+     * \param generators
+     */
+    static void load( const std::string & prefix, VerticalDatabase & vertical, unsigned int & min_sup, GeneratorList & generators )
+    {
+        if ( ! VerticalDatabaseCache::load( vertical_filename( prefix ), std::string(), 1, vertical ) ) {
+            throw std::runtime_error( "Cannot load state: " + vertical_filename( prefix ) );
+        }
+        const std::string filename = generators_filename( prefix );
+        const MappedFile file( filename );
+        Header header;
+        if ( file.size() < sizeof( header ) ) {
+            throw std::runtime_error( "Cannot load state: " + filename );
+        }
+        std::memcpy( &header, file.data(), sizeof( header ) );
+        const Header expected = make_header( vertical, header.min_sup, header.n_generators );
+        if ( 0 != std::memcmp( &header, &expected, sizeof( header ) ) ) {
+            throw std::runtime_error( "State does not match its vertical database: " + filename );
+        }
+        min_sup = header.min_sup;
+        std::size_t position = sizeof( header );
+        std::vector < Item > itemset;
+        for ( std::uint64_t index = 0; index < header.n_generators; ++ index ) {
+            std::uint32_t fields[ 2 ];
+            if ( file.size() - position < sizeof( fields ) ) {
+                throw std::runtime_error( "Truncated state: " + filename );
+            }
+            std::memcpy( fields, file.data() + position, sizeof( fields ) );
+            position += sizeof( fields );
+            if ( ( file.size() - position ) / sizeof( Item ) < fields[ 1 ] ) {
+                throw std::runtime_error( "Truncated state: " + filename );
+            }
+            itemset.resize( fields[ 1 ] );
+            std::memcpy( itemset.data(), file.data() + position, fields[ 1 ] * sizeof( Item ) );
+            position += fields[ 1 ] * sizeof( Item );
+            generators( itemset.data(), itemset.data() + itemset.size(), fields[ 0 ] );
+        }
+    }
+
+private:
+    /*!
+     * \brief make_header
+     * \param vertical
+     * \param min_sup
+     * \param n_generators
+     * \return
+     */
+    static Header make_header( const VerticalDatabase & vertical, const unsigned int min_sup, const std::uint64_t n_generators )
+    {
+        Header header;
+        std::memset( &header, 0, sizeof( header ) );
+        std::memcpy( header.magic, "TKGSTAT", sizeof( header.magic ) );
+        header.version = version;
+        header.min_sup = min_sup;
+        header.transaction_counter = vertical.transaction_counter;
+        header.n_items = vertical.size();
+        header.n_generators = n_generators;
+        return header;
+    }
+
+    /*!
+     * \brief rename moves filename.tmp into place
+     * \param filename
+     */
+    static void rename( const std::string & filename )
+    {
+        if ( 0 != std::rename( ( filename + ".tmp" ).c_str(), filename.c_str() ) ) {
+            throw std::runtime_error( "Cannot write state: " + filename );
+        }
+    }
+};
+
+#endif // INCREMENTALSTATE_HPP
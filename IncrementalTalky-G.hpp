@@ -0,0 +1,257 @@
+#ifndef INCREMENTALTALKYG_HPP
+#define INCREMENTALTALKYG_HPP
+
+#include "Talky-G.hpp"
+#include "ParallelTalky-G.hpp"
+#include "IncrementalState.hpp"
+
+#include <unordered_map>
+
+namespace Talky_G
+{
+
+/*!
+ * \brief max_delta_share an update mines incrementally while the new
+ * transactions are at most this share of the old ones, and mines everything
+ * again past it
+ */
+constexpr unsigned int max_delta_share = 4;
+
+/*!
+ * \brief The DeltaIndex class
+ * Which itemsets new transactions can affect. Supports only grow, and
+ * for every item x of an itemset X, sup( X \ x ) - sup( X ) grows by the
+ * new transactions holding X \ x but not x. So whether X is a frequent
+ * generator, and its support, only change if some new transaction misses
+ * at most one item of X. Those itemsets are touched. Every subset of a
+ * touched itemset is touched, so the touched generators are mined by a
+ * traversal that never leaves them, and every other generator keeps its
+ * support and stays a generator.
+ * Every item holds a bitmap of the new transactions it is in; an item in
+ * none shares the empty row.
+ */
+class DeltaIndex
+{
+public:
+    /*!
+     * \brief DeltaIndex
+     * \param vertical every transaction, the new ones last
+     * \param delta vertical database of the new transactions alone
+     */
+    DeltaIndex( const VerticalDatabase & vertical, const VerticalDatabase & delta ) :
+        _words( ( delta.transaction_counter + 63 ) / 64 ),
+        _rows( vertical.size(), 0 ),
+        _bits( _words, 0 )
+    {
+        std::unordered_map< Item, unsigned int, item_hash > delta_index;
+        for ( unsigned int index = 0; index < delta.size(); ++ index ) {
+            delta_index.insert( std::make_pair( delta.items[ index ], index ) );
+        }
+        for ( std::size_t item = 0; item < vertical.size(); ++ item ) {
+            const auto got = delta_index.find( vertical.items[ item ] );
+            if ( delta_index.cend() == got ) {
+                continue;
+            }
+            _rows[ item ] = _bits.size() / _words;
+            _bits.resize( _bits.size() + _words, delta.is_tidset( got->second ) ? 0 : ~ std::uint64_t( 0 ) );
+            std::uint64_t * row = _bits.data() + _bits.size() - _words;
+            for ( const TID tid : delta.item_tids( got->second ) ) {
+                row[ ( tid - 1 ) / 64 ] ^= std::uint64_t( 1 ) << ( ( tid - 1 ) % 64 );
+            }
+            if ( delta.transaction_counter % 64 ) {
+                row[ _words - 1 ] &= ~ std::uint64_t( 0 ) >> ( 64 - delta.transaction_counter % 64 );
+            }
+        }
+    }
+
+    template < typename item_type >
+    /*!
+     * \brief touches
+     * \param first distinct dense item ids
+     * \param last
+     * \return true if a new transaction misses at most one item of the itemset
+     */
+    inline bool touches( const item_type * first, const item_type * last ) const
+    {
+        for ( std::size_t word = 0; word < _words; ++ word ) {
+            // Transactions missing none, and exactly one, of the items so far
+            std::uint64_t none = ~ std::uint64_t( 0 );
+            std::uint64_t one = 0;
+            for ( const item_type * item = first; item != last; ++ item ) {
+                const std::uint64_t bits = _bits[ _rows[ *item ] * _words + word ];
+                one = ( one & bits ) | ( none & ~ bits );
+                none &= bits;
+            }
+            if ( none | one ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template < typename itemset_type >
+    /*!
+     * \brief touches
+     * \param itemset_l sorted dense item ids
+     * \param itemset_r sorted dense item ids
+     * \param union_itemset reused buffer
+     * \return true if the union of both itemsets is touched
+     */
+    inline bool touches( const itemset_type & itemset_l, const itemset_type & itemset_r, itemset_type & union_itemset ) const
+    {
+        itemset_union( itemset_l, itemset_r, union_itemset );
+        return touches( union_itemset.data(), union_itemset.data() + union_itemset.size() );
+    }
+
+private:
+    const std::size_t _words;
+    std::vector < std::uint64_t > _rows;
+    std::vector < std::uint64_t > _bits; //!< row 0 is empty
+};
+
+template< typename cset_type >
+/*!
+ * \brief The DeltaCSet struct
+ * CSet of an incremental update: only the joins touched by the new
+ * transactions are mined.
+ */
+struct DeltaCSet
+{
+    DeltaCSet( cset_type & c_set, const DeltaIndex & delta ) :
+        c_set( c_set ),
+        delta( delta ) {}
+
+    cset_type & c_set;
+    const DeltaIndex & delta;
+};
+
+template< typename cset_type, typename diffset_type, typename item_type >
+/*!
+ * \brief explores
+ * \param c_set
+ * \param curr
+ * \param other
+ * \return true if the join of curr and other is touched by the new transactions
+ */
+inline bool explores( const DeltaCSet< cset_type > & c_set, const BasicNode< diffset_type, item_type > & curr, const BasicNode< diffset_type, item_type > & other )
+{
+    static thread_local typename BasicNode< diffset_type, item_type >::itemset_type union_itemset;
+    return c_set.delta.touches( curr.itemset(), other.itemset(), union_itemset );
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief is_subsumed
+ * \param c_set
+ * \param node
+ * \return
+ */
+inline bool is_subsumed( const DeltaCSet< cset_type > & c_set, const BasicNode< diffset_type, item_type > & node )
+{
+    return is_subsumed( c_set.c_set, node );
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief save
+ * \param c_set
+ * \param child
+ */
+inline void save( DeltaCSet< cset_type > & c_set, const BasicNode< diffset_type, item_type > & child )
+{
+    save( c_set.c_set, child );
+}
+
+template< typename cset_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline auto saved_generators( DeltaCSet< cset_type > & c_set ) -> decltype( saved_generators( c_set.c_set ) )
+{
+    return saved_generators( c_set.c_set );
+}
+
+template< typename cset_type >
+/*!
+ * \brief replay
+ * \param c_set
+ */
+inline void replay( DeltaCSet< cset_type > & c_set )
+{
+    replay( c_set.c_set );
+}
+
+/*!
+ * \brief The IncrementalUpdate struct
+ * New transactions appended to a mined database.
+ */
+struct IncrementalUpdate
+{
+    IncrementalUpdate( const DeltaIndex & delta, const GeneratorList & previous ) :
+        delta( delta ),
+        previous( previous ) {}
+
+    const DeltaIndex & delta;
+    const GeneratorList & previous; //!< generators of the old transactions, under their labels
+};
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g_update writes the generators of a database with new transactions to sink
+ * The previous generators the new transactions do not touch are written
+ * as they were; the touched ones are mined again, with their new support,
+ * together with the new generators.
+ * \param vertical every transaction, the new ones last
+ * \param update
+ * \param min_sup the previous generators were mined with
+ * \param n_threads
+ * \param sink
+ * \param order of the children of every node
+ * \return statistics of the generator index of the mined generators
+ */
+inline CSetStatistics talky_g_update( const VerticalDatabase & vertical, const IncrementalUpdate & update, const unsigned int min_sup, const unsigned int n_threads, GeneratorSink & sink, const SiblingOrder order = SiblingOrder::Support )
+{
+    {
+        std::unordered_map< Item, item_type, item_hash > dense_ids;
+        for ( std::size_t index = 0; index < vertical.size(); ++ index ) {
+            dense_ids.insert( std::make_pair( vertical.items[ index ], item_type( index ) ) );
+        }
+        std::vector < item_type > itemset;
+        update.previous.for_each( [&]( const Item * first, const Item * last, const unsigned int support ) {
+            itemset.clear();
+            for ( const Item * item = first; item != last; ++ item ) {
+                itemset.push_back( dense_ids.at( *item ) );
+            }
+            if ( ! update.delta.touches( itemset.data(), itemset.data() + itemset.size() ) ) {
+                sink( first, last, support );
+            }
+        } );
+    }
+    LabelWriter writer( vertical.items, sink );
+    if ( n_threads > 1 ) {
+        BasicConcurrentCSet< item_type > c_set;
+        DeltaCSet< BasicConcurrentCSet< item_type > > delta_c_set( c_set, update.delta );
+        talky_g_parallel_mine< diffset_type, item_type >( vertical, min_sup, 0, n_threads, delta_c_set, order );
+        write_generators( c_set, SearchBounds(), writer );
+        return c_set.statistics();
+    }
+    auto c_set = BasicCSet< item_type >();
+    if ( saves_subsets_first( order ) ) {
+        StreamingCSet< item_type > streaming_c_set( c_set, writer );
+        DeltaCSet< StreamingCSet< item_type > > delta_c_set( streaming_c_set, update.delta );
+        talky_g_mine< diffset_type, item_type >( vertical, min_sup, 0, delta_c_set, order );
+    }
+    else {
+        DeltaCSet< BasicCSet< item_type > > delta_c_set( c_set, update.delta );
+        talky_g_mine< diffset_type, item_type >( vertical, min_sup, 0, delta_c_set, order );
+        c_set.remove_subsumed();
+        write_generators( c_set, SearchBounds(), writer );
+    }
+    return c_set.statistics();
+}
+
+}
+
+#endif // INCREMENTALTALKYG_HPP
@@ -0,0 +1,403 @@
+#ifndef ITEMMASK_HPP
+#define ITEMMASK_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+template < std::size_t n_words >
+/*!
+ * \brief The ItemMask class
+ * Set of dense item ids below 64 * n_words, one bit per item.
+ */
+class ItemMask
+{
+public:
+    /*!
+     * \brief ItemMask the empty set
+     */
+    ItemMask() :
+        _words() {}
+
+    /*!
+     * \brief set
+     * \param item
+     */
+    inline void set( const std::size_t item )
+    {
+        _words[ item / 64 ] |= std::uint64_t( 1 ) << ( item % 64 );
+    }
+
+    /*!
+     * \brief word
+     * \param index
+     * \return
+     */
+    inline std::uint64_t word( const std::size_t index ) const
+    {
+        return _words[ index ];
+    }
+
+    /*!
+     * \brief fold
+     * \return the OR of the words, A being a subset of B requires fold( A ) to be a subset of fold( B )
+     */
+    inline std::uint64_t fold() const
+    {
+        std::uint64_t fold = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            fold |= _words[ index ];
+        }
+        return fold;
+    }
+
+    /*!
+     * \brief operator |=
+     * \param other
+     * \return
+     */
+    inline ItemMask & operator |= ( const ItemMask & other )
+    {
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            _words[ index ] |= other._words[ index ];
+        }
+        return *this;
+    }
+
+    /*!
+     * \brief operator &=
+     * \param other
+     * \return
+     */
+    inline ItemMask & operator &= ( const ItemMask & other )
+    {
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            _words[ index ] &= other._words[ index ];
+        }
+        return *this;
+    }
+
+    /*!
+     * \brief operator &
+     * \param other
+     * \return
+     */
+    inline ItemMask operator & ( const ItemMask & other ) const
+    {
+        ItemMask result( *this );
+        return result &= other;
+    }
+
+    /*!
+     * \brief operator ~
+     * \return
+     */
+    inline ItemMask operator ~ () const
+    {
+        ItemMask result;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            result._words[ index ] = ~ _words[ index ];
+        }
+        return result;
+    }
+
+    /*!
+     * \brief operator bool
+     * \return false for the empty set
+     */
+    inline explicit operator bool () const
+    {
+        return 0 != fold();
+    }
+
+private:
+    std::array < std::uint64_t, n_words > _words;
+};
+
+template < std::size_t n_words >
+/*!
+ * \brief The SmallItem struct
+ * Dense item id of a database with at most 64 * n_words frequent items.
+ * It converts to and from the id, so it stands in for an integer item
+ * type; the width selects the bitmask itemsets, CSet signatures and
+ * kernels of the nodes holding it.
+ */
+struct SmallItem
+{
+    SmallItem() :
+        id( 0 ) {}
+
+    SmallItem( const std::size_t id ) :
+        id( std::uint8_t( id ) ) {}
+
+    inline operator std::size_t () const
+    {
+        return id;
+    }
+
+    std::uint8_t id;
+};
+
+template < std::size_t n_words >
+/*!
+ * \brief The BitItemset class
+ * Itemset of SmallItem ids as a bitmask, with its items also kept sorted in
+ * place for the code reading itemsets as ranges. It never allocates: a
+ * union is an OR of the masks and a subset test an AND NOT.
+ */
+class BitItemset
+{
+public:
+    typedef SmallItem< n_words > value_type;
+    typedef const value_type * const_iterator;
+
+    /*!
+     * \brief BitItemset the empty itemset
+     */
+    BitItemset() :
+        _size( 0 ) {}
+
+    /*!
+     * \brief assign
+     * \param count 0, or 1 for the itemset of item
+     * \param item
+     */
+    inline void assign( const std::size_t count, const value_type item )
+    {
+        ItemMask< n_words > mask;
+        if ( count ) {
+            mask.set( item );
+        }
+        assign( mask );
+    }
+
+    template < typename iterator >
+    /*!
+     * \brief assign
+     * \param first
+     * \param last
+     */
+    inline void assign( iterator first, const iterator last )
+    {
+        ItemMask< n_words > mask;
+        for ( ; first != last; ++ first ) {
+            mask.set( std::size_t( *first ) );
+        }
+        assign( mask );
+    }
+
+    /*!
+     * \brief assign
+     * \param mask
+     */
+    inline void assign( const ItemMask< n_words > & mask )
+    {
+        _mask = mask;
+        _size = 0;
+        for ( std::size_t index = 0; index < n_words; ++ index ) {
+            for ( std::uint64_t word = mask.word( index ); word; word &= word - 1 ) {
+                _items[ _size ++ ] = value_type( index * 64 + __builtin_ctzll( word ) );
+            }
+        }
+    }
+
+    /*!
+     * \brief mask
+     * \return
+     */
+    inline const ItemMask< n_words > & mask() const
+    {
+        return _mask;
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        return _size;
+    }
+
+    /*!
+     * \brief empty
+     * \return
+     */
+    inline bool empty() const
+    {
+        return 0 == _size;
+    }
+
+    /*!
+     * \brief data
+     * \return the items in ascending order
+     */
+    inline const value_type * data() const
+    {
+        return _items.data();
+    }
+
+    /*!
+     * \brief front
+     * \return
+     */
+    inline value_type front() const
+    {
+        return _items[ 0 ];
+    }
+
+    /*!
+     * \brief cbegin
+     * \return
+     */
+    inline const_iterator cbegin() const
+    {
+        return data();
+    }
+
+    /*!
+     * \brief cend
+     * \return
+     */
+    inline const_iterator cend() const
+    {
+        return data() + _size;
+    }
+
+    /*!
+     * \brief begin
+     * \return
+     */
+    inline const_iterator begin() const
+    {
+        return cbegin();
+    }
+
+    /*!
+     * \brief end
+     * \return
+     */
+    inline const_iterator end() const
+    {
+        return cend();
+    }
+
+private:
+    ItemMask< n_words > _mask;
+    std::array < value_type, 64 * n_words > _items;
+    std::uint16_t _size;
+};
+
+template < typename item_type >
+/*!
+ * \brief The ItemTraits struct
+ * Itemset and CSet signature of an item type. Items of any width are
+ * kept in sorted vectors and signed with a hash of 64 bits, which only
+ * rules subsets out.
+ */
+struct ItemTraits
+{
+    typedef std::vector < item_type > itemset_type;
+    typedef std::uint64_t signature_type;
+
+    /*!
+     * \brief exact whether signatures tell subsets apart on their own
+     */
+    static constexpr bool exact = false;
+
+    /*!
+     * \brief signature
+     * \param first
+     * \param last
+     * \return one bit per item, A being a subset of B requires signature( A ) to be a subset of signature( B )
+     */
+    static inline signature_type signature( const item_type * first, const item_type * last )
+    {
+        signature_type signature = 0;
+        for ( ; first != last; ++ first ) {
+            signature |= std::uint64_t( 1 ) << ( ( std::uint32_t( *first ) * 0x9e3779b1u ) >> 26 );
+        }
+        return signature;
+    }
+
+    /*!
+     * \brief signature
+     * \param itemset
+     * \return
+     */
+    static inline signature_type signature( const itemset_type & itemset )
+    {
+        return signature( itemset.data(), itemset.data() + itemset.size() );
+    }
+
+    /*!
+     * \brief fold
+     * \param signature
+     * \return signature in 64 bits, the bits common to a class are kept so
+     */
+    static inline std::uint64_t fold( const signature_type signature )
+    {
+        return signature;
+    }
+};
+
+template < std::size_t n_words >
+/*!
+ * \brief The ItemTraits< SmallItem > struct
+ * Bitmask itemsets, signed with their own mask.
+ */
+struct ItemTraits< SmallItem< n_words > >
+{
+    typedef BitItemset< n_words > itemset_type;
+    typedef ItemMask< n_words > signature_type;
+
+    static constexpr bool exact = true;
+
+    /*!
+     * \brief signature
+     * \param first
+     * \param last
+     * \return the mask of the items
+     */
+    static inline signature_type signature( const SmallItem< n_words > * first, const SmallItem< n_words > * last )
+    {
+        signature_type signature;
+        for ( ; first != last; ++ first ) {
+            signature.set( *first );
+        }
+        return signature;
+    }
+
+    /*!
+     * \brief signature
+     * \param itemset
+     * \return
+     */
+    static inline const signature_type & signature( const itemset_type & itemset )
+    {
+        return itemset.mask();
+    }
+
+    /*!
+     * \brief signature
+     * \param itemset
+     * \return
+     */
+    static inline signature_type signature( const std::vector < SmallItem< n_words > > & itemset )
+    {
+        return signature( itemset.data(), itemset.data() + itemset.size() );
+    }
+
+    /*!
+     * \brief fold
+     * \param signature
+     * \return
+     */
+    static inline std::uint64_t fold( const signature_type & signature )
+    {
+        return signature.fold();
+    }
+};
+
+#endif // ITEMMASK_HPP
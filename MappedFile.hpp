@@ -0,0 +1,89 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*!
+ * \brief The MappedFile class
+ * Read-only private mapping of a whole file. An empty file maps to an empty
+ * range.
+ */
+class MappedFile
+{
+public:
+    /*!
+     * \brief MappedFile
+     * \param filename
+     */
+    explicit MappedFile( const std::string & filename ) :
+        _data( nullptr ),
+        _size( 0 )
+    {
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( -1 == fd ) {
+            throw std::runtime_error( "Cannot open file: " + filename );
+        }
+        struct stat status;
+        if ( 0 != ::fstat( fd, &status ) ) {
+            ::close( fd );
+            throw std::runtime_error( "Cannot stat file: " + filename );
+        }
+        _size = status.st_size;
+        if ( _size ) {
+            void * data = ::mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( MAP_FAILED == data ) {
+                const int error = errno;
+                ::close( fd );
+                throw std::runtime_error( "Cannot map file: " + filename + ": " + std::strerror( error ) );
+            }
+            _data = static_cast< const char * >( data );
+            ::madvise( data, _size, MADV_SEQUENTIAL );
+        }
+        ::close( fd );
+    }
+
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile & operator = ( const MappedFile & ) = delete;
+
+    /*!
+     * \brief ~MappedFile
+     */
+    ~MappedFile()
+    {
+        if ( _data ) {
+            ::munmap( const_cast< char * >( _data ), _size );
+        }
+    }
+
+    /*!
+     * \brief data
+     * \return
+     */
+    inline const char * data() const
+    {
+        return _data;
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    const char * _data;
+    std::size_t _size;
+};
+
+#endif // MAPPEDFILE_HPP
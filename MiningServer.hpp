@@ -0,0 +1,625 @@
+#ifndef MININGSERVER_HPP
+#define MININGSERVER_HPP
+
+#include "Talky-G.hpp"
+#include "DatabaseReader.hpp"
+#include "GeneratorSink.hpp"
+#include "IncrementalState.hpp"
+#include "Options.hpp"
+#include "ThreadPool.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*!
+ * \brief The ResultCache class
+ * The generators of the last queries, by query, the least recently used
+ * dropped first. Results are shared: a result found stays valid while it
+ * is sent, even if it is dropped meanwhile.
+ */
+class ResultCache
+{
+public:
+    typedef std::shared_ptr< const GeneratorList > result_type;
+
+    /*!
+     * \brief ResultCache
+     * \param capacity results kept, 0 to keep none
+     */
+    explicit ResultCache( const std::size_t capacity ) :
+        _capacity( capacity ) {}
+
+    /*!
+     * \brief find
+     * \param key
+     * \return the result of key, or nullptr
+     */
+    inline result_type find( const std::string & key )
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        const auto got = _index.find( key );
+        if ( _index.cend() == got ) {
+            return result_type();
+        }
+        _entries.splice( _entries.begin(), _entries, got->second );
+        return got->second->second;
+    }
+
+    /*!
+     * \brief insert
+     * \param key
+     * \param result
+     */
+    inline void insert( const std::string & key, const result_type & result )
+    {
+        if ( ! _capacity ) {
+            return;
+        }
+        std::lock_guard< std::mutex > lock( _mutex );
+        const auto got = _index.find( key );
+        if ( _index.cend() != got ) {
+            _entries.erase( got->second );
+            _index.erase( got );
+        }
+        _entries.push_front( std::make_pair( key, result ) );
+        _index.insert( std::make_pair( key, _entries.begin() ) );
+        if ( _entries.size() > _capacity ) {
+            _index.erase( _entries.back().first );
+            _entries.pop_back();
+        }
+    }
+
+private:
+    typedef std::list < std::pair< std::string, result_type > > entry_list;
+
+    const std::size_t _capacity;
+    std::mutex _mutex;
+    entry_list _entries; //!< most recently used first
+    std::unordered_map< std::string, entry_list::iterator > _index;
+};
+
+/*!
+ * \brief The MiningQuery struct
+ * "mine database min_sup [--min-len N] [--max-len N] [--top-k K] [--order support|diffset|frequency]"
+ */
+struct MiningQuery
+{
+    MiningQuery() :
+        min_sup( 0 ),
+        order( SiblingOrder::Support ) {}
+
+    /*!
+     * \brief key
+     * \return what tells the query apart in a ResultCache
+     */
+    inline std::string key() const
+    {
+        std::ostringstream key;
+        key << database << '\n' << min_sup << ' ' << bounds.min_len << ' ' << bounds.max_len << ' ' << bounds.top_k << ' ' << int( order );
+        return key.str();
+    }
+
+    std::string database;
+    unsigned int min_sup;
+    SearchBounds bounds;
+    SiblingOrder order;
+};
+
+/*!
+ * \brief The MiningServer class
+ * Keeps databases loaded, as vertical databases of every item, and mines
+ * them for queries read line by line, from a stream or from the clients
+ * of a Unix socket. A query is answered with its generators in the text
+ * format, as they are found, then "end count"; a query that cannot be
+ * answered gets "error message". "databases" lists the databases loaded,
+ * "quit" ends the session, and on a socket stops the server. One thread
+ * reads the socket clients and hands their whole queries to a pool, where
+ * queries of several clients run concurrently, every query on one thread;
+ * a client's queries are answered in the order it sent them, and a client
+ * waiting for nothing holds no thread. The queries of standard input are
+ * answered one after the other. The results of the last queries are kept in a
+ * ResultCache and sent again as they are.
+ */
+class MiningServer
+{
+public:
+    /*!
+     * \brief MiningServer
+     * \param n_threads queries mined at once
+     * \param cache_size results kept
+     * \param defaults of the queries
+     * \param representation of the diffsets
+     */
+    MiningServer( const unsigned int n_threads, const std::size_t cache_size, const MiningQuery & defaults, const DiffsetRepresentation representation ) :
+        _n_threads( n_threads ),
+        _cache( cache_size ),
+        _defaults( defaults ),
+        _representation( representation ) {}
+
+    /*!
+     * \brief load reads and prepares a database
+     * \param filename the name queries use
+     */
+    inline void load( const std::string & filename )
+    {
+        Database database;
+        DatabaseReader< n_of_fields >::read_database( filename, database, _n_threads );
+        std::unique_ptr< VerticalDatabase > vertical( new VerticalDatabase() );
+        // Every item is kept, for queries of any min_sup
+        VerticalDatabaseBuilder::build( database, 1, _n_threads, *vertical );
+        _databases[ filename ] = std::move( vertical );
+    }
+
+    /*!
+     * \brief serve answers the queries of a stream on fd, one after the other
+     * The queries of a stream are answered on the calling thread, one at a
+     * time; only the clients of listen are answered concurrently.
+     * \param input
+     * \param fd
+     */
+    inline void serve( std::istream & input, const int fd )
+    {
+        std::string line;
+        while ( std::getline( input, line ) && answer( line, fd ) ) {
+        }
+    }
+
+    /*!
+     * \brief listen answers the clients of a Unix socket until a client sends quit, or SIGINT or SIGTERM comes
+     * The queries under way are answered, the ones waiting for a thread are
+     * dropped, every client is let go, and the socket is removed.
+     * \param socket_path replaced if it exists
+     */
+    inline void listen( const std::string & socket_path )
+    {
+        sockaddr_un address;
+        std::memset( &address, 0, sizeof( address ) );
+        address.sun_family = AF_UNIX;
+        if ( socket_path.size() >= sizeof( address.sun_path ) ) {
+            throw std::runtime_error( "Socket path too long: " + socket_path );
+        }
+        std::memcpy( address.sun_path, socket_path.c_str(), socket_path.size() );
+        const int server_fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+        if ( -1 == server_fd ) {
+            throw std::runtime_error( "Cannot open socket: " + socket_path );
+        }
+        ::unlink( socket_path.c_str() );
+        if ( ( 0 != ::bind( server_fd, reinterpret_cast< const sockaddr * >( &address ), sizeof( address ) ) ) || ( 0 != ::listen( server_fd, SOMAXCONN ) ) ) {
+            ::close( server_fd );
+            throw std::runtime_error( "Cannot listen on socket: " + socket_path );
+        }
+        // quit and the signals write to the pipe, which wakes the accepting thread
+        int stop_pipe[ 2 ];
+        if ( 0 != ::pipe( stop_pipe ) ) {
+            ::close( server_fd );
+            ::unlink( socket_path.c_str() );
+            throw std::runtime_error( "Cannot listen on socket: " + socket_path );
+        }
+        stop_fd() = stop_pipe[ 1 ];
+        struct sigaction stop_action;
+        std::memset( &stop_action, 0, sizeof( stop_action ) );
+        stop_action.sa_handler = &MiningServer::on_stop_signal;
+        sigemptyset( &stop_action.sa_mask );
+        struct sigaction previous_int;
+        struct sigaction previous_term;
+        ::sigaction( SIGINT, &stop_action, &previous_int );
+        ::sigaction( SIGTERM, &stop_action, &previous_term );
+        // A client that leaves makes writes fail instead of ending the server
+        std::signal( SIGPIPE, SIG_IGN );
+        bool failed = false;
+        {
+            // The accepting thread reads the clients and is worker 0 of the pool, taking queries only while the others drain
+            ThreadPool pool( _n_threads + 1 );
+            TaskGroup queries( pool );
+            std::vector< pollfd > fds;
+            while ( true ) {
+                fds.assign( 2, pollfd() );
+                fds[ 0 ].fd = server_fd;
+                fds[ 0 ].events = POLLIN;
+                fds[ 1 ].fd = stop_pipe[ 0 ];
+                fds[ 1 ].events = POLLIN;
+                {
+                    std::lock_guard< std::mutex > lock( _clients_mutex );
+                    for ( const auto & entry : _clients ) {
+                        if ( ! entry.second.closed ) {
+                            pollfd client;
+                            client.fd = entry.first;
+                            client.events = POLLIN;
+                            client.revents = 0;
+                            fds.push_back( client );
+                        }
+                    }
+                }
+                if ( -1 == ::poll( fds.data(), fds.size(), -1 ) ) {
+                    if ( EINTR == errno ) {
+                        continue;
+                    }
+                    failed = true;
+                    break;
+                }
+                if ( fds[ 1 ].revents ) {
+                    break;
+                }
+                for ( std::size_t index = 2; index < fds.size(); ++ index ) {
+                    if ( fds[ index ].revents ) {
+                        read_client( fds[ index ].fd, queries );
+                    }
+                }
+                if ( ! fds[ 0 ].revents ) {
+                    continue;
+                }
+                const int client_fd = ::accept( server_fd, nullptr, nullptr );
+                if ( -1 == client_fd ) {
+                    if ( ( EINTR == errno ) || ( ECONNABORTED == errno ) ) {
+                        continue;
+                    }
+                    failed = true;
+                    break;
+                }
+                std::lock_guard< std::mutex > lock( _clients_mutex );
+                _clients[ client_fd ] = Client();
+            }
+            // The queries under way are answered, the waiting ones dropped
+            {
+                std::lock_guard< std::mutex > lock( _clients_mutex );
+                for ( auto entry = _clients.begin(); entry != _clients.end(); ) {
+                    entry->second.closed = true;
+                    entry->second.waiting.clear();
+                    if ( entry->second.busy ) {
+                        ++ entry;
+                    }
+                    else {
+                        ::close( entry->first );
+                        entry = _clients.erase( entry );
+                    }
+                }
+            }
+            queries.wait();
+        }
+        ::sigaction( SIGINT, &previous_int, nullptr );
+        ::sigaction( SIGTERM, &previous_term, nullptr );
+        stop_fd() = -1;
+        ::close( stop_pipe[ 0 ] );
+        ::close( stop_pipe[ 1 ] );
+        ::close( server_fd );
+        ::unlink( socket_path.c_str() );
+        if ( failed ) {
+            throw std::runtime_error( "Cannot accept on socket: " + socket_path );
+        }
+    }
+
+    /*!
+     * \brief answer
+     * \param line a query or a command
+     * \param fd the answer is written to
+     * \return false if the session is over
+     */
+    inline bool answer( const std::string & line, const int fd )
+    {
+        std::istringstream tokens( line );
+        std::string command;
+        if ( ! ( tokens >> command ) ) {
+            return true;
+        }
+        TextSink sink( fd );
+        try {
+            if ( command == "quit" ) {
+                return false;
+            }
+            if ( command == "databases" ) {
+                for ( const auto & entry : _databases ) {
+                    sink.write_line( entry.first );
+                }
+                sink.write_line( "end " + std::to_string( _databases.size() ) );
+            }
+            else if ( command == "mine" ) {
+                const MiningQuery query = read_query( tokens );
+                mine( query, sink );
+                sink.write_line( "end " + std::to_string( sink.count() ) );
+            }
+            else {
+                throw std::invalid_argument( "unknown command " + command );
+            }
+        }
+        catch ( const std::logic_error & error ) {
+            sink.write_line( std::string( "error " ) + error.what() );
+        }
+        sink.close();
+        return true;
+    }
+
+private:
+    /*!
+     * \brief The Client struct a connection of listen
+     */
+    struct Client
+    {
+        Client() :
+            busy( false ),
+            closed( false ) {}
+
+        std::string buffered;               //!< read, short of a line break
+        std::deque< std::string > waiting;  //!< queries read, not answered yet
+        bool busy;                          //!< a task of the pool answers its queries
+        bool closed;                        //!< not read any more, the descriptor is closed once busy ends
+    };
+
+    /*!
+     * \brief read_client reads what a client sent, and queues its whole queries
+     * Only the accepting thread reads; a client has one query at a time on the pool.
+     * \param fd
+     * \param queries
+     */
+    inline void read_client( const int fd, TaskGroup & queries )
+    {
+        char chunk[ 4096 ];
+        const ssize_t got = ::read( fd, chunk, sizeof( chunk ) );
+        if ( ( got < 0 ) && ( EINTR == errno ) ) {
+            return;
+        }
+        std::lock_guard< std::mutex > lock( _clients_mutex );
+        const auto entry = _clients.find( fd );
+        if ( ( _clients.end() == entry ) || entry->second.closed ) {
+            return;
+        }
+        Client & client = entry->second;
+        if ( got <= 0 ) {
+            // The queries sent before leaving are still answered
+            client.closed = true;
+            if ( ! client.busy ) {
+                ::close( fd );
+                _clients.erase( entry );
+            }
+            return;
+        }
+        client.buffered.append( chunk, got );
+        std::size_t line_end;
+        while ( std::string::npos != ( line_end = client.buffered.find( '\n' ) ) ) {
+            client.waiting.push_back( client.buffered.substr( 0, line_end ) );
+            client.buffered.erase( 0, line_end + 1 );
+        }
+        if ( ! client.busy && ! client.waiting.empty() ) {
+            client.busy = true;
+            queries.run( [this, fd, &queries] { answer_client( fd, queries ); } );
+        }
+    }
+
+    /*!
+     * \brief answer_client answers the first query a client has waiting, and hands the next one to the pool
+     * \param fd
+     * \param queries
+     */
+    inline void answer_client( const int fd, TaskGroup & queries )
+    {
+        std::string line;
+        {
+            std::lock_guard< std::mutex > lock( _clients_mutex );
+            Client & client = _clients.find( fd )->second;
+            line.swap( client.waiting.front() );
+            client.waiting.pop_front();
+        }
+        bool more = true;
+        try {
+            more = answer( line, fd );
+            if ( ! more ) {
+                // quit on the socket stops the server
+                stop();
+            }
+        }
+        catch ( const std::runtime_error & ) {
+            // The client left while its answer was written
+            more = false;
+        }
+        std::lock_guard< std::mutex > lock( _clients_mutex );
+        const auto entry = _clients.find( fd );
+        Client & client = entry->second;
+        if ( ! more ) {
+            client.closed = true;
+            client.waiting.clear();
+        }
+        if ( ! client.waiting.empty() ) {
+            queries.run( [this, fd, &queries] { answer_client( fd, queries ); } );
+            return;
+        }
+        client.busy = false;
+        if ( client.closed ) {
+            ::close( fd );
+            _clients.erase( entry );
+        }
+    }
+
+    /*!
+     * \brief stop_fd
+     * \return the end of the pipe that stops listen, -1 when it does not run
+     */
+    static int & stop_fd()
+    {
+        static int fd = -1;
+        return fd;
+    }
+
+    /*!
+     * \brief stop wakes listen to stop
+     */
+    static void stop()
+    {
+        const int fd = stop_fd();
+        if ( -1 != fd ) {
+            const char byte = 0;
+            const ssize_t written = ::write( fd, &byte, 1 );
+            static_cast< void >( written );
+        }
+    }
+
+    /*!
+     * \brief on_stop_signal
+     */
+    static void on_stop_signal( int )
+    {
+        const int saved_errno = errno;
+        stop();
+        errno = saved_errno;
+    }
+
+    /*!
+     * \brief read_query
+     * \param tokens after "mine"
+     * \return
+     */
+    inline MiningQuery read_query( std::istringstream & tokens ) const
+    {
+        MiningQuery query( _defaults );
+        std::string min_sup;
+        if ( ! ( tokens >> query.database >> min_sup ) ) {
+            throw std::invalid_argument( "usage: mine database min_sup [--min-len N] [--max-len N] [--top-k K] [--order support|diffset|frequency]" );
+        }
+        query.min_sup = read_positive( "min_sup", min_sup );
+        std::string option;
+        while ( tokens >> option ) {
+            std::string value;
+            if ( ! ( tokens >> value ) ) {
+                throw std::invalid_argument( option + " needs a value" );
+            }
+            if ( option == "--min-len" ) {
+                query.bounds.min_len = read_positive( option, value );
+            }
+            else if ( option == "--max-len" ) {
+                query.bounds.max_len = read_positive( option, value );
+            }
+            else if ( option == "--top-k" ) {
+                query.bounds.top_k = read_positive( option, value );
+            }
+            else if ( option == "--order" ) {
+                if ( value == "support" ) {
+                    query.order = SiblingOrder::Support;
+                }
+                else if ( value == "diffset" ) {
+                    query.order = SiblingOrder::DiffsetSize;
+                }
+                else if ( value == "frequency" ) {
+                    query.order = SiblingOrder::ItemFrequency;
+                }
+                else {
+                    throw std::invalid_argument( "--order must be support, diffset or frequency" );
+                }
+            }
+            else {
+                throw std::invalid_argument( "unknown option " + option );
+            }
+        }
+        if ( ! within_length( query.bounds.min_len, query.bounds.max_len ) ) {
+            throw std::invalid_argument( "--min-len must not exceed --max-len" );
+        }
+        return query;
+    }
+
+    /*!
+     * \brief read_positive
+     * \param name
+     * \param value
+     * \return
+     */
+    static unsigned int read_positive( const std::string & name, const std::string & value )
+    {
+        std::istringstream stream( value );
+        long long number = 0;
+        if ( ! ( stream >> number ) || ! stream.eof() || ( number < 1 ) || ( number > std::numeric_limits< unsigned int >::max() ) ) {
+            throw std::invalid_argument( name + " must be a positive number" );
+        }
+        return number;
+    }
+
+    /*!
+     * \brief mine writes the generators of query to sink, from the cache if it holds them
+     * \param query
+     * \param sink
+     */
+    inline void mine( const MiningQuery & query, GeneratorSink & sink )
+    {
+        const auto database = _databases.find( query.database );
+        if ( _databases.cend() == database ) {
+            throw std::invalid_argument( "unknown database " + query.database );
+        }
+        const std::string key = query.key();
+        if ( const ResultCache::result_type cached = _cache.find( key ) ) {
+            cached->for_each( [&sink]( const Item * first, const Item * last, const unsigned int support ) {
+                sink( first, last, support );
+            } );
+            return;
+        }
+        const VerticalDatabase & vertical = *database->second;
+        std::shared_ptr< GeneratorList > result( new GeneratorList( &sink ) );
+        bool use_bitmap = ( DiffsetRepresentation::Bitmap == _representation );
+        if ( DiffsetRepresentation::Auto == _representation ) {
+            use_bitmap = Talky_G::prefer_bitmap( vertical, query.min_sup );
+        }
+        if ( use_bitmap ) {
+            mine< BitDiffset >( vertical, query, *result );
+        }
+        else {
+            mine< Diffset >( vertical, query, *result );
+        }
+        result->forward_to( nullptr );
+        _cache.insert( key, result );
+    }
+
+    /*!
+     * \brief The QueryMiner struct
+     * Arguments of a query's run, with the item type with_item_type picks.
+     */
+    struct QueryMiner
+    {
+        template < typename diffset_type, typename item_type >
+        void run() const
+        {
+            Talky_G::talky_g< diffset_type, item_type >( vertical, query.min_sup, sink, query.order, CheckpointSettings(), query.bounds );
+        }
+
+        const VerticalDatabase & vertical;
+        const MiningQuery & query;
+        GeneratorSink & sink;
+    };
+
+    template < typename diffset_type >
+    /*!
+     * \brief mine
+     * \param vertical
+     * \param query
+     * \param sink
+     */
+    static void mine( const VerticalDatabase & vertical, const MiningQuery & query, GeneratorSink & sink )
+    {
+        const QueryMiner miner = { vertical, query, sink };
+        Talky_G::with_item_type< diffset_type >( vertical, miner );
+    }
+
+    const unsigned int _n_threads;
+    ResultCache _cache;
+    std::mutex _clients_mutex;
+    std::map< int, Client > _clients; //!< connections of listen, by descriptor
+    const MiningQuery _defaults;
+    const DiffsetRepresentation _representation;
+    std::map< std::string, std::unique_ptr< VerticalDatabase > > _databases;
+};
+
+#endif // MININGSERVER_HPP
@@ -2,40 +2,61 @@
 #define NODE_HPP
 
 #include "Itemset.hpp"
+#include "ItemMask.hpp"
 #include "Tidset.hpp"
 #include "Diffset.hpp"
+#include "SetKernels.hpp"
 
-#include <memory>
+/*!
+ * \brief The SiblingOrder enum
+ * Order of the children of a node, the order in which their subtrees are
+ * joined and mined.
+ */
+enum class SiblingOrder
+{
+    Support,        //!< ascending support
+    DiffsetSize,    //!< ascending diffset size
+    ItemFrequency   //!< ascending frequency of the items, compared as itemsets of dense ids
+};
 
+template < typename diffset_type, typename item_type = Item >
 /*!
- * \brief The Node class
+ * \brief The BasicNode class
+ * item_type is the type the itemset stores its items in; a SmallItem
+ * makes the itemset a bitmask. The tids a node holds are its diffset
+ * against its parent or, when is_tidset(), its tidset; both are kept in
+ * diffset().
  */
-class Node
+class BasicNode
 {
 public:
+    typedef typename ItemTraits< item_type >::itemset_type itemset_type;
+
     /*!
-     * \brief Node
+     * \brief BasicNode
      */
-    Node() :
-        _itemset( Itemset() ),
-        _diffset( Diffset() ),
+    BasicNode() :
+        _itemset( itemset_type() ),
+        _diffset( diffset_type() ),
         _parent( nullptr ),
         _is_erased( false ),
+        _is_tidset( false ),
         _sup( 0 ),
         _hash_key_setted( false ),
         _hashkey( 0 ) {}
 
     /*!
-     * \brief Node
+     * \brief BasicNode
      * \param rv_itemset
      * \param rv_diffset
      * \param parent_ptr
      */
-    Node(Itemset && rv_itemset, Diffset && rv_diffset, const Node * parent_ptr) :
+    BasicNode(itemset_type && rv_itemset, diffset_type && rv_diffset, const BasicNode * parent_ptr) :
         _itemset( std::move(rv_itemset) ),
         _diffset( std::move(rv_diffset) ),
         _parent( parent_ptr ),
         _is_erased( false ),
+        _is_tidset( false ),
         _sup( 0 ),
         _hash_key_setted( false ),
         _hashkey( 0 ) {
@@ -44,16 +65,17 @@ public:
     }
 
     /*!
-     * \brief Node
+     * \brief BasicNode
      * \param itemset
      * \param diffset
      * \param parent_ptr
      */
-    Node(const Itemset & itemset, const Diffset & diffset, const Node * parent_ptr) :
+    BasicNode(const itemset_type & itemset, const diffset_type & diffset, const BasicNode * parent_ptr) :
         _itemset( itemset ),
         _diffset( diffset ),
         _parent( parent_ptr ),
         _is_erased( false ),
+        _is_tidset( false ),
         _sup( 0 ),
         _hash_key_setted( false ),
         _hashkey( 0 ) {
@@ -62,86 +84,103 @@ public:
     }
 
     /*!
-     * \brief Node
+     * \brief BasicNode
      * \param itemset
      * \param diffset
      * \param sup
      * \param hash
      */
-    Node(const Itemset & itemset, const Diffset & diffset, const unsigned int sup, const unsigned int hash) :
+    BasicNode(const itemset_type & itemset, const diffset_type & diffset, const unsigned int sup, const unsigned int hash) :
         _itemset( itemset ),
         _diffset( diffset ),
         _parent( nullptr ),
         _is_erased( false ),
+        _is_tidset( false ),
         _sup( sup ),
         _hash_key_setted( true ),
         _hashkey( hash ) {
     }
 
     /*!
-     * \brief Node
+     * \brief BasicNode
      * \param r_node
      */
-    Node(const Node & r_node) :
+    BasicNode(const BasicNode & r_node) :
         _itemset( r_node.itemset() ),
         _diffset( r_node.diffset() ),
         _parent( r_node.parent() ),
         _children( r_node.children() ),
         _is_erased( r_node.is_erased() ),
+        _is_tidset( r_node.is_tidset() ),
         _sup( r_node.sup() ),
         _hash_key_setted( true ),
         _hashkey( r_node.hashkey() ) {}
 
     /*!
-     * \brief Node
+     * \brief BasicNode
      * \param m_node
      */
-    Node(Node && m_node) :
+    BasicNode(BasicNode && m_node) :
         _itemset( std::move( m_node.itemset() ) ),
         _diffset( std::move( m_node.diffset() ) ),
         _parent( m_node.parent() ),
         _children( std::move( m_node.children() ) ),
         _is_erased( m_node.is_erased() ),
+        _is_tidset( m_node.is_tidset() ),
         _sup( m_node.sup() ),
         _hash_key_setted( true ),
         _hashkey( m_node.hashkey() ) {
     }
 
-    Node & operator = ( const Node & r_node ) = delete;
+    BasicNode & operator = ( const BasicNode & r_node ) = delete;
 
     /*!
-     * \brief add_child
-     * \param node_ref
+     * \brief add_child appends a child, order_children sorts them once all are added
+     * \param node_ptr child already attached to this node
      */
-    inline void add_child(const Node & node_ref )
+    inline void add_child(BasicNode * node_ptr)
     {
-        std::shared_ptr< Node > node( new Node( node_ref ) );
-        node->set_parent( this );
-        _children.push_back( node );
-        std::sort( _children.begin(), _children.end(), [] ( std::shared_ptr< Node > ch1, std::shared_ptr< Node > ch2 ) {
-            return ( ch1->sup() < ch2->sup() ); // Sup
-        } );
+        _children.push_back( node_ptr );
     }
 
     /*!
-     * \brief add_child
-     * \param itemset
-     * \param diffset
+     * \brief order_children
+     * \param order
      */
-    inline void add_child(Itemset && itemset, Diffset && diffset)
+    inline void order_children(const SiblingOrder order = SiblingOrder::Support)
     {
-        std::shared_ptr< Node > node( new Node( itemset, diffset, this ) );
-        _children.push_back( node );
-        std::sort( _children.begin(), _children.end(), [] ( std::shared_ptr< Node > ch1, std::shared_ptr< Node > ch2 ) {
-            return ( ch1->sup() < ch2->sup() ); // Sup
-        } );
+        switch ( order ) {
+        case SiblingOrder::Support:
+            std::stable_sort( _children.begin(), _children.end(), [] ( const BasicNode * ch1, const BasicNode * ch2 ) {
+                return ( ch1->sup() < ch2->sup() ); // Sup
+            } );
+            break;
+        case SiblingOrder::DiffsetSize:
+            std::stable_sort( _children.begin(), _children.end(), [] ( const BasicNode * ch1, const BasicNode * ch2 ) {
+                return ( ch1->diffset_size() < ch2->diffset_size() );
+            } );
+            break;
+        case SiblingOrder::ItemFrequency:
+            std::stable_sort( _children.begin(), _children.end(), [] ( const BasicNode * ch1, const BasicNode * ch2 ) {
+                return std::lexicographical_compare( ch1->itemset().cbegin(), ch1->itemset().cend(), ch2->itemset().cbegin(), ch2->itemset().cend() );
+            } );
+            break;
+        }
+    }
+
+    /*!
+     * \brief clear_children forgets the children, their nodes belong to a NodeRegion
+     */
+    inline void clear_children()
+    {
+        _children.clear();
     }
 
     /*!
      * \brief children
      * \return
      */
-    inline const std::vector< std::shared_ptr < Node > > & children() const
+    inline const std::vector< BasicNode * > & children() const
     {
         return _children;
     }
@@ -150,16 +189,41 @@ public:
      * \brief children_ref
      * \return
      */
-    inline std::vector< std::shared_ptr < Node > > & children_ref()
+    inline std::vector< BasicNode * > & children_ref()
     {
         return _children;
     }
 
+    /*!
+     * \brief recycle resets a node taken from a NodeRegion, keeping the capacity of its containers
+     */
+    inline void recycle()
+    {
+        _parent = nullptr;
+        _children.clear();
+        _is_erased = false;
+        _is_tidset = false;
+        _sup = 0;
+        _hash_key_setted = false;
+        _hashkey = 0;
+    }
+
+    /*!
+     * \brief attach computes support and hashkey of the itemset and tids filled in place
+     * \param parent_ptr
+     */
+    inline void attach(const BasicNode * parent_ptr)
+    {
+        _parent = parent_ptr;
+        calculate_support();
+        calculate_hashkey();
+    }
+
     /*!
      * \brief parent
      * \return
      */
-    inline const Node * parent() const
+    inline const BasicNode * parent() const
     {
         return _parent;
     }
@@ -168,7 +232,7 @@ public:
      * \brief set_parent
      * \param parent_ptr
      */
-    inline void set_parent(const Node *parent_ptr)
+    inline void set_parent(const BasicNode *parent_ptr)
     {
         _parent = parent_ptr;
     }
@@ -177,7 +241,7 @@ public:
      * \brief itemset
      * \return
      */
-    inline const Itemset & itemset() const
+    inline const itemset_type & itemset() const
     {
         return _itemset;
     }
@@ -186,7 +250,7 @@ public:
      * \brief itemset
      * \return
      */
-    inline Itemset & itemset()
+    inline itemset_type & itemset()
     {
         return _itemset;
     }
@@ -222,7 +286,7 @@ public:
      * \param r_node
      * \return
      */
-    inline bool equal(const Node & r_node) const
+    inline bool equal(const BasicNode & r_node) const
     {
         const auto r_mist = r_node.mistakes( _diffset );
         const auto mist = mistakes( r_node.diffset() );
@@ -239,7 +303,7 @@ public:
      * \param r_node
      * \return
      */
-    inline bool is_superset_of(const Node r_node) const
+    inline bool is_superset_of(const BasicNode r_node) const
     {
         const auto r_mist = r_node.mistakes( _diffset );
         const auto mist = mistakes( r_node.diffset() );
@@ -250,25 +314,55 @@ public:
      * \brief diffset
      * \return
      */
-    inline const Diffset & diffset() const
+    inline const diffset_type & diffset() const
+    {
+        return _diffset;
+    }
+
+    /*!
+     * \brief diffset
+     * \return
+     */
+    inline diffset_type & diffset()
     {
         return _diffset;
     }
 
+    /*!
+     * \brief is_tidset
+     * \return true if diffset() holds the tidset of the node
+     */
+    inline bool is_tidset() const
+    {
+        return _is_tidset;
+    }
+
+    /*!
+     * \brief set_tidset
+     * \param is_tidset whether diffset() holds a tidset, set before attach
+     */
+    inline void set_tidset(const bool is_tidset)
+    {
+        _is_tidset = is_tidset;
+    }
+
+    /*!
+     * \brief diffset_size
+     * \return size of the diffset against the parent, whichever form is held
+     */
+    inline std::size_t diffset_size() const
+    {
+        return _is_tidset ? ( _parent->sup() - _sup ) : _diffset.size();
+    }
+
     /*!
      * \brief mistakes
      * \param other
      * \return
      */
-    inline unsigned int mistakes(const Diffset & other) const
+    inline unsigned int mistakes(const diffset_type & other) const
     {
-        unsigned int mistake_counter = 0;
-        for ( const auto & tid : other ) {
-            if ( _diffset.cend() == std::find( _diffset.cbegin(), _diffset.cend(), tid ) ) {
-                mistake_counter ++;
-            }
-        }
-        return mistake_counter;
+        return count_mistakes( _diffset, other );
     }
 
     /*!
@@ -296,7 +390,7 @@ private:
      */
     inline void calculate_support()
     {
-        _sup = _parent->sup() - _diffset.size();
+        _sup = _is_tidset ? _diffset.size() : ( _parent->sup() - _diffset.size() );
     }
 
     /*!
@@ -304,36 +398,44 @@ private:
      */
     inline void calculate_hashkey()
     {
-        _hashkey = diffset_hash::hash( std::make_pair( _diffset, _parent->hashkey() ) );
+        // The hashkey of an itemset is the sum of its tids
+        _hashkey = _is_tidset ? tid_sum( _diffset ) : diffset_hash::hash( _diffset, _parent->hashkey() );
         _hash_key_setted = true;
     }
 
 private:
-    Itemset _itemset;
-    Diffset _diffset;
-    const Node * _parent;
-    std::vector < std::shared_ptr < Node > > _children;
+    itemset_type _itemset;
+    diffset_type _diffset;
+    const BasicNode * _parent;
+    std::vector < BasicNode * > _children;
     bool _is_erased;
+    bool _is_tidset;
     unsigned int _sup;
     bool _hash_key_setted;
     int _hashkey;
 };
 
+/*!
+ * \brief Node
+ */
+typedef BasicNode< Diffset > Node;
+
+template < typename diffset_type, typename item_type >
 /*!
  * \brief operator <<
  * \param os
  * \param node
  * \return
  */
-inline std::ostream & operator << ( std::ostream & os, const Node & node )
+inline std::ostream & operator << ( std::ostream & os, const BasicNode< diffset_type, item_type > & node )
 {
     os << "Node: ";
     os << "Itemset: ";
     unsigned int index = node.itemset().size();
     if ( index ) {
         os << '(';
-        std::for_each( node.itemset().cbegin(), node.itemset().cend(), [&]( const Item & item ) {
-            os << item << ( --index ? ' ' : ')' );
+        std::for_each( node.itemset().cbegin(), node.itemset().cend(), [&]( const item_type & item ) {
+            os << +item << ( --index ? ' ' : ')' );
         } );
     }
     os << " Diffset: ";
@@ -0,0 +1,199 @@
+#ifndef NODEARENA_HPP
+#define NODEARENA_HPP
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+template < typename node_type >
+/*!
+ * \brief The NodeRegion class
+ * Nodes of one depth of the search tree. Slots are never freed: a reset
+ * region hands out the same nodes again, and their itemsets, diffsets and
+ * children keep the capacity they grew to, so after warming up the
+ * traversal allocates almost nothing.
+ */
+class NodeRegion
+{
+public:
+    /*!
+     * \brief NodeRegion
+     */
+    NodeRegion() :
+        _used( 0 ) {}
+
+    NodeRegion( const NodeRegion & ) = delete;
+    NodeRegion & operator = ( const NodeRegion & ) = delete;
+
+    /*!
+     * \brief acquire
+     * \return a recycled node
+     */
+    inline node_type & acquire()
+    {
+        if ( _used == _slots.size() ) {
+            _slots.emplace_back();
+        }
+        node_type & node = _slots[ _used ++ ];
+        node.recycle();
+        return node;
+    }
+
+    /*!
+     * \brief release_last gives back the node returned by the last acquire
+     */
+    inline void release_last()
+    {
+        -- _used;
+    }
+
+    /*!
+     * \brief reset gives back every node of the region
+     */
+    inline void reset()
+    {
+        _used = 0;
+    }
+
+    /*!
+     * \brief release gives back every node of the region and the memory they hold
+     */
+    inline void release()
+    {
+        std::deque < node_type >().swap( _slots );
+        _used = 0;
+    }
+
+    /*!
+     * \brief size
+     * \return nodes in use
+     */
+    inline std::size_t size() const
+    {
+        return _used;
+    }
+
+    /*!
+     * \brief capacity
+     * \return nodes ever allocated
+     */
+    inline std::size_t capacity() const
+    {
+        return _slots.size();
+    }
+
+private:
+    std::deque < node_type > _slots;
+    std::size_t _used;
+};
+
+template < typename node_type >
+/*!
+ * \brief The NodeArena class
+ * One region per depth. The children of a node at depth d live in region
+ * d + 1, which the depth-first traversal resets as soon as that node's
+ * subtree is done, so only the current path and its siblings are alive.
+ */
+class NodeArena
+{
+public:
+    NodeArena() {}
+
+    NodeArena( const NodeArena & ) = delete;
+    NodeArena & operator = ( const NodeArena & ) = delete;
+
+    /*!
+     * \brief region
+     * \param depth
+     * \return
+     */
+    inline NodeRegion< node_type > & region( const unsigned int depth )
+    {
+        while ( _regions.size() <= depth ) {
+            _regions.emplace_back();
+        }
+        return _regions[ depth ];
+    }
+
+    /*!
+     * \brief capacity
+     * \return nodes ever allocated over all depths
+     */
+    inline std::size_t capacity() const
+    {
+        std::size_t capacity = 0;
+        for ( const auto & region : _regions ) {
+            capacity += region.capacity();
+        }
+        return capacity;
+    }
+
+private:
+    std::deque < NodeRegion< node_type > > _regions;
+};
+
+template < typename node_type >
+/*!
+ * \brief The NodeArenaPool class
+ * Arenas of concurrent tasks. A task takes an arena for the subtree it
+ * mines and gives it back when the subtree is done; arenas are reused by
+ * later tasks together with the memory they hold.
+ */
+class NodeArenaPool
+{
+public:
+    typedef NodeArena< node_type > arena_type;
+
+    NodeArenaPool() {}
+
+    NodeArenaPool( const NodeArenaPool & ) = delete;
+    NodeArenaPool & operator = ( const NodeArenaPool & ) = delete;
+
+    /*!
+     * \brief acquire
+     * \return
+     */
+    inline std::unique_ptr< arena_type > acquire()
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        if ( _free.empty() ) {
+            return std::unique_ptr< arena_type >( new arena_type() );
+        }
+        std::unique_ptr< arena_type > arena( std::move( _free.back() ) );
+        _free.pop_back();
+        return arena;
+    }
+
+    /*!
+     * \brief release
+     * \param arena
+     */
+    inline void release( std::unique_ptr< arena_type > && arena )
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _free.push_back( std::move( arena ) );
+    }
+
+private:
+    std::mutex _mutex;
+    std::vector < std::unique_ptr< arena_type > > _free;
+};
+
+template < typename node_type >
+/*!
+ * \brief The TraversalFrame struct
+ * A node of the path the depth-first traversal is on, and how many of its
+ * children are still to be mined. Children are mined from the last one.
+ */
+struct TraversalFrame
+{
+    TraversalFrame( node_type * node, const std::size_t next ) :
+        node( node ),
+        next( next ) {}
+
+    node_type * node;
+    std::size_t next;
+};
+
+#endif // NODEARENA_HPP
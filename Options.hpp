@@ -0,0 +1,454 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "BufferedWriter.hpp"
+#include "Checkpoint.hpp"
+#include "Node.hpp"
+#include "OutOfCore.hpp"
+#include "SearchBounds.hpp"
+#include "ShardMerge.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/*!
+ * \brief The DiffsetRepresentation enum
+ */
+enum class DiffsetRepresentation
+{
+    Auto,
+    Vector,
+    Bitmap
+};
+
+/*!
+ * \brief The OutputFormat enum
+ */
+enum class OutputFormat
+{
+    Text,
+    Binary
+};
+
+/*!
+ * \brief The Options struct
+ */
+struct Options
+{
+    /*!
+     * \brief Options
+     */
+    Options() :
+        min_sup( 0 ),
+        n_threads( 1 ),
+        diffset_representation( DiffsetRepresentation::Auto ),
+        cset_report( false ),
+        output_format( OutputFormat::Text ),
+        write_mode( WriteMode::Buffered ),
+        to_text( false ),
+        sibling_order( SiblingOrder::Support ),
+        append( false ),
+        serve( false ),
+        cache_size( 16 ),
+        merge( false ) {}
+
+    unsigned int min_sup;
+    std::string database_filename;
+    std::string result_filename;
+    unsigned int n_threads;
+    DiffsetRepresentation diffset_representation;
+    bool cset_report;
+    OutputFormat output_format;
+    WriteMode write_mode;
+    bool to_text;
+    std::string db_cache;
+    SiblingOrder sibling_order;
+    CheckpointSettings checkpoint;
+    std::string stats_filename;
+    SearchBounds bounds;
+    std::vector < unsigned int > sweep; //!< minimal supports of a sweep, ascending; min_sup is the first
+    std::string state;                   //!< prefix of the files of an incremental run
+    bool append;                         //!< the input holds new transactions for the state
+    OutOfCoreSettings out_of_core;
+    bool serve;                          //!< answer queries against databases instead of mining one
+    std::vector < std::string > databases; //!< loaded by a server
+    std::string socket;                  //!< Unix socket of a server, empty to read queries from stdin
+    unsigned int cache_size;             //!< results a server keeps
+    ShardSettings shard;
+    bool merge;                          //!< combine the results of shards instead of mining
+    std::vector < std::string > shard_results; //!< combined by a merge
+    std::string closures;                //!< closed itemsets of the generators, their indexes in closures.map
+};
+
+/*!
+ * \brief The OptionsReader class
+ */
+class OptionsReader
+{
+public:
+    /*!
+     * \brief operator ()
+     * \param argc
+     * \param argv
+     * \param options
+     * \return false if the command line does not match the usage
+     */
+    inline bool operator ()( int argc, const char * argv[], Options & options ) const
+    {
+        std::vector < std::string > positional;
+        unsigned int memory_budget = 0;
+        for ( int index = 1; index < argc; ++ index ) {
+            const std::string arg( argv[ index ] );
+            if ( arg == "--threads" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const int n_threads = std::stoi( argv[ index ] );
+                if ( n_threads < 1 ) {
+                    throw std::invalid_argument( "--threads must be positive" );
+                }
+                options.n_threads = n_threads;
+            }
+            else if ( arg == "--diffset" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const std::string representation( argv[ index ] );
+                if ( representation == "auto" ) {
+                    options.diffset_representation = DiffsetRepresentation::Auto;
+                }
+                else if ( representation == "vector" ) {
+                    options.diffset_representation = DiffsetRepresentation::Vector;
+                }
+                else if ( representation == "bitmap" ) {
+                    options.diffset_representation = DiffsetRepresentation::Bitmap;
+                }
+                else {
+                    throw std::invalid_argument( "--diffset must be auto, vector or bitmap" );
+                }
+            }
+            else if ( arg == "--cset-report" ) {
+                options.cset_report = true;
+            }
+            else if ( arg == "--format" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const std::string format( argv[ index ] );
+                if ( format == "text" ) {
+                    options.output_format = OutputFormat::Text;
+                }
+                else if ( format == "binary" ) {
+                    options.output_format = OutputFormat::Binary;
+                }
+                else {
+                    throw std::invalid_argument( "--format must be text or binary" );
+                }
+            }
+            else if ( arg == "--write" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const std::string mode( argv[ index ] );
+                if ( mode == "buffered" ) {
+                    options.write_mode = WriteMode::Buffered;
+                }
+                else if ( mode == "direct" ) {
+                    options.write_mode = WriteMode::Direct;
+                }
+                else if ( mode == "mmap" ) {
+                    options.write_mode = WriteMode::Mmap;
+                }
+                else {
+                    throw std::invalid_argument( "--write must be buffered, direct or mmap" );
+                }
+            }
+            else if ( arg == "--db-cache" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.db_cache = argv[ index ];
+            }
+            else if ( arg == "--order" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const std::string order( argv[ index ] );
+                if ( order == "support" ) {
+                    options.sibling_order = SiblingOrder::Support;
+                }
+                else if ( order == "diffset" ) {
+                    options.sibling_order = SiblingOrder::DiffsetSize;
+                }
+                else if ( order == "frequency" ) {
+                    options.sibling_order = SiblingOrder::ItemFrequency;
+                }
+                else {
+                    throw std::invalid_argument( "--order must be support, diffset or frequency" );
+                }
+            }
+            else if ( arg == "--checkpoint" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.checkpoint.filename = argv[ index ];
+            }
+            else if ( arg == "--checkpoint-interval" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const int interval = std::stoi( argv[ index ] );
+                if ( interval < 0 ) {
+                    throw std::invalid_argument( "--checkpoint-interval must not be negative" );
+                }
+                options.checkpoint.interval = interval;
+            }
+            else if ( arg == "--stats" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.stats_filename = argv[ index ];
+            }
+            else if ( arg == "--max-len" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.bounds.max_len = read_positive( "--max-len", argv[ index ] );
+            }
+            else if ( arg == "--min-len" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.bounds.min_len = read_positive( "--min-len", argv[ index ] );
+            }
+            else if ( arg == "--top-k" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.bounds.top_k = read_positive( "--top-k", argv[ index ] );
+            }
+            else if ( arg == "--sweep" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                std::istringstream supports( argv[ index ] );
+                std::string support;
+                while ( std::getline( supports, support, ',' ) ) {
+                    options.sweep.push_back( read_positive( "--sweep", support.c_str() ) );
+                }
+                if ( options.sweep.empty() ) {
+                    throw std::invalid_argument( "--sweep needs at least one support" );
+                }
+                std::sort( options.sweep.begin(), options.sweep.end() );
+                options.sweep.erase( std::unique( options.sweep.begin(), options.sweep.end() ), options.sweep.end() );
+            }
+            else if ( arg == "--state" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.state = argv[ index ];
+            }
+            else if ( arg == "--append" ) {
+                options.append = true;
+            }
+            else if ( arg == "--out-of-core" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.out_of_core.directory = argv[ index ];
+            }
+            else if ( arg == "--memory-budget" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                memory_budget = read_positive( "--memory-budget", argv[ index ] );
+            }
+            else if ( arg == "--serve" ) {
+                options.serve = true;
+            }
+            else if ( arg == "--socket" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.socket = argv[ index ];
+            }
+            else if ( arg == "--cache" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                const int cache_size = std::stoi( argv[ index ] );
+                if ( cache_size < 0 ) {
+                    throw std::invalid_argument( "--cache must not be negative" );
+                }
+                options.cache_size = cache_size;
+            }
+            else if ( arg == "--shard" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                // index/count
+                const std::string shard( argv[ index ] );
+                const std::size_t slash = shard.find( '/' );
+                if ( std::string::npos == slash ) {
+                    throw std::invalid_argument( "--shard must be index/count" );
+                }
+                options.shard.count = read_positive( "--shard count", shard.substr( slash + 1 ).c_str() );
+                const int shard_index = std::stoi( shard.substr( 0, slash ) );
+                if ( ( shard_index < 0 ) || ( unsigned( shard_index ) >= options.shard.count ) ) {
+                    throw std::invalid_argument( "--shard index must be below its count" );
+                }
+                options.shard.index = shard_index;
+            }
+            else if ( arg == "--merge" ) {
+                options.merge = true;
+            }
+            else if ( arg == "--closures" ) {
+                if ( ++ index == argc ) {
+                    return false;
+                }
+                options.closures = argv[ index ];
+            }
+            else if ( arg == "--resume" ) {
+                options.checkpoint.resume = true;
+            }
+            else if ( arg == "--to-text" ) {
+                options.to_text = true;
+            }
+            else {
+                positional.push_back( arg );
+            }
+        }
+        if ( options.to_text ) {
+            // Conversion of a binary result: input.bin output.res
+            if ( positional.size() != 2 ) {
+                return false;
+            }
+            options.database_filename = positional.at( 0 );
+            options.result_filename = positional.at( 1 );
+            return true;
+        }
+        if ( options.merge ) {
+            // A merge of the results of every shard: output.res shard.res ...
+            if ( positional.size() < 2 ) {
+                return false;
+            }
+            if ( options.bounds.top_k ) {
+                throw std::invalid_argument( "--merge cannot be combined with --top-k" );
+            }
+            options.result_filename = positional.front();
+            options.shard_results.assign( positional.cbegin() + 1, positional.cend() );
+            return true;
+        }
+        if ( options.serve ) {
+            // A server loads every database given: input.dat ...
+            if ( positional.empty() ) {
+                return false;
+            }
+            if ( options.checkpoint.enabled() || ! options.state.empty() || options.out_of_core.enabled() || ! options.sweep.empty() || options.shard.enabled()
+                 || ! options.closures.empty() ) {
+                throw std::invalid_argument( "--serve cannot be combined with --checkpoint, --state, --out-of-core, --sweep, --shard or --closures" );
+            }
+            options.databases = positional;
+            return true;
+        }
+        if ( ! options.socket.empty() ) {
+            throw std::invalid_argument( "--socket needs --serve" );
+        }
+        if ( positional.size() != ( options.sweep.empty() ? 3 : 2 ) ) {
+            return false;
+        }
+        if ( options.checkpoint.resume && ! options.checkpoint.enabled() ) {
+            throw std::invalid_argument( "--resume needs --checkpoint" );
+        }
+        if ( options.checkpoint.enabled() && ( options.n_threads > 1 ) ) {
+            throw std::invalid_argument( "--checkpoint needs --threads 1" );
+        }
+        if ( ! within_length( options.bounds.min_len, options.bounds.max_len ) ) {
+            throw std::invalid_argument( "--min-len must not exceed --max-len" );
+        }
+        if ( options.append && options.state.empty() ) {
+            throw std::invalid_argument( "--append needs --state" );
+        }
+        if ( ! options.state.empty() ) {
+            // The state holds every generator
+            if ( options.bounds.top_k || options.bounds.min_len || options.bounds.max_len || ! options.sweep.empty() ) {
+                throw std::invalid_argument( "--state cannot be combined with --top-k, --min-len, --max-len or --sweep" );
+            }
+            if ( options.append && options.checkpoint.enabled() ) {
+                throw std::invalid_argument( "--append cannot be combined with --checkpoint" );
+            }
+        }
+        if ( memory_budget ) {
+            if ( ! options.out_of_core.enabled() ) {
+                throw std::invalid_argument( "--memory-budget needs --out-of-core" );
+            }
+            options.out_of_core.memory_budget = std::size_t( memory_budget ) << 20;
+        }
+        if ( options.out_of_core.enabled()
+             && ( ( options.n_threads > 1 ) || options.checkpoint.enabled() || ! options.state.empty() || ! options.db_cache.empty() ) ) {
+            throw std::invalid_argument( "--out-of-core cannot be combined with --threads, --checkpoint, --state or --db-cache" );
+        }
+        if ( options.shard.enabled() ) {
+            // The merge needs every generator of the shards, however short
+            if ( ( options.n_threads > 1 ) || options.checkpoint.enabled() || ! options.state.empty() || options.out_of_core.enabled()
+                 || ! options.sweep.empty() || options.bounds.top_k || options.bounds.min_len ) {
+                throw std::invalid_argument( "--shard cannot be combined with --threads, --checkpoint, --state, --out-of-core, --sweep, --top-k or --min-len" );
+            }
+        }
+        if ( ! options.closures.empty() ) {
+            // Closures follow the serial traversal level by level, and are written with the generators
+            if ( ( options.n_threads > 1 ) || options.checkpoint.enabled() || ! options.state.empty() || options.out_of_core.enabled()
+                 || options.shard.enabled() || ! options.sweep.empty() || options.bounds.top_k || ( SiblingOrder::DiffsetSize == options.sibling_order ) ) {
+                throw std::invalid_argument( "--closures cannot be combined with --threads, --checkpoint, --state, --out-of-core, --shard, --sweep, --top-k or --order diffset" );
+            }
+        }
+        if ( ! options.sweep.empty() ) {
+            // A sweep mines once at its lowest support: input.dat output.res
+            if ( options.bounds.top_k ) {
+                throw std::invalid_argument( "--sweep cannot be combined with --top-k" );
+            }
+            options.min_sup = options.sweep.front();
+            options.database_filename = positional.at( 0 );
+            options.result_filename = positional.at( 1 );
+            return true;
+        }
+        options.min_sup = std::stoi( positional.at( 0 ) );
+        options.database_filename = positional.at( 1 );
+        options.result_filename = positional.at( 2 );
+        return true;
+    }
+
+    /*!
+     * \brief read_options
+     * \param argc
+     * \param argv
+     * \param options
+     * \return
+     */
+    static bool read_options( int argc, const char * argv[], Options & options )
+    {
+        OptionsReader reader;
+        return reader( argc, argv, options );
+    }
+
+private:
+    /*!
+     * \brief read_positive
+     * \param option
+     * \param value
+     * \return
+     */
+    static unsigned int read_positive( const std::string & option, const char * value )
+    {
+        const int number = std::stoi( value );
+        if ( number < 1 ) {
+            throw std::invalid_argument( option + " must be positive" );
+        }
+        return number;
+    }
+};
+
+#endif // OPTIONS_HPP
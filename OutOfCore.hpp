@@ -0,0 +1,324 @@
+#ifndef OUTOFCORE_HPP
+#define OUTOFCORE_HPP
+
+#include "DatabaseReader.hpp"
+#include "VerticalDatabase.hpp"
+#include "VerticalDatabaseCache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+/*!
+ * \brief The OutOfCoreSettings struct
+ * Where an out-of-core run keeps its files, and how much memory its tids
+ * may take.
+ */
+struct OutOfCoreSettings
+{
+    OutOfCoreSettings() :
+        memory_budget( std::size_t( 1 ) << 30 ) {}
+
+    /*!
+     * \brief enabled
+     * \return
+     */
+    inline bool enabled() const
+    {
+        return ! directory.empty();
+    }
+
+    /*!
+     * \brief vertical_filename
+     * \return the vertical database, kept as a cache for the next runs
+     */
+    inline std::string vertical_filename() const
+    {
+        return directory + "/vertical.vdb";
+    }
+
+    /*!
+     * \brief spill_filename
+     * \return
+     */
+    inline std::string spill_filename() const
+    {
+        return directory + "/spill.tmp";
+    }
+
+    std::string directory;     //!< on local disk, empty to mine in memory
+    std::size_t memory_budget; //!< bytes
+};
+
+/*!
+ * \brief The SpillFile class
+ * Records written to and read back from a file as a stack: the record read
+ * is always the last one written, and its room is written over by the next
+ * one, so the file stays as large as the records it holds at once and is
+ * read and written front to back. The file is removed with the object.
+ */
+class SpillFile
+{
+public:
+    /*!
+     * \brief SpillFile
+     * \param filename
+     */
+    explicit SpillFile( const std::string & filename ) :
+        _filename( filename ),
+        _file( std::fopen( filename.c_str(), "w+b" ) ),
+        _end( 0 )
+    {
+        if ( ! _file ) {
+            throw std::runtime_error( "Cannot open spill file: " + filename );
+        }
+    }
+
+    SpillFile( const SpillFile & ) = delete;
+    SpillFile & operator = ( const SpillFile & ) = delete;
+
+    /*!
+     * \brief ~SpillFile
+     */
+    ~SpillFile()
+    {
+        std::fclose( _file );
+        std::remove( _filename.c_str() );
+    }
+
+    /*!
+     * \brief size
+     * \return records held
+     */
+    inline std::size_t size() const
+    {
+        return _starts.size();
+    }
+
+    /*!
+     * \brief push starts a record, put writes it
+     */
+    inline void push()
+    {
+        _starts.push_back( _end );
+        seek( _end );
+    }
+
+    /*!
+     * \brief pop drops the last record, get reads it
+     */
+    inline void pop()
+    {
+        _end = _starts.back();
+        _starts.pop_back();
+        seek( _end );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief put
+     * \param values
+     * \param count
+     */
+    inline void put( const value_type * values, const std::size_t count )
+    {
+        if ( count && ( std::fwrite( values, sizeof( value_type ), count, _file ) != count ) ) {
+            throw std::runtime_error( "Cannot write spill file: " + _filename );
+        }
+        _end += count * sizeof( value_type );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief get
+     * \param values
+     * \param count
+     */
+    inline void get( value_type * values, const std::size_t count )
+    {
+        if ( count && ( std::fread( values, sizeof( value_type ), count, _file ) != count ) ) {
+            throw std::runtime_error( "Cannot read spill file: " + _filename );
+        }
+    }
+
+private:
+    /*!
+     * \brief seek
+     * \param position
+     */
+    inline void seek( const std::uint64_t position )
+    {
+        if ( 0 != ::fseeko( _file, off_t( position ), SEEK_SET ) ) {
+            throw std::runtime_error( "Cannot seek spill file: " + _filename );
+        }
+    }
+
+    const std::string _filename;
+    std::FILE * const _file;
+    std::uint64_t _end;
+    std::vector < std::uint64_t > _starts;
+};
+
+template < unsigned int nfields >
+/*!
+ * \brief The OutOfCoreBuilder class
+ * Writes the vertical database of a database straight to a file in the
+ * layout of VerticalDatabaseCache, holding neither of them in memory. The
+ * database is mapped and parsed a chunk of lines at a time, front to back:
+ * a first pass counts the items, then every pass fills the tids of as many
+ * items, in dense id order, as the memory budget holds and appends them to
+ * the file. The file is the one VerticalDatabaseCache::save writes for the
+ * same database.
+ */
+class OutOfCoreBuilder
+{
+private:
+    /*!
+     * \brief chunk_size bytes of the database parsed at a time
+     */
+    static constexpr std::size_t chunk_size = 16 << 20;
+
+public:
+    /*!
+     * \brief build
+     * \param database_filename
+     * \param min_sup items below it are dropped
+     * \param memory_budget bytes of tids a pass fills, an item larger than the budget takes a pass of its own
+     * \param filename of the vertical database
+     */
+    static void build( const std::string & database_filename, const unsigned int min_sup, const std::size_t memory_budget, const std::string & filename )
+    {
+        const MappedFile file( database_filename );
+
+        // Count the transactions of every item
+        std::unordered_map< Item, std::pair< unsigned int, TID >, item_hash > counts;
+        const TID transaction_counter = for_each_transaction( file, [&counts]( const TID tid, const Transaction & transaction ) {
+            for ( const auto & item : transaction ) {
+                std::pair< unsigned int, TID > & count = counts[ item ];
+                if ( count.second != tid ) {
+                    count.second = tid;
+                    ++ count.first;
+                }
+            }
+        } );
+        std::vector < Item > items;
+        for ( const auto & key_value : counts ) {
+            if ( key_value.second.first >= min_sup ) {
+                items.push_back( key_value.first );
+            }
+        }
+        // Dense ids in ascending support order, as VerticalDatabaseBuilder numbers them
+        std::sort( items.begin(), items.end(), [&counts]( const Item & l, const Item & r ) {
+            const unsigned int l_support = counts.at( l ).first;
+            const unsigned int r_support = counts.at( r ).first;
+            return ( l_support < r_support ) || ( ( l_support == r_support ) && ( l < r ) );
+        } );
+        const std::size_t n_items = items.size();
+        std::vector < unsigned int > supports( n_items );
+        std::vector < std::uint64_t > offsets( 1, 0 );
+        std::unordered_map< Item, unsigned int, item_hash > dense_ids;
+        for ( std::size_t item = 0; item < n_items; ++ item ) {
+            supports[ item ] = counts.at( items[ item ] ).first;
+            const bool is_tidset = VerticalDatabase::stores_tidset( supports[ item ], transaction_counter );
+            offsets.push_back( offsets.back() + ( is_tidset ? supports[ item ] : ( transaction_counter - supports[ item ] ) ) );
+            dense_ids.insert( std::make_pair( items[ item ], unsigned( item ) ) );
+        }
+        counts.clear();
+
+        BufferedWriter writer( filename );
+        VerticalDatabaseCache::write_index( writer, transaction_counter, items, supports, offsets.data(), min_sup, database_filename );
+        std::vector < TID > tids;
+        std::vector < std::uint64_t > cursors;
+        std::vector < TID > last_tids;
+        for ( std::size_t first = 0; first < n_items; ) {
+            // The items of the pass, as many as the budget holds
+            std::size_t last = first + 1;
+            while ( ( last < n_items ) && ( ( offsets[ last + 1 ] - offsets[ first ] ) * sizeof( TID ) <= memory_budget ) ) {
+                ++ last;
+            }
+            tids.assign( offsets[ last ] - offsets[ first ], 0 );
+            cursors.assign( offsets.cbegin() + first, offsets.cbegin() + last );
+            for ( auto & cursor : cursors ) {
+                cursor -= offsets[ first ];
+            }
+            last_tids.assign( last - first, 0 );
+            for_each_transaction( file, [&]( const TID tid, const Transaction & transaction ) {
+                for ( const auto & item : transaction ) {
+                    const auto got = dense_ids.find( item );
+                    if ( ( dense_ids.cend() == got ) || ( got->second < first ) || ( got->second >= last ) ) {
+                        continue;
+                    }
+                    const std::size_t position = got->second - first;
+                    TID & last_tid = last_tids[ position ];
+                    if ( last_tid == tid ) {
+                        continue;
+                    }
+                    std::uint64_t & cursor = cursors[ position ];
+                    if ( VerticalDatabase::stores_tidset( supports[ got->second ], transaction_counter ) ) {
+                        tids[ cursor ++ ] = tid;
+                    }
+                    else {
+                        // The diffset takes the transactions since the last one holding the item
+                        for ( TID missing = last_tid + 1; missing < tid; ++ missing ) {
+                            tids[ cursor ++ ] = missing;
+                        }
+                    }
+                    last_tid = tid;
+                }
+            } );
+            for ( std::size_t item = first; item < last; ++ item ) {
+                if ( ! VerticalDatabase::stores_tidset( supports[ item ], transaction_counter ) ) {
+                    std::uint64_t & cursor = cursors[ item - first ];
+                    for ( TID missing = last_tids[ item - first ] + 1; missing <= transaction_counter; ++ missing ) {
+                        tids[ cursor ++ ] = missing;
+                    }
+                }
+            }
+            writer.write( reinterpret_cast< const char * >( tids.data() ), tids.size() * sizeof( TID ) );
+            first = last;
+        }
+        writer.close();
+    }
+
+private:
+    template < typename function_type >
+    /*!
+     * \brief for_each_transaction calls function( tid, transaction ) for every transaction of file, in order
+     * \param file mapped database
+     * \param function
+     * \return number of transactions
+     */
+    static TID for_each_transaction( const MappedFile & file, const function_type & function )
+    {
+        const char * first = file.data();
+        const char * const last = first + file.size();
+        TID tid = 0;
+        Database chunk;
+        while ( first != last ) {
+            // Every chunk but the last ends just after a line break
+            const char * bound = first + std::min< std::size_t >( chunk_size, last - first );
+            const char * line_break = static_cast< const char * >( std::memchr( bound, '\n', last - bound ) );
+            bound = line_break ? line_break + 1 : last;
+            Database().swap( chunk );
+            DatabaseReader< nfields >::parse( first, bound, chunk );
+            for ( std::size_t index = 0; index < chunk.size(); ++ index ) {
+                function( ++ tid, chunk[ index ] );
+            }
+            first = bound;
+        }
+        return tid;
+    }
+};
+
+template < unsigned int nfields >
+constexpr std::size_t OutOfCoreBuilder< nfields >::chunk_size;
+
+#endif // OUTOFCORE_HPP
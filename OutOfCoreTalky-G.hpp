@@ -0,0 +1,341 @@
+#ifndef OUTOFCORETALKYG_HPP
+#define OUTOFCORETALKYG_HPP
+
+#include "Talky-G.hpp"
+#include "OutOfCore.hpp"
+
+namespace Talky_G
+{
+
+/*!
+ * \brief tid_bytes
+ * \param diffset
+ * \return memory held by the tids
+ */
+inline std::size_t tid_bytes( const Diffset & diffset )
+{
+    return diffset.capacity() * sizeof( TID );
+}
+
+/*!
+ * \brief tid_bytes
+ * \param diffset
+ * \return memory held by the tids
+ */
+inline std::size_t tid_bytes( const BitDiffset & diffset )
+{
+    return diffset.n_words() * sizeof( BitDiffset::word_type );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief load_tids reads the tids of a child of the root from the vertical database
+ * \param vertical
+ * \param node child of the root, its item is its position in vertical
+ */
+inline void load_tids( const VerticalDatabase & vertical, BasicNode< diffset_type, item_type > & node )
+{
+    const std::size_t index = node.itemset().front();
+    assign_tids( node, vertical.item_tids( index ), vertical.transaction_counter, vertical.is_tidset( index ) );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief release_tids gives back the memory of the tids of node, its support and hashkey stay
+ * \param node
+ */
+inline void release_tids( BasicNode< diffset_type, item_type > & node )
+{
+    node.diffset() = diffset_type();
+}
+
+template< typename node_type >
+/*!
+ * \brief The DiffsetSpill class
+ * Checkpoint policy of talky_g_traverse keeping the tids of the frames on
+ * the stack within a memory budget. Only the children of the last frame
+ * are joined; the frames below it wait for the subtree above them. Once
+ * the tids of the frames exceed the budget, the frames from the bottom of
+ * the stack up are written to a SpillFile and their tids released; a
+ * spilled frame is read back when it is the last frame again. Frames are
+ * spilled from the bottom and read back from the top, so the SpillFile is
+ * used as the stack it is. Past half the budget, the regions of the
+ * frames done are released too, a region keeps the memory of its nodes
+ * otherwise.
+ */
+class DiffsetSpill
+{
+public:
+    /*!
+     * \brief DiffsetSpill
+     * \param filename of the SpillFile
+     * \param memory_budget bytes of tids the frames may hold
+     * \param transaction_counter
+     * \param arena the traversal takes its nodes from
+     * \param depth depth of the node of the first frame
+     */
+    DiffsetSpill( const std::string & filename, const std::size_t memory_budget, const TID transaction_counter, NodeArena< node_type > & arena, const unsigned int depth ) :
+        _file( filename ),
+        _memory_budget( memory_budget ),
+        _transaction_counter( transaction_counter ),
+        _arena( arena ),
+        _depth( depth ),
+        _resident( 0 ) {}
+
+    /*!
+     * \brief operator () is called before every step of the traversal
+     * \param stack
+     */
+    inline void operator ()( const std::vector< TraversalFrame< node_type > > & stack )
+    {
+        // A step pops a frame or pushes one, the last frame was never spilled
+        while ( _bytes.size() > stack.size() ) {
+            const bool tight = _resident > _memory_budget / 2;
+            _resident -= _bytes.back();
+            _bytes.pop_back();
+            if ( tight ) {
+                _arena.region( _depth + _bytes.size() + 1 ).release();
+                _arena.region( _depth + _bytes.size() + 2 ).release();
+            }
+        }
+        while ( _bytes.size() < stack.size() ) {
+            std::size_t bytes = 0;
+            for ( const auto child : stack[ _bytes.size() ].node->children() ) {
+                bytes += tid_bytes( child->diffset() );
+            }
+            _bytes.push_back( bytes );
+            _resident += bytes;
+        }
+        if ( stack.empty() ) {
+            return;
+        }
+        if ( _file.size() == stack.size() ) {
+            // A frame without children left is popped without being read back
+            if ( stack.back().next ) {
+                restore( *stack.back().node );
+                _resident += _bytes.back();
+            }
+            else {
+                _file.pop();
+                _bytes.back() = 0;
+            }
+        }
+        while ( ( _resident > _memory_budget ) && ( _file.size() + 1 < stack.size() ) ) {
+            spill( *stack[ _file.size() ].node );
+            _resident -= _bytes[ _file.size() - 1 ];
+        }
+    }
+
+    /*!
+     * \brief finish releases what the frames of a finished traversal held
+     */
+    inline void finish()
+    {
+        ( *this )( std::vector< TraversalFrame< node_type > >() );
+    }
+
+private:
+    /*!
+     * \brief spill writes the tids of the children of node and releases them
+     * \param node
+     */
+    inline void spill( node_type & node )
+    {
+        _file.push();
+        for ( const auto child : node.children() ) {
+            _tids.assign( child->diffset().cbegin(), child->diffset().cend() );
+            const std::uint8_t is_tidset = child->is_tidset();
+            const std::uint32_t size = _tids.size();
+            _file.put( &is_tidset, 1 );
+            _file.put( &size, 1 );
+            _file.put( _tids.data(), _tids.size() );
+            release_tids( *child );
+        }
+    }
+
+    /*!
+     * \brief restore reads back the tids of the children of node, spilled last
+     * \param node
+     */
+    inline void restore( node_type & node )
+    {
+        _file.pop();
+        for ( const auto child : node.children() ) {
+            std::uint8_t is_tidset = 0;
+            std::uint32_t size = 0;
+            _file.get( &is_tidset, 1 );
+            _file.get( &size, 1 );
+            _tids.resize( size );
+            _file.get( _tids.data(), _tids.size() );
+            assign_tids( *child, _tids, _transaction_counter, is_tidset );
+        }
+    }
+
+    SpillFile _file;
+    const std::size_t _memory_budget;
+    const TID _transaction_counter;
+    NodeArena< node_type > & _arena;
+    const unsigned int _depth;
+    std::vector < std::size_t > _bytes; //!< tids of the children of every frame, 0 while spilled
+    std::size_t _resident;
+    Diffset _tids;
+};
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief fill_tree_lazily adds the frequent items as children of root_node without their tids
+ * Every item is read once for its support and hashkey; load_tids reads it
+ * again when it is joined. Against the root every diffset holds
+ * transaction_counter - sup() tids, so the children are ordered without
+ * them.
+ * \param vertical
+ * \param min_sup
+ * \param root_node
+ * \param region region of the root's children
+ * \param order of the root's children
+ */
+inline void fill_tree_lazily( const VerticalDatabase & vertical, const unsigned int min_sup, BasicNode< diffset_type, item_type > & root_node, NodeRegion< BasicNode< diffset_type, item_type > > & region, const SiblingOrder order )
+{
+    typedef BasicNode< diffset_type, item_type > node_type;
+    ScopedPhase phase( "tree_fill" );
+    SearchCounters & counters = SearchCounters::local();
+    for ( std::size_t index = 0; index < vertical.size(); ++ index ) {
+        if ( min_sup <= vertical.supports[ index ] ) {
+            counters.count_node( 1 );
+            auto & child = region.acquire();
+            child.itemset().assign( 1, item_type( index ) );
+            load_tids( vertical, child );
+            child.attach( &root_node );
+            release_tids( child );
+            root_node.add_child( &child );
+        }
+    }
+    if ( SiblingOrder::DiffsetSize == order ) {
+        std::stable_sort( root_node.children_ref().begin(), root_node.children_ref().end(), [] ( const node_type * ch1, const node_type * ch2 ) {
+            return ( ch1->sup() > ch2->sup() );
+        } );
+    }
+    else {
+        root_node.order_children( order );
+    }
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief talky_g_out_of_core_mine mines one equivalence class of the root at a time
+ * The items' tids stay in the mapped vertical database and are read when
+ * a class is joined, in the order of the root's children; as many of them
+ * as half the memory budget holds stay in memory, the ones needed by most
+ * classes first. The subtree of a class is mined by talky_g_traverse,
+ * whose frames spill under the other half of the budget. The generators
+ * are the ones talky_g_mine finds, in the same order.
+ * \param vertical
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param c_set
+ * \param order of the children of every node
+ * \param settings
+ */
+inline void talky_g_out_of_core_mine( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int max_len, cset_type & c_set, const SiblingOrder order, const OutOfCoreSettings & settings )
+{
+    typedef BasicNode< diffset_type, item_type > node_type;
+    NodeArena< node_type > arena;
+    auto root_node = make_root_node< diffset_type, item_type >( vertical.transaction_counter );
+    fill_tree_lazily( vertical, min_sup, root_node, arena.region( 1 ), order );
+    DiffsetSpill< node_type > spill( settings.spill_filename(), settings.memory_budget / 2, vertical.transaction_counter, arena, 1 );
+    SearchCounters & counters = SearchCounters::local();
+    const auto & children = root_node.children();
+    std::vector < bool > kept( children.size(), false );
+    std::size_t kept_bytes = 0;
+    auto load = [&]( const std::size_t index ) {
+        if ( ! kept[ index ] ) {
+            load_tids( vertical, *children[ index ] );
+        }
+    };
+    // Classes are mined from the Right, so the items kept are the rightmost ones
+    auto unload = [&]( const std::size_t index ) {
+        if ( kept[ index ] ) {
+            return;
+        }
+        const std::size_t bytes = tid_bytes( children[ index ]->diffset() );
+        if ( kept_bytes + bytes <= settings.memory_budget / 2 ) {
+            kept[ index ] = true;
+            kept_bytes += bytes;
+        }
+        else {
+            release_tids( *children[ index ] );
+        }
+    };
+    // Loop over the classes from Left to Right, as talky_g_traverse takes them
+    for ( std::size_t index = children.size(); index -- > 0; ) {
+        node_type & child = *children[ index ];
+        if ( child.sup() < min_support( c_set, min_sup ) ) {
+            continue;
+        }
+        save( c_set, child );
+        if ( ( index + 1 == children.size() ) || ! within_length( 2, max_len ) ) {
+            continue;
+        }
+        NodeRegion< node_type > & region = arena.region( 2 );
+        const unsigned int current_min_sup = min_support( c_set, min_sup );
+        load( index );
+        for ( std::size_t other = index + 1; other < children.size(); ++ other ) {
+            load( other );
+            node_type & candidate = region.acquire();
+            if ( get_next_generator( child, *children[ other ], c_set, current_min_sup, candidate, counters ) ) {
+                counters.count_node( candidate.itemset().size() );
+                child.add_child( &candidate );
+            }
+            else {
+                region.release_last();
+            }
+            unload( other );
+        }
+        unload( index );
+        child.order_children( order );
+        if ( ! child.children().empty() ) {
+            std::vector< TraversalFrame< node_type > > stack( 1, TraversalFrame< node_type >( &child, child.children().size() ) );
+            talky_g_traverse( stack, 1, c_set, min_sup, max_len, arena, order, spill );
+        }
+        spill.finish();
+    }
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g_out_of_core streams the generators to sink while mining out of core
+ * \param vertical mapped from settings.vertical_filename()
+ * \param min_sup
+ * \param sink
+ * \param order of the children of every node
+ * \param bounds generators to report
+ * \param settings
+ * \return statistics of the generator index
+ */
+inline CSetStatistics talky_g_out_of_core( const VerticalDatabase & vertical, const unsigned int min_sup, GeneratorSink & sink, const SiblingOrder order, const SearchBounds & bounds, const OutOfCoreSettings & settings )
+{
+    auto c_set = BasicCSet< item_type >();
+    LabelWriter writer( vertical.items, sink );
+    if ( saves_subsets_first( order ) && ( 0 == bounds.top_k ) ) {
+        StreamingCSet< item_type > streaming_c_set( c_set, writer, bounds.min_len );
+        talky_g_out_of_core_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, streaming_c_set, order, settings );
+        return c_set.statistics();
+    }
+    if ( bounds.top_k ) {
+        TopKSupports supports( bounds.top_k );
+        TopKCSet< BasicCSet< item_type > > top_k_c_set( c_set, supports, bounds.min_len );
+        talky_g_out_of_core_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, top_k_c_set, order, settings );
+    }
+    else {
+        talky_g_out_of_core_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, c_set, order, settings );
+    }
+    if ( ! saves_subsets_first( order ) ) {
+        c_set.remove_subsumed();
+    }
+    write_generators( c_set, bounds, writer );
+    return c_set.statistics();
+}
+
+}
+
+#endif // OUTOFCORETALKYG_HPP
@@ -0,0 +1,158 @@
+#ifndef PARALLELTALKYG_HPP
+#define PARALLELTALKYG_HPP
+
+#include "Talky-G.hpp"
+#include "ThreadPool.hpp"
+
+namespace Talky_G
+{
+
+/*!
+ * \brief spawn_depth subtrees deeper than this are always mined by the task that reached them
+ */
+constexpr unsigned int spawn_depth = 4;
+
+/*!
+ * \brief spawn_siblings inner subtrees are only handed to the pool when
+ * they have at least this many right siblings to be joined with
+ */
+constexpr unsigned int spawn_siblings = 8;
+
+template< typename node_iterator, typename cset_type, typename node_type >
+/*!
+ * \brief talky_g_parallel_extend
+ * \param curr
+ * \param right_margin
+ * \param c_set
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param pool
+ * \param arenas
+ * \param depth depth of curr
+ * \param order of the children
+ */
+inline void talky_g_parallel_extend(const node_iterator curr, const node_iterator right_margin, cset_type &c_set, const unsigned int min_sup, const unsigned int max_len, ThreadPool & pool, NodeArenaPool< node_type > & arenas, const unsigned int depth, const SiblingOrder order)
+{
+    auto & current_child = (*(*curr));
+    if ( ( std::distance( right_margin, curr ) >= 1 ) && within_length( depth + 1, max_len ) ) {
+        // The children of curr and the subtrees mined inline live in the arena of this task
+        auto arena = arenas.acquire();
+        NodeRegion< node_type > & region = arena->region( depth + 1 );
+        add_generators( curr, right_margin, c_set, min_sup, region, order );
+        TaskGroup group( pool );
+        // Loop over the children of curr from Left to Right
+        for ( auto it = current_child.children().crbegin(); it != current_child.children().crend(); ++ it ) {
+            const auto & child = (*(*it));
+            if ( child.sup() < min_support( c_set, min_sup ) ) {
+                continue;
+            }
+            save( c_set, child );
+            const auto right = current_child.children().crbegin();
+            if ( ( depth < spawn_depth ) && ( std::distance( right, it ) >= spawn_siblings ) ) {
+                InsertionLog & log = InsertionLog::current()->spawn();
+                group.run( [it, right, &c_set, min_sup, max_len, &pool, &arenas, depth, order, &log] {
+                    InsertionLog::Scope scope( log );
+                    talky_g_parallel_extend( it, right, c_set, min_sup, max_len, pool, arenas, depth + 1, order );
+                } );
+            }
+            else {
+                auto child_it = it;
+                talky_g_extend( child_it, right, c_set, min_sup, max_len, *arena, depth + 1, order );
+            }
+        }
+        group.wait();
+        current_child.clear_children();
+        region.reset();
+        arenas.release( std::move( arena ) );
+    }
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief talky_g_parallel_mine
+ * \param vertical
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param n_threads
+ * \param c_set holds the serial result once mining is done
+ * \param order of the children of every node
+ */
+inline void talky_g_parallel_mine( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int max_len, const unsigned int n_threads, cset_type & c_set, const SiblingOrder order )
+{
+    NodeArena< BasicNode< diffset_type, item_type > > root_arena;
+    NodeArenaPool< BasicNode< diffset_type, item_type > > arenas;
+    auto root_node = make_root_node< diffset_type, item_type >( vertical.transaction_counter );
+    fill_tree( vertical, min_sup, root_node, root_arena.region( 1 ), order );
+    {
+        ThreadPool pool( n_threads );
+        TaskGroup group( pool );
+        // The inserts are logged task by task, for the result to be written in serial order
+        InsertionLog::Scope scope( saved_generators( c_set ).log() );
+        // Every subtree of the root is an independent task
+        const auto right = root_node.children().crbegin();
+        for ( auto it = root_node.children().crbegin(); it != root_node.children().crend(); ++ it ) {
+            save( c_set, (*(*it)) );
+            InsertionLog & log = InsertionLog::current()->spawn();
+            group.run( [it, right, &c_set, min_sup, max_len, &pool, &arenas, order, &log] {
+                InsertionLog::Scope scope( log );
+                talky_g_parallel_extend( it, right, c_set, min_sup, max_len, pool, arenas, 1, order );
+            } );
+        }
+        group.wait();
+    }
+    // In the serial traversal every subset of a candidate is saved before the
+    // candidate is checked. Concurrent subtrees break that order, so a candidate
+    // may pass is_subsumed before its subset is saved; this sweep restores the
+    // serial result.
+    saved_generators( c_set ).remove_subsumed();
+}
+
+template< typename diffset_type >
+/*!
+ * \brief talky_g_parallel
+ * \param vertical
+ * \param min_sup
+ * \param n_threads
+ * \param order of the children of every node
+ * \return
+ */
+inline CSet talky_g_parallel( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int n_threads, const SiblingOrder order = SiblingOrder::Support )
+{
+    ConcurrentCSet c_set;
+    talky_g_parallel_mine< diffset_type, Item >( vertical, min_sup, 0, n_threads, c_set, order );
+    return relabel( c_set.merge(), vertical.items );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g_parallel writes the generators to sink
+ * A generator is only final after the sweep of the concurrent result, so
+ * the shards are written once mining is done, without being merged, in
+ * the order the serial traversal writes them.
+ * \param vertical
+ * \param min_sup
+ * \param n_threads
+ * \param sink
+ * \param order of the children of every node
+ * \param bounds generators to report
+ * \return statistics of the generator index
+ */
+inline CSetStatistics talky_g_parallel( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int n_threads, GeneratorSink & sink, const SiblingOrder order = SiblingOrder::Support, const SearchBounds & bounds = SearchBounds() )
+{
+    BasicConcurrentCSet< item_type > c_set;
+    if ( bounds.top_k ) {
+        TopKSupports supports( bounds.top_k );
+        TopKCSet< BasicConcurrentCSet< item_type > > top_k_c_set( c_set, supports, bounds.min_len );
+        talky_g_parallel_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, n_threads, top_k_c_set, order );
+    }
+    else {
+        talky_g_parallel_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, n_threads, c_set, order );
+    }
+    LabelWriter writer( vertical.items, sink );
+    write_generators( c_set, bounds, writer );
+    return c_set.statistics();
+}
+
+}
+
+#endif // PARALLELTALKYG_HPP
@@ -0,0 +1,122 @@
+#ifndef SEARCHBOUNDS_HPP
+#define SEARCHBOUNDS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief The SearchBounds struct
+ * Which generators a run reports. max_len also bounds the search: no
+ * node longer than max_len is generated. min_len only filters the result,
+ * its shorter subsets are needed to tell generators apart. With top_k only
+ * the top_k generators of highest support are reported, together with the
+ * generators as frequent as the last of them.
+ */
+struct SearchBounds
+{
+    SearchBounds() :
+        min_len( 0 ),
+        max_len( 0 ),
+        top_k( 0 ) {}
+
+    unsigned int min_len;
+    unsigned int max_len; //!< 0 for no bound
+    unsigned int top_k;   //!< 0 to report every generator
+};
+
+/*!
+ * \brief within_length
+ * \param length
+ * \param max_len 0 for no bound
+ * \return
+ */
+inline bool within_length( const std::size_t length, const unsigned int max_len )
+{
+    return ( 0 == max_len ) || ( length <= max_len );
+}
+
+/*!
+ * \brief The TopKSupports class
+ * Raises the minimal support of a top-k search as generators are saved.
+ * It keeps the k highest supports of the classes saved so far, a class
+ * being told by its hashkey and its support. Once k classes are known, no
+ * generator below the support of the last of them can be in the result,
+ * and neither can any of its supersets.
+ *
+ * Counting classes instead of generators keeps the threshold safe when
+ * the saved generators are not final: a candidate saved before its subset
+ * of the same support, and swept later, still stands for one generator of
+ * its class. Classes whose hashkeys collide are counted once, which only
+ * lowers the threshold.
+ */
+class TopKSupports
+{
+public:
+    /*!
+     * \brief TopKSupports
+     * \param k
+     */
+    explicit TopKSupports( const unsigned int k ) :
+        _k( k ),
+        _threshold( 0 ) {}
+
+    /*!
+     * \brief threshold
+     * \return support every generator of the result has at least, 0 until k classes are known
+     */
+    inline unsigned int threshold() const
+    {
+        return _threshold.load( std::memory_order_relaxed );
+    }
+
+    /*!
+     * \brief offer counts a saved generator
+     * \param hashkey
+     * \param support
+     */
+    inline void offer( const int hashkey, const unsigned int support )
+    {
+        // Classes as frequent as the threshold do not raise it
+        if ( support <= threshold() ) {
+            return;
+        }
+        std::lock_guard< std::mutex > lock( _mutex );
+        _classes.insert( std::make_pair( support, hashkey ) );
+        if ( _classes.size() > _k ) {
+            _classes.erase( _classes.begin() );
+        }
+        if ( _classes.size() == _k ) {
+            _threshold.store( _classes.begin()->first, std::memory_order_relaxed );
+        }
+    }
+
+private:
+    const std::size_t _k;
+    std::atomic< unsigned int > _threshold;
+    std::mutex _mutex;
+    std::set < std::pair< unsigned int, int > > _classes;
+};
+
+/*!
+ * \brief kth_support
+ * \param supports of the generators to report, reordered
+ * \param k
+ * \return support of the k-th most frequent generator, 0 if there are fewer
+ */
+inline unsigned int kth_support( std::vector < unsigned int > & supports, const unsigned int k )
+{
+    if ( ( 0 == k ) || ( supports.size() < k ) ) {
+        return 0;
+    }
+    std::nth_element( supports.begin(), supports.begin() + ( k - 1 ), supports.end(), []( const unsigned int left, const unsigned int right ) {
+        return left > right;
+    } );
+    return supports[ k - 1 ];
+}
+
+#endif // SEARCHBOUNDS_HPP
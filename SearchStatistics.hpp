@@ -0,0 +1,331 @@
+#ifndef SEARCHSTATISTICS_HPP
+#define SEARCHSTATISTICS_HPP
+
+#include "CSet.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+/*!
+ * \brief The SearchCounters class
+ * Counters of the traversal. Every thread counts into its own instance,
+ * found once per node through local(), without locks or atomics and
+ * without a branch of its own: a counter is bumped on the branch the
+ * traversal takes anyway. total() adds up the threads and is meant to be
+ * read once mining is done.
+ */
+class SearchCounters
+{
+public:
+    /*!
+     * \brief max_levels deeper nodes are counted in the last level
+     */
+    static constexpr std::size_t max_levels = 64;
+
+    /*!
+     * \brief SearchCounters
+     */
+    SearchCounters()
+    {
+        clear();
+    }
+
+    /*!
+     * \brief clear
+     */
+    inline void clear()
+    {
+        candidates = 0;
+        rejected_support = 0;
+        rejected_equal_curr = 0;
+        rejected_equal_other = 0;
+        rejected_subsumed = 0;
+        max_depth = 0;
+        std::fill( nodes_per_level, nodes_per_level + max_levels, 0 );
+    }
+
+    /*!
+     * \brief count_node counts a node of the tree
+     * \param depth its depth, the size of its itemset
+     */
+    inline void count_node( const std::size_t depth )
+    {
+        ++ nodes_per_level[ std::min( depth, max_levels - 1 ) ];
+        max_depth = std::max< std::uint64_t >( max_depth, depth );
+    }
+
+    /*!
+     * \brief operator +=
+     * \param other
+     * \return
+     */
+    inline SearchCounters & operator += ( const SearchCounters & other )
+    {
+        candidates += other.candidates;
+        rejected_support += other.rejected_support;
+        rejected_equal_curr += other.rejected_equal_curr;
+        rejected_equal_other += other.rejected_equal_other;
+        rejected_subsumed += other.rejected_subsumed;
+        max_depth = std::max( max_depth, other.max_depth );
+        for ( std::size_t level = 0; level < max_levels; ++ level ) {
+            nodes_per_level[ level ] += other.nodes_per_level[ level ];
+        }
+        return *this;
+    }
+
+    /*!
+     * \brief local
+     * \return the counters of the calling thread
+     */
+    static SearchCounters & local();
+
+    /*!
+     * \brief total
+     * \return the counters of every thread, finished or not
+     */
+    static SearchCounters total();
+
+    std::uint64_t candidates;           //!< joins of two siblings
+    std::uint64_t rejected_support;     //!< infrequent
+    std::uint64_t rejected_equal_curr;  //!< same support as the left sibling
+    std::uint64_t rejected_equal_other; //!< same support as the right sibling
+    std::uint64_t rejected_subsumed;    //!< a saved generator is a subset with the same support
+    std::uint64_t max_depth;
+    std::uint64_t nodes_per_level[ max_levels ];
+
+private:
+    struct Registry;
+    struct Registration;
+
+    static Registry & get_registry();
+};
+
+/*!
+ * \brief The SearchCounters::Registry struct holds the counters of live threads and the sum of finished ones
+ */
+struct SearchCounters::Registry
+{
+    std::mutex mutex;
+    std::vector < SearchCounters * > live;
+    SearchCounters retired;
+};
+
+/*!
+ * \brief The SearchCounters::Registration struct registers the counters of a thread for its lifetime
+ */
+struct SearchCounters::Registration
+{
+    Registration()
+    {
+        Registry & registry = get_registry();
+        std::lock_guard< std::mutex > lock( registry.mutex );
+        registry.live.push_back( &counters );
+    }
+
+    ~Registration()
+    {
+        Registry & registry = get_registry();
+        std::lock_guard< std::mutex > lock( registry.mutex );
+        registry.retired += counters;
+        registry.live.erase( std::find( registry.live.begin(), registry.live.end(), &counters ) );
+    }
+
+    SearchCounters counters;
+};
+
+inline SearchCounters::Registry & SearchCounters::get_registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+inline SearchCounters & SearchCounters::local()
+{
+    static thread_local Registration registration;
+    return registration.counters;
+}
+
+inline SearchCounters SearchCounters::total()
+{
+    Registry & registry = get_registry();
+    std::lock_guard< std::mutex > lock( registry.mutex );
+    SearchCounters total = registry.retired;
+    for ( const auto counters : registry.live ) {
+        total += *counters;
+    }
+    return total;
+}
+
+/*!
+ * \brief The PhaseTimes class
+ * Wall time of the phases of a run, in the order they first ran.
+ */
+class PhaseTimes
+{
+public:
+    /*!
+     * \brief get
+     * \return
+     */
+    static PhaseTimes & get()
+    {
+        static PhaseTimes phase_times;
+        return phase_times;
+    }
+
+    /*!
+     * \brief add
+     * \param phase
+     * \param duration
+     */
+    inline void add( const std::string & phase, const std::chrono::nanoseconds duration )
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        for ( auto & entry : _phases ) {
+            if ( entry.first == phase ) {
+                entry.second += duration;
+                return;
+            }
+        }
+        _phases.push_back( std::make_pair( phase, duration ) );
+    }
+
+    /*!
+     * \brief phases
+     * \return
+     */
+    inline std::vector < std::pair< std::string, std::chrono::nanoseconds > > phases() const
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        return _phases;
+    }
+
+private:
+    mutable std::mutex _mutex;
+    std::vector < std::pair< std::string, std::chrono::nanoseconds > > _phases;
+};
+
+/*!
+ * \brief The ScopedPhase class adds its lifetime to a phase
+ * Phases nest on a thread: an inner phase pauses the one around it, whose
+ * time then leaves out the inner one's.
+ */
+class ScopedPhase
+{
+public:
+    /*!
+     * \brief ScopedPhase
+     * \param phase
+     */
+    explicit ScopedPhase( const char * phase ) :
+        _phase( phase ),
+        _outer( innermost() ),
+        _start( std::chrono::steady_clock::now() )
+    {
+        if ( _outer ) {
+            _outer->stop( _start );
+        }
+        innermost() = this;
+    }
+
+    ScopedPhase( const ScopedPhase & ) = delete;
+    ScopedPhase & operator = ( const ScopedPhase & ) = delete;
+
+    ~ScopedPhase()
+    {
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        stop( end );
+        innermost() = _outer;
+        if ( _outer ) {
+            _outer->_start = end;
+        }
+    }
+
+private:
+    /*!
+     * \brief innermost
+     * \return the phase the thread is in, nullptr outside of any
+     */
+    static ScopedPhase *& innermost()
+    {
+        static thread_local ScopedPhase * phase = nullptr;
+        return phase;
+    }
+
+    /*!
+     * \brief stop adds the time since the phase started or resumed
+     * \param end
+     */
+    inline void stop( const std::chrono::steady_clock::time_point end )
+    {
+        PhaseTimes::get().add( _phase, std::chrono::duration_cast< std::chrono::nanoseconds >( end - _start ) );
+    }
+
+    const char * _phase;
+    ScopedPhase * const _outer;
+    std::chrono::steady_clock::time_point _start;
+};
+
+/*!
+ * \brief peak_rss_kb
+ * \return the largest resident set of the process so far, in KiB
+ */
+inline long peak_rss_kb()
+{
+    struct rusage usage;
+    if ( 0 != ::getrusage( RUSAGE_SELF, &usage ) ) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+/*!
+ * \brief write_statistics writes the statistics of a run as one JSON object
+ * \param os
+ * \param generators
+ * \param counters
+ * \param c_set
+ */
+inline void write_statistics( std::ostream & os, const std::size_t generators, const SearchCounters & counters, const CSetStatistics & c_set )
+{
+    os << "{\n  \"generators\": " << generators << ",\n  \"phases_ms\": {";
+    const auto phases = PhaseTimes::get().phases();
+    for ( std::size_t index = 0; index < phases.size(); ++ index ) {
+        os << ( index ? ", " : " " ) << '"' << phases[ index ].first << "\": "
+           << std::chrono::duration_cast< std::chrono::microseconds >( phases[ index ].second ).count() / 1000.0;
+    }
+    os << " },\n"
+       << "  \"candidates\": { \"generated\": " << counters.candidates
+       << ", \"rejected_support\": " << counters.rejected_support
+       << ", \"rejected_equal_curr\": " << counters.rejected_equal_curr
+       << ", \"rejected_equal_other\": " << counters.rejected_equal_other
+       << ", \"rejected_subsumed\": " << counters.rejected_subsumed << " },\n"
+       << "  \"tree\": { \"max_depth\": " << counters.max_depth << ", \"nodes_per_level\": [";
+    // max_levels is only declared in the class, std::min needs an object to refer to
+    const std::size_t max_levels = SearchCounters::max_levels;
+    const std::size_t levels = std::min< std::size_t >( counters.max_depth + 1, max_levels );
+    for ( std::size_t level = 1; level < levels; ++ level ) {
+        os << ( level > 1 ? ", " : " " ) << counters.nodes_per_level[ level ];
+    }
+    os << " ] },\n"
+       << "  \"cset\": { \"generators\": " << c_set.generators
+       << ", \"classes\": " << c_set.classes
+       << ", \"slots\": " << c_set.slots
+       << ", \"max_probe_length\": " << c_set.max_probe_length
+       << ", \"mean_probe_length\": " << c_set.mean_probe_length
+       << ", \"max_chain_length\": " << c_set.max_chain_length
+       << ", \"mean_chain_length\": " << c_set.mean_chain_length
+       << ", \"bytes\": " << c_set.bytes << " },\n"
+       << "  \"peak_rss_kb\": " << peak_rss_kb() << "\n}\n";
+}
+
+#endif // SEARCHSTATISTICS_HPP
@@ -0,0 +1,512 @@
+#ifndef SETKERNELS_HPP
+#define SETKERNELS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define SETKERNELS_X86 1
+#endif
+
+#include "CpuFeatures.hpp"
+#include "Diffset.hpp"
+
+/*!
+ * \brief The SetKernels struct
+ * Difference and intersection of sorted arrays of distinct tids, written
+ * into a buffer of the caller. The vector variants compare a block of four
+ * tids of left with every tid of a block of right (4, 8 or 16 wide) by
+ * rotating it, keep the lanes the match mask selects with a shuffle, and
+ * advance the block with the smaller maximum, as in the SIMD intersection
+ * of Schlegel et al.; the tails are merged by the scalar code. The widest
+ * variant the running CPU supports is picked once, on first use.
+ * A difference takes a limit and stops once it has kept more tids than
+ * that: a candidate whose diffset outgrows curr.sup() - min_sup is
+ * infrequent, whatever the rest of the merge would add.
+ */
+struct SetKernels
+{
+    /*!
+     * \brief set_function
+     * \return number of tids written to result
+     */
+    typedef std::size_t ( * set_function )( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result );
+
+    /*!
+     * \brief difference_function
+     * \return number of tids kept, or a number above limit if the difference stopped early
+     */
+    typedef std::size_t ( * difference_function )( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit );
+
+    /*!
+     * \brief padding vector variants store whole blocks of four, a result buffer holds this many tids more than the result can
+     */
+    static constexpr std::size_t padding = 4;
+
+    difference_function difference;         //!< left without right, result holds min( n_left, limit + 1 ) + padding tids
+    difference_function difference_size;    //!< counts left without right, result is not used and may be nullptr
+    set_function intersection;              //!< result holds min( n_left, n_right ) + padding tids
+    const char * name;
+
+    /*!
+     * \brief get
+     * \return
+     */
+    static const SetKernels & get()
+    {
+        static const SetKernels kernels = select();
+        return kernels;
+    }
+
+private:
+    template < bool store >
+    /*!
+     * \brief difference_scalar branch-free merge
+     * \param left
+     * \param n_left
+     * \param right
+     * \param n_right
+     * \param result
+     * \param limit
+     * \return
+     */
+    static std::size_t difference_scalar( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit )
+    {
+        return difference_tail< store >( left, 0, n_left, 0, right, 0, n_right, result, limit );
+    }
+
+    /*!
+     * \brief intersection_scalar branch-free merge
+     * \param left
+     * \param n_left
+     * \param right
+     * \param n_right
+     * \param result
+     * \return
+     */
+    static std::size_t intersection_scalar( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result )
+    {
+        return intersection_tail( left, 0, n_left, right, 0, n_right, result );
+    }
+
+    template < bool store >
+    /*!
+     * \brief at
+     * \param result
+     * \param k
+     * \return result + k, or result itself when nothing is stored, as result may then be nullptr
+     */
+    static inline TID * at( TID * result, const std::size_t k )
+    {
+        return store ? result + k : result;
+    }
+
+    template < bool store >
+    /*!
+     * \brief difference_tail writes left[ i, n_left ) without right[ j, n_right )
+     * \param left
+     * \param i
+     * \param n_left
+     * \param found bit l set when left[ i + l ] is already known to be in right
+     * \param right
+     * \param j
+     * \param n_right
+     * \param result
+     * \param limit
+     * \return
+     */
+    static inline std::size_t difference_tail( const TID * left, std::size_t i, const std::size_t n_left, unsigned int found,
+                                               const TID * right, std::size_t j, const std::size_t n_right, TID * result, const std::size_t limit )
+    {
+        std::size_t k = 0;
+        for ( ; found && ( i < n_left ); ++ i, found >>= 1 ) {
+            if ( ! ( found & 1 ) ) {
+                const TID tid = left[ i ];
+                while ( ( j < n_right ) && ( right[ j ] < tid ) ) {
+                    ++ j;
+                }
+                if ( ( j == n_right ) || ( right[ j ] != tid ) ) {
+                    if ( store ) {
+                        result[ k ] = tid;
+                    }
+                    ++ k;
+                }
+            }
+        }
+        while ( ( i < n_left ) && ( j < n_right ) && ( k <= limit ) ) {
+            const TID l = left[ i ];
+            const TID r = right[ j ];
+            if ( store ) {
+                result[ k ] = l;
+            }
+            k += ( l < r );
+            i += ( l <= r );
+            j += ( r <= l );
+        }
+        const std::size_t size = k + ( n_left - i );
+        if ( store && ( size <= limit ) ) {
+            std::copy( left + i, left + n_left, result + k );
+        }
+        return size;
+    }
+
+    /*!
+     * \brief intersection_tail writes the tids both of left[ i, n_left ) and right[ j, n_right )
+     * \param left
+     * \param i
+     * \param n_left
+     * \param right
+     * \param j
+     * \param n_right
+     * \param result
+     * \return
+     */
+    static inline std::size_t intersection_tail( const TID * left, std::size_t i, const std::size_t n_left,
+                                                 const TID * right, std::size_t j, const std::size_t n_right, TID * result )
+    {
+        std::size_t k = 0;
+        while ( ( i < n_left ) && ( j < n_right ) ) {
+            const TID l = left[ i ];
+            const TID r = right[ j ];
+            result[ k ] = l;
+            k += ( l == r );
+            i += ( l <= r );
+            j += ( r <= l );
+        }
+        return k;
+    }
+
+#ifdef SETKERNELS_X86
+    /*!
+     * \brief compress_table
+     * \return shuffle controls moving the lanes of a block of four selected by a mask to the front
+     */
+    static const std::uint8_t ( & compress_table() )[ 16 ][ 16 ]
+    {
+        struct Table
+        {
+            Table()
+            {
+                for ( unsigned int mask = 0; mask < 16; ++ mask ) {
+                    unsigned int lane = 0;
+                    for ( unsigned int bit = 0; bit < 4; ++ bit ) {
+                        if ( mask & ( 1u << bit ) ) {
+                            for ( unsigned int byte = 0; byte < 4; ++ byte ) {
+                                controls[ mask ][ 4 * lane + byte ] = std::uint8_t( 4 * bit + byte );
+                            }
+                            ++ lane;
+                        }
+                    }
+                    std::fill( controls[ mask ] + 4 * lane, controls[ mask ] + 16, std::uint8_t( 0x80 ) );
+                }
+            }
+
+            alignas( 16 ) std::uint8_t controls[ 16 ][ 16 ];
+        };
+        static const Table table;
+        return table.controls;
+    }
+
+    template < bool store >
+    /*!
+     * \brief compress writes the lanes of a block of four of left selected by mask
+     * \param controls compress_table()
+     * \param left
+     * \param mask
+     * \param result
+     * \return number of lanes selected
+     */
+    __attribute__(( target( "sse4.2,popcnt" ) ))
+    static inline std::size_t compress( const std::uint8_t ( & controls )[ 16 ][ 16 ], const TID * left, const unsigned int mask, TID * result )
+    {
+        if ( store ) {
+            const __m128i l = _mm_loadu_si128( reinterpret_cast< const __m128i * >( left ) );
+            const __m128i control = _mm_load_si128( reinterpret_cast< const __m128i * >( controls[ mask ] ) );
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( result ), _mm_shuffle_epi8( l, control ) );
+        }
+        return _mm_popcnt_u32( mask );
+    }
+
+    /*!
+     * \brief The Block4 struct
+     * Blocks of four tids of right, compared with SSE4.2
+     */
+    struct Block4
+    {
+        static constexpr std::size_t width = 4;
+
+        /*!
+         * \brief match
+         * \param left a block of four
+         * \param right a block of four
+         * \return bit l set when left[ l ] is in right
+         */
+        __attribute__(( target( "sse4.2" ) ))
+        static inline unsigned int match( const TID * left, const TID * right )
+        {
+            const __m128i l = _mm_loadu_si128( reinterpret_cast< const __m128i * >( left ) );
+            const __m128i r = _mm_loadu_si128( reinterpret_cast< const __m128i * >( right ) );
+            __m128i match = _mm_cmpeq_epi32( l, r );
+            match = _mm_or_si128( match, _mm_cmpeq_epi32( l, _mm_shuffle_epi32( r, _MM_SHUFFLE( 0, 3, 2, 1 ) ) ) );
+            match = _mm_or_si128( match, _mm_cmpeq_epi32( l, _mm_shuffle_epi32( r, _MM_SHUFFLE( 1, 0, 3, 2 ) ) ) );
+            match = _mm_or_si128( match, _mm_cmpeq_epi32( l, _mm_shuffle_epi32( r, _MM_SHUFFLE( 2, 1, 0, 3 ) ) ) );
+            return _mm_movemask_ps( _mm_castsi128_ps( match ) );
+        }
+    };
+
+    /*!
+     * \brief The Block8 struct
+     * Blocks of eight tids of right, compared with AVX2 in each of their halves
+     */
+    struct Block8
+    {
+        static constexpr std::size_t width = 8;
+
+        /*!
+         * \brief match
+         * \param left a block of four
+         * \param right a block of eight
+         * \return bit l set when left[ l ] is in right
+         */
+        __attribute__(( target( "avx2" ) ))
+        static inline unsigned int match( const TID * left, const TID * right )
+        {
+            const __m256i l = _mm256_broadcastsi128_si256( _mm_loadu_si128( reinterpret_cast< const __m128i * >( left ) ) );
+            const __m256i r = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( right ) );
+            __m256i match = _mm256_cmpeq_epi32( l, r );
+            match = _mm256_or_si256( match, _mm256_cmpeq_epi32( l, _mm256_shuffle_epi32( r, _MM_SHUFFLE( 0, 3, 2, 1 ) ) ) );
+            match = _mm256_or_si256( match, _mm256_cmpeq_epi32( l, _mm256_shuffle_epi32( r, _MM_SHUFFLE( 1, 0, 3, 2 ) ) ) );
+            match = _mm256_or_si256( match, _mm256_cmpeq_epi32( l, _mm256_shuffle_epi32( r, _MM_SHUFFLE( 2, 1, 0, 3 ) ) ) );
+            const unsigned int mask = _mm256_movemask_ps( _mm256_castsi256_ps( match ) );
+            return ( mask | ( mask >> 4 ) ) & 0xf;
+        }
+    };
+
+    /*!
+     * \brief The Block16 struct
+     * Blocks of sixteen tids of right, compared with AVX-512 in each of their quarters
+     */
+    struct Block16
+    {
+        static constexpr std::size_t width = 16;
+
+        /*!
+         * \brief all_lanes
+         * The zero-masked forms of the intrinsics, with every lane, stand for
+         * the plain forms, which start from an undefined register GCC 12 warns about.
+         */
+        static constexpr __mmask16 all_lanes = 0xffff;
+
+        /*!
+         * \brief match
+         * \param left a block of four
+         * \param right a block of sixteen
+         * \return bit l set when left[ l ] is in right
+         */
+        __attribute__(( target( "avx512f" ) ))
+        static inline unsigned int match( const TID * left, const TID * right )
+        {
+            const __m512i l = _mm512_maskz_broadcast_i32x4( all_lanes, _mm_loadu_si128( reinterpret_cast< const __m128i * >( left ) ) );
+            const __m512i r = _mm512_loadu_si512( right );
+            const unsigned int mask = _mm512_cmpeq_epi32_mask( l, r )
+                    | _mm512_cmpeq_epi32_mask( l, _mm512_maskz_shuffle_epi32( all_lanes, r, _MM_PERM_ADCB ) )
+                    | _mm512_cmpeq_epi32_mask( l, _mm512_maskz_shuffle_epi32( all_lanes, r, _MM_PERM_BADC ) )
+                    | _mm512_cmpeq_epi32_mask( l, _mm512_maskz_shuffle_epi32( all_lanes, r, _MM_PERM_CBAD ) );
+            return ( mask | ( mask >> 4 ) | ( mask >> 8 ) | ( mask >> 12 ) ) & 0xf;
+        }
+    };
+
+    template < typename block, bool store >
+    /*!
+     * \brief difference_blocks compares blocks of four tids of left with blocks of block::width tids of right
+     * Inlined into a kernel compiled for the instructions block uses.
+     * \param left
+     * \param n_left
+     * \param right
+     * \param n_right
+     * \param result
+     * \param limit
+     * \return
+     */
+    static inline std::size_t difference_blocks( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit )
+    {
+        const std::uint8_t ( & controls )[ 16 ][ 16 ] = compress_table();
+        std::size_t i = 0;
+        std::size_t j = 0;
+        std::size_t k = 0;
+        unsigned int found = 0;
+        if ( ( n_left >= 4 ) && ( n_right >= block::width ) ) {
+            for ( ;; ) {
+                found |= block::match( left + i, right + j );
+                const TID l_max = left[ i + 3 ];
+                const TID r_max = right[ j + block::width - 1 ];
+                if ( l_max <= r_max ) {
+                    // Every tid of right equal to one of the block has been compared
+                    k += compress< store >( controls, left + i, ~ found & 0xf, at< store >( result, k ) );
+                    if ( k > limit ) {
+                        return k;
+                    }
+                    found = 0;
+                    i += 4;
+                    if ( i + 4 > n_left ) {
+                        break;
+                    }
+                }
+                if ( r_max <= l_max ) {
+                    j += block::width;
+                    if ( j + block::width > n_right ) {
+                        break;
+                    }
+                }
+            }
+        }
+        return k + difference_tail< store >( left, i, n_left, found, right, j, n_right, at< store >( result, k ), limit - k );
+    }
+
+    template < typename block >
+    /*!
+     * \brief intersection_blocks compares blocks of four tids of left with blocks of block::width tids of right
+     * Inlined into a kernel compiled for the instructions block uses.
+     * \param left
+     * \param n_left
+     * \param right
+     * \param n_right
+     * \param result
+     * \return
+     */
+    static inline std::size_t intersection_blocks( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result )
+    {
+        const std::uint8_t ( & controls )[ 16 ][ 16 ] = compress_table();
+        std::size_t i = 0;
+        std::size_t j = 0;
+        std::size_t k = 0;
+        if ( ( n_left >= 4 ) && ( n_right >= block::width ) ) {
+            for ( ;; ) {
+                k += compress< true >( controls, left + i, block::match( left + i, right + j ), result + k );
+                const TID l_max = left[ i + 3 ];
+                const TID r_max = right[ j + block::width - 1 ];
+                if ( l_max <= r_max ) {
+                    i += 4;
+                    if ( i + 4 > n_left ) {
+                        break;
+                    }
+                }
+                if ( r_max <= l_max ) {
+                    j += block::width;
+                    if ( j + block::width > n_right ) {
+                        break;
+                    }
+                }
+            }
+        }
+        return k + intersection_tail( left, i, n_left, right, j, n_right, result + k );
+    }
+
+    template < bool store >
+    /*!
+     * \brief difference_sse difference_blocks on blocks of four tids of right
+     */
+    __attribute__(( target( "sse4.2,popcnt" ), flatten ))
+    static std::size_t difference_sse( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit )
+    {
+        return difference_blocks< Block4, store >( left, n_left, right, n_right, result, limit );
+    }
+
+    /*!
+     * \brief intersection_sse intersection_blocks on blocks of four tids of right
+     */
+    __attribute__(( target( "sse4.2,popcnt" ), flatten ))
+    static std::size_t intersection_sse( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result )
+    {
+        return intersection_blocks< Block4 >( left, n_left, right, n_right, result );
+    }
+
+    template < bool store >
+    /*!
+     * \brief difference_avx2 difference_blocks on blocks of eight tids of right
+     */
+    __attribute__(( target( "avx2,popcnt" ), flatten ))
+    static std::size_t difference_avx2( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit )
+    {
+        return difference_blocks< Block8, store >( left, n_left, right, n_right, result, limit );
+    }
+
+    /*!
+     * \brief intersection_avx2 intersection_blocks on blocks of eight tids of right
+     */
+    __attribute__(( target( "avx2,popcnt" ), flatten ))
+    static std::size_t intersection_avx2( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result )
+    {
+        return intersection_blocks< Block8 >( left, n_left, right, n_right, result );
+    }
+
+    template < bool store >
+    /*!
+     * \brief difference_avx512 difference_blocks on blocks of sixteen tids of right
+     */
+    __attribute__(( target( "avx512f,popcnt" ), flatten ))
+    static std::size_t difference_avx512( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result, std::size_t limit )
+    {
+        return difference_blocks< Block16, store >( left, n_left, right, n_right, result, limit );
+    }
+
+    /*!
+     * \brief intersection_avx512 intersection_blocks on blocks of sixteen tids of right
+     */
+    __attribute__(( target( "avx512f,popcnt" ), flatten ))
+    static std::size_t intersection_avx512( const TID * left, std::size_t n_left, const TID * right, std::size_t n_right, TID * result )
+    {
+        return intersection_blocks< Block16 >( left, n_left, right, n_right, result );
+    }
+#endif
+
+    /*!
+     * \brief select
+     * \return
+     */
+    static SetKernels select()
+    {
+        SetKernels kernels;
+        kernels.difference = &difference_scalar< true >;
+        kernels.difference_size = &difference_scalar< false >;
+        kernels.intersection = &intersection_scalar;
+        kernels.name = "scalar";
+#ifdef SETKERNELS_X86
+        const CpuFeatures & cpu = CpuFeatures::get();
+        if ( cpu.avx512f && cpu.popcnt ) {
+            kernels.difference = &difference_avx512< true >;
+            kernels.difference_size = &difference_avx512< false >;
+            kernels.intersection = &intersection_avx512;
+            kernels.name = "avx512";
+        }
+        else if ( cpu.avx2 && cpu.popcnt ) {
+            kernels.difference = &difference_avx2< true >;
+            kernels.difference_size = &difference_avx2< false >;
+            kernels.intersection = &intersection_avx2;
+            kernels.name = "avx2";
+        }
+        else if ( cpu.sse42 && cpu.popcnt ) {
+            kernels.difference = &difference_sse< true >;
+            kernels.difference_size = &difference_sse< false >;
+            kernels.intersection = &intersection_sse;
+            kernels.name = "sse4.2";
+        }
+#endif
+        return kernels;
+    }
+};
+
+/*!
+ * \brief count_mistakes
+ * \param diffset
+ * \param other
+ * \return number of tids of other missing in diffset, both sorted
+ */
+inline unsigned int count_mistakes( const Diffset & diffset, const Diffset & other )
+{
+    return SetKernels::get().difference_size( other.data(), other.size(), diffset.data(), diffset.size(), nullptr, other.size() );
+}
+
+#endif // SETKERNELS_HPP
@@ -0,0 +1,213 @@
+#ifndef SHARDMERGE_HPP
+#define SHARDMERGE_HPP
+
+#include "GeneratorSink.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * \brief The ShardSettings struct
+ * Which of the root equivalence classes a run mines. The classes are taken
+ * in the order a whole run mines them and dealt round-robin: shard index of
+ * count mines every count-th one, starting at the index-th.
+ */
+struct ShardSettings
+{
+    ShardSettings() :
+        index( 0 ),
+        count( 1 ) {}
+
+    /*!
+     * \brief enabled
+     * \return
+     */
+    inline bool enabled() const
+    {
+        return count > 1;
+    }
+
+    /*!
+     * \brief owns
+     * \param position of the class in the order a whole run mines them
+     * \return
+     */
+    inline bool owns( const std::size_t position ) const
+    {
+        return index == position % count;
+    }
+
+    unsigned int index;
+    unsigned int count;
+};
+
+/*!
+ * \brief The ShardMerger class
+ * Sink gathering the results of the shards of a run, which writes the
+ * generators of the whole run.
+ * A shard only knows the generators of its own classes, so a candidate
+ * whose subset with the same support lies in another class passes its
+ * is_subsumed check: the shards hold every generator, and some itemsets
+ * that are not. An itemset is a generator if every immediate subset is a
+ * generator of a larger support; subsets are generators first, so the
+ * itemsets are decided shortest first. Every item is a generator, as in a
+ * whole run.
+ */
+class ShardMerger : public GeneratorSink
+{
+public:
+    /*!
+     * \brief ShardMerger
+     */
+    ShardMerger() :
+        _offsets( 1, 0 ) {}
+
+    /*!
+     * \brief close
+     */
+    virtual void close()
+    {
+    }
+
+    /*!
+     * \brief read adds the generators of a shard's result, in the text or the binary format
+     * \param filename
+     */
+    inline void read( const std::string & filename )
+    {
+        const MappedFile file( filename );
+        if ( ( file.size() >= BinaryResult::magic_size ) && ( 0 == std::memcmp( file.data(), BinaryResult::magic(), BinaryResult::magic_size ) ) ) {
+            std::ifstream binary_stream( filename, std::ios::binary );
+            if ( ! BinaryResultConverter::convert( binary_stream, *this ) ) {
+                throw std::runtime_error( "Corrupt binary result: " + filename );
+            }
+            return;
+        }
+        Itemset itemset;
+        const char * position = file.data();
+        const char * const end = position + file.size();
+        while ( position != end ) {
+            // (item item ...) support
+            itemset.clear();
+            if ( '(' != *position ++ ) {
+                throw std::runtime_error( "Not a result: " + filename );
+            }
+            bool closed = false;
+            while ( ! closed ) {
+                char * next = nullptr;
+                itemset.push_back( Item( std::strtol( position, &next, 10 ) ) );
+                if ( ( next == position ) || ( next == end ) || ( ( ' ' != *next ) && ( ')' != *next ) ) ) {
+                    throw std::runtime_error( "Not a result: " + filename );
+                }
+                closed = ( ')' == *next );
+                position = next + 1;
+            }
+            char * next = nullptr;
+            const unsigned long support = std::strtoul( position, &next, 10 );
+            if ( ( next == position ) || ( next == end ) || ( '\n' != *next ) ) {
+                throw std::runtime_error( "Not a result: " + filename );
+            }
+            position = next + 1;
+            ( *this )( itemset.data(), itemset.data() + itemset.size(), support );
+        }
+    }
+
+    /*!
+     * \brief merge writes the generators, in the order they were read
+     * \param min_len shortest generator written
+     * \param sink
+     */
+    inline void merge( const unsigned int min_len, GeneratorSink & sink ) const
+    {
+        const std::size_t n_itemsets = _supports.size();
+        std::vector < std::size_t > by_length( n_itemsets );
+        for ( std::size_t index = 0; index < n_itemsets; ++ index ) {
+            by_length[ index ] = index;
+        }
+        std::stable_sort( by_length.begin(), by_length.end(), [this]( const std::size_t l, const std::size_t r ) {
+            return length( l ) < length( r );
+        } );
+        std::unordered_map< Itemset, unsigned int, itemset_hash > generators;
+        std::vector < char > is_generator( n_itemsets, 0 );
+        Itemset itemset;
+        Itemset subset;
+        for ( const std::size_t index : by_length ) {
+            itemset.assign( _items.cbegin() + _offsets[ index ], _items.cbegin() + _offsets[ index + 1 ] );
+            bool generator = true;
+            if ( itemset.size() > 1 ) {
+                for ( std::size_t skipped = 0; generator && ( skipped < itemset.size() ); ++ skipped ) {
+                    subset.assign( itemset.cbegin(), itemset.cbegin() + skipped );
+                    subset.insert( subset.end(), itemset.cbegin() + skipped + 1, itemset.cend() );
+                    const auto got = generators.find( subset );
+                    generator = ( generators.cend() != got ) && ( got->second > _supports[ index ] );
+                }
+            }
+            if ( generator ) {
+                if ( ! generators.insert( std::make_pair( itemset, _supports[ index ] ) ).second ) {
+                    throw std::runtime_error( "A generator is in more than one shard" );
+                }
+                is_generator[ index ] = 1;
+            }
+        }
+        for ( std::size_t index = 0; index < n_itemsets; ++ index ) {
+            if ( is_generator[ index ] && ( length( index ) >= min_len ) ) {
+                sink( _items.data() + _offsets[ index ], _items.data() + _offsets[ index + 1 ], _supports[ index ] );
+            }
+        }
+    }
+
+protected:
+    /*!
+     * \brief write
+     * \param first
+     * \param last
+     * \param support
+     */
+    virtual void write( const Item * first, const Item * last, const unsigned int support )
+    {
+        // Both formats hold the items of a generator sorted
+        _items.insert( _items.end(), first, last );
+        _offsets.push_back( _items.size() );
+        _supports.push_back( support );
+    }
+
+private:
+    /*!
+     * \brief The itemset_hash class
+     */
+    class itemset_hash {
+    public:
+        std::size_t operator()( const Itemset & itemset ) const
+        {
+            std::size_t hash = itemset.size();
+            for ( const Item item : itemset ) {
+                hash = hash * 1000003u ^ std::size_t( item );
+            }
+            return hash;
+        }
+    };
+
+    /*!
+     * \brief length
+     * \param index
+     * \return
+     */
+    inline std::size_t length( const std::size_t index ) const
+    {
+        return _offsets[ index + 1 ] - _offsets[ index ];
+    }
+
+    std::vector < Item > _items;
+    std::vector < std::uint64_t > _offsets;
+    std::vector < unsigned int > _supports;
+};
+
+#endif // SHARDMERGE_HPP
@@ -0,0 +1,69 @@
+#ifndef SHARDEDTALKYG_HPP
+#define SHARDEDTALKYG_HPP
+
+#include "Talky-G.hpp"
+#include "ShardMerge.hpp"
+
+namespace Talky_G
+{
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief talky_g_shard_mine mines the root equivalence classes of shard
+ * Every frequent item is still a child of the root, as the right sibling
+ * the classes of the shard are joined with.
+ * \param vertical
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param c_set
+ * \param order of the children of every node
+ * \param shard
+ */
+inline void talky_g_shard_mine( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int max_len, cset_type & c_set, const SiblingOrder order, const ShardSettings & shard )
+{
+    typedef BasicNode< diffset_type, item_type > node_type;
+    NodeArena< node_type > arena;
+    auto root_node = make_root_node< diffset_type, item_type >( vertical.transaction_counter );
+    fill_tree( vertical, min_sup, root_node, arena.region( 1 ), order );
+    const auto & children = root_node.children();
+    std::size_t position = 0;
+    // The classes in the order talky_g_traverse mines them, from Left to Right
+    for ( auto curr = children.crbegin(); curr != children.crend(); ++ curr, ++ position ) {
+        if ( shard.owns( position ) ) {
+            save( c_set, *(*curr) );
+            talky_g_extend( curr, children.crbegin(), c_set, min_sup, max_len, arena, 1, order );
+        }
+    }
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g_shard streams the itemsets a shard finds to sink
+ * The result of a shard holds every generator of its classes, and itemsets
+ * only a generator of another shard subsumes; ShardMerger sorts them out.
+ * \param vertical
+ * \param min_sup
+ * \param sink
+ * \param order of the children of every node
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param shard
+ * \return statistics of the generator index
+ */
+inline CSetStatistics talky_g_shard( const VerticalDatabase & vertical, const unsigned int min_sup, GeneratorSink & sink, const SiblingOrder order, const unsigned int max_len, const ShardSettings & shard )
+{
+    auto c_set = BasicCSet< item_type >();
+    LabelWriter writer( vertical.items, sink );
+    if ( saves_subsets_first( order ) ) {
+        StreamingCSet< item_type > streaming_c_set( c_set, writer );
+        talky_g_shard_mine< diffset_type, item_type >( vertical, min_sup, max_len, streaming_c_set, order, shard );
+        return c_set.statistics();
+    }
+    talky_g_shard_mine< diffset_type, item_type >( vertical, min_sup, max_len, c_set, order, shard );
+    c_set.remove_subsumed();
+    write_generators( c_set, SearchBounds(), writer );
+    return c_set.statistics();
+}
+
+}
+
+#endif // SHARDEDTALKYG_HPP
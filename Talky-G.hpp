@@ -5,56 +5,321 @@
 
 #include "Database.hpp"
 #include "Node.hpp"
+#include "BitDiffset.hpp"
+#include "SetKernels.hpp"
+#include "VerticalDatabase.hpp"
+#include "NodeArena.hpp"
+#include "GeneratorSink.hpp"
+#include "Checkpoint.hpp"
+#include "SearchStatistics.hpp"
+#include "SearchBounds.hpp"
 #include <cassert>
 #include <chrono>
+#include <cstdio>
+#include <limits>
 
+namespace Talky_G
+{
+
+template< typename diffset_type, typename item_type >
 /*!
- * \brief ItemMap
+ * \brief is_subsumed
+ * \param c_set
+ * \param node
+ * \return
  */
-typedef std::unordered_map< Item, Tidset, item_hash > ItemMap;
+inline bool is_subsumed(const BasicCSet< item_type > &c_set, const BasicNode< diffset_type, item_type > & node)
+{
+    // Only a generator with the support and the hashkey of node can be one of its subsets with the same tidset
+    return c_set.has_subset( node.hashkey(), node.sup(), node.itemset() );
+}
 
-namespace Talky_G
+/*!
+ * \brief The LabelWriter class
+ * Writes itemsets of dense item ids to a sink, under the labels the items
+ * have in the database and sorted by label.
+ */
+class LabelWriter
 {
+public:
+    /*!
+     * \brief LabelWriter
+     * \param labels label of every dense item id
+     * \param sink
+     */
+    LabelWriter( const std::vector < Item > & labels, GeneratorSink & sink ) :
+        _labels( labels ),
+        _sink( sink ) {}
 
+    template < typename item_type >
+    /*!
+     * \brief operator ()
+     * \param first
+     * \param last
+     * \param support
+     */
+    inline void operator ()( const item_type * first, const item_type * last, const unsigned int support )
+    {
+        _itemset.clear();
+        for ( ; first != last; ++ first ) {
+            _itemset.push_back( _labels[ *first ] );
+        }
+        std::sort( _itemset.begin(), _itemset.end() );
+        _sink( _itemset.data(), _itemset.data() + _itemset.size(), support );
+    }
+
+private:
+    const std::vector < Item > & _labels;
+    GeneratorSink & _sink;
+    Itemset _itemset;
+};
+
+template< typename item_type >
+/*!
+ * \brief The StreamingCSet struct
+ * CSet whose generators also go to a sink as soon as they are saved. In the
+ * serial traversal a saved generator is final, so the sink gets exactly the
+ * result, in the order the CSet holds it. Generators shorter than min_len
+ * are saved but not written.
+ */
+struct StreamingCSet
+{
+    StreamingCSet( BasicCSet< item_type > & c_set, LabelWriter & writer, const unsigned int min_len = 0 ) :
+        c_set( c_set ),
+        writer( writer ),
+        min_len( min_len ) {}
+
+    BasicCSet< item_type > & c_set;
+    LabelWriter & writer;
+    const unsigned int min_len;
+};
+
+template< typename diffset_type, typename item_type >
 /*!
  * \brief is_subsumed
  * \param c_set
  * \param node
  * \return
  */
-inline bool is_subsumed(const CSet &c_set, const Node & node)
-{
-    const Itemset & X = node.itemset();
-    const Diffset & Y = node.diffset();
-    bool is_subsumed = false;
-    const int hashkey = diffset_hash::hash( std::make_pair( Y, node.parent()->hashkey() ) );
-    const auto range = c_set.equal_range( std::make_pair( Y, hashkey ) );
-    for ( auto it = range.first; it != range.second; ++ it ) {
-        const Itemset & C = (*it).second.first;
-        const auto sup = (*it).second.second;
-        if ( node.sup() == sup ) {
-            const bool includes = std::includes( X.cbegin(), X.cend(), C.cbegin(), C.cend() );
-            if ( includes ) {
-                is_subsumed = true;
-                break;
-            }
+inline bool is_subsumed(const StreamingCSet< item_type > &c_set, const BasicNode< diffset_type, item_type > & node)
+{
+    return is_subsumed( c_set.c_set, node );
+}
+
+template< typename item_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline BasicCSet< item_type > & saved_generators( BasicCSet< item_type > & c_set )
+{
+    return c_set;
+}
+
+template< typename item_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline BasicCSet< item_type > & saved_generators( StreamingCSet< item_type > & c_set )
+{
+    return c_set.c_set;
+}
+
+template< typename item_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline BasicConcurrentCSet< item_type > & saved_generators( BasicConcurrentCSet< item_type > & c_set )
+{
+    return c_set;
+}
+
+template< typename item_type >
+/*!
+ * \brief replay
+ * \param c_set restored from a checkpoint, nothing to write
+ */
+inline void replay( BasicCSet< item_type > & )
+{
+}
+
+template< typename item_type >
+/*!
+ * \brief replay writes the generators restored from a checkpoint to the sink
+ * \param c_set
+ */
+inline void replay( StreamingCSet< item_type > & c_set )
+{
+    c_set.c_set.for_each( [&c_set]( const item_type * first, const item_type * last, const unsigned int support ) {
+        if ( std::size_t( last - first ) >= c_set.min_len ) {
+            c_set.writer( first, last, support );
         }
-    }
-    return is_subsumed;
+    } );
 }
 
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief is_subsumed
+ * \param c_set
+ * \param node
+ * \return
+ */
+inline bool is_subsumed(const BasicConcurrentCSet< item_type > &c_set, const BasicNode< diffset_type, item_type > & node)
+{
+    return c_set.visit( node.hashkey(), node.sup(), [&]( const BasicCSet< item_type > & shard ) {
+        return is_subsumed( shard, node );
+    } );
+}
+
+template< typename cset_type >
+/*!
+ * \brief The TopKCSet struct
+ * CSet of a top-k search: the supports of the saved generators raise the
+ * minimal support of the rest of the search. Generators shorter than
+ * min_len are not reported, so they do not count.
+ */
+struct TopKCSet
+{
+    TopKCSet( cset_type & c_set, TopKSupports & supports, const unsigned int min_len ) :
+        c_set( c_set ),
+        supports( supports ),
+        min_len( min_len ) {}
+
+    cset_type & c_set;
+    TopKSupports & supports;
+    const unsigned int min_len;
+};
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief is_subsumed
+ * \param c_set
+ * \param node
+ * \return
+ */
+inline bool is_subsumed(const TopKCSet< cset_type > &c_set, const BasicNode< diffset_type, item_type > & node)
+{
+    return is_subsumed( c_set.c_set, node );
+}
+
+template< typename cset_type >
+/*!
+ * \brief saved_generators
+ * \param c_set
+ * \return the generators saved so far
+ */
+inline cset_type & saved_generators( TopKCSet< cset_type > & c_set )
+{
+    return c_set.c_set;
+}
+
+template< typename item_type >
+/*!
+ * \brief replay counts the generators restored from a checkpoint
+ * \param c_set
+ */
+inline void replay( TopKCSet< BasicCSet< item_type > > & c_set )
+{
+    c_set.c_set.for_each_class( [&c_set]( const int hashkey, const unsigned int support, const item_type * first, const item_type * last ) {
+        if ( std::size_t( last - first ) >= c_set.min_len ) {
+            c_set.supports.offer( hashkey, support );
+        }
+    } );
+}
+
+template< typename cset_type >
+/*!
+ * \brief min_support
+ * \param c_set
+ * \param min_sup
+ * \return support below which nothing is mined any more
+ */
+inline unsigned int min_support( const cset_type &, const unsigned int min_sup )
+{
+    return min_sup;
+}
+
+template< typename cset_type >
+/*!
+ * \brief min_support
+ * \param c_set
+ * \param min_sup
+ * \return support below which nothing is mined any more
+ */
+inline unsigned int min_support( const TopKCSet< cset_type > & c_set, const unsigned int min_sup )
+{
+    return std::max( min_sup, c_set.supports.threshold() );
+}
+
+template< typename itemset_type >
 /*!
  * \brief itemset_union
  * \param itemset_l
  * \param itemset_r
- * \return
+ * \param union_itemset reused buffer
  */
-inline Itemset itemset_union(const Itemset &itemset_l, const Itemset & itemset_r)
+inline void itemset_union(const itemset_type &itemset_l, const itemset_type & itemset_r, itemset_type & union_itemset)
 {
-    Itemset union_itemset( itemset_l.size() + itemset_r.size() );
+    const std::size_t size = itemset_l.size();
+    if ( ( size != 0 ) && ( size == itemset_r.size() ) &&
+         std::equal( itemset_l.cbegin(), itemset_l.cend() - 1, itemset_r.cbegin() ) ) {
+        // Siblings share all but their last item
+        union_itemset.assign( itemset_l.cbegin(), itemset_l.cend() );
+        const auto last_l = itemset_l.back();
+        const auto last_r = itemset_r.back();
+        if ( last_l != last_r ) {
+            union_itemset.back() = std::min( last_l, last_r );
+            union_itemset.push_back( std::max( last_l, last_r ) );
+        }
+        return;
+    }
+    union_itemset.resize( itemset_l.size() + itemset_r.size() );
     auto it_union = std::set_union( itemset_l.cbegin(), itemset_l.cend(), itemset_r.cbegin(), itemset_r.cend(), union_itemset.begin() );
     union_itemset.resize( std::distance(union_itemset.begin(), it_union) );
-    return std::move(union_itemset);
+}
+
+template< std::size_t n_words >
+/*!
+ * \brief itemset_union
+ * \param itemset_l
+ * \param itemset_r
+ * \param union_itemset reused buffer
+ */
+inline void itemset_union(const BitItemset< n_words > &itemset_l, const BitItemset< n_words > & itemset_r, BitItemset< n_words > & union_itemset)
+{
+    ItemMask< n_words > mask( itemset_l.mask() );
+    union_itemset.assign( mask |= itemset_r.mask() );
+}
+
+template< typename itemset_type >
+/*!
+ * \brief itemset_union
+ * \param itemset_l
+ * \param itemset_r
+ * \return
+ */
+inline itemset_type itemset_union(const itemset_type &itemset_l, const itemset_type & itemset_r)
+{
+    itemset_type union_itemset;
+    itemset_union( itemset_l, itemset_r, union_itemset );
+    return union_itemset;
+}
+
+/*!
+ * \brief tidset_intersection
+ * \param tidset_l
+ * \param tidset_r
+ * \param resutl_tidset reused buffer
+ */
+inline void tidset_intersection(const Tidset &tidset_l, const Tidset &tidset_r, Tidset & resutl_tidset)
+{
+    resutl_tidset.resize( std::min( tidset_l.size(), tidset_r.size() ) + SetKernels::padding );
+    resutl_tidset.resize( SetKernels::get().intersection( tidset_r.data(), tidset_r.size(), tidset_l.data(), tidset_l.size(), resutl_tidset.data() ) );
 }
 
 /*!
@@ -65,168 +330,785 @@ inline Itemset itemset_union(const Itemset &itemset_l, const Itemset & itemset_r
  */
 inline Tidset tidset_intersection(const Tidset &tidset_l, const Tidset &tidset_r)
 {
-    Tidset resutl_tidset( tidset_l.size() + tidset_r.size() );
-    const auto it = std::set_intersection( tidset_r.cbegin(), tidset_r.cend(), tidset_l.cbegin(), tidset_l.cend(), resutl_tidset.begin() );
-    resutl_tidset.resize( std::distance( resutl_tidset.begin(), it ) );
-    return std::move(resutl_tidset);
+    Tidset resutl_tidset;
+    tidset_intersection( tidset_l, tidset_r, resutl_tidset );
+    return resutl_tidset;
+}
+
+/*!
+ * \brief diffset_difference
+ * \param diffset_l
+ * \param diffset_r
+ * \param result_diffset reused buffer, diffset_r without diffset_l, or more than limit of its tids
+ * \param limit the difference stops once it is known to be larger
+ */
+inline void diffset_difference(const Diffset &diffset_l, const Diffset & diffset_r, Diffset & result_diffset, const std::size_t limit)
+{
+    result_diffset.resize( std::min( diffset_r.size(), limit + 1 ) + SetKernels::padding );
+    const std::size_t size = SetKernels::get().difference( diffset_r.data(), diffset_r.size(), diffset_l.data(), diffset_l.size(), result_diffset.data(), limit );
+    // A difference that stopped early keeps limit + 1 tids, however many the kernel counted or stored
+    result_diffset.resize( std::min( size, std::min( diffset_r.size(), limit + 1 ) ) );
+}
+
+/*!
+ * \brief diffset_difference
+ * \param diffset_l
+ * \param diffset_r
+ * \param result_diffset reused buffer, diffset_r without diffset_l
+ */
+inline void diffset_difference(const Diffset &diffset_l, const Diffset & diffset_r, Diffset & result_diffset)
+{
+    diffset_difference( diffset_l, diffset_r, result_diffset, diffset_r.size() );
+}
+
+/*!
+ * \brief diffset_difference
+ * \param diffset_l
+ * \param diffset_r
+ * \param result_diffset reused buffer, diffset_r without diffset_l, or more than limit of its tids
+ * \param limit the difference stops once it is known to be larger
+ */
+inline void diffset_difference(const BitDiffset &diffset_l, const BitDiffset & diffset_r, BitDiffset & result_diffset, const std::size_t limit)
+{
+    BitDiffset::difference( diffset_r, diffset_l, result_diffset, limit );
 }
 
+/*!
+ * \brief diffset_difference
+ * \param diffset_l
+ * \param diffset_r
+ * \param result_diffset reused buffer, diffset_r without diffset_l
+ */
+inline void diffset_difference(const BitDiffset &diffset_l, const BitDiffset & diffset_r, BitDiffset & result_diffset)
+{
+    BitDiffset::difference( diffset_r, diffset_l, result_diffset );
+}
+
+template< typename diffset_type >
 /*!
  * \brief diffset_difference
  * \param diffset_l
  * \param diffset_r
  * \return
  */
-inline Diffset diffset_difference(const Diffset &diffset_l, const Diffset & diffset_r)
+inline diffset_type diffset_difference(const diffset_type &diffset_l, const diffset_type & diffset_r)
 {
-    Diffset result_diffset( diffset_l.size() + diffset_r.size() );
-    auto it = std::set_difference( diffset_r.cbegin(), diffset_r.cend(), diffset_l.cbegin(), diffset_l.cend(), result_diffset.begin() );
-    result_diffset.resize( std::distance(result_diffset.begin(), it) );
-    return std::move(result_diffset);
+    diffset_type result_diffset;
+    diffset_difference( diffset_l, diffset_r, result_diffset );
+    return result_diffset;
 }
 
+template< typename diffset_type, typename item_type >
 /*!
  * \brief save
  * \param c_set
  * \param child
  */
-inline void save(CSet & c_set, const Node & child)
+inline void save(BasicCSet< item_type > & c_set, const BasicNode< diffset_type, item_type > & child)
 {
-    c_set.insert( CSet::value_type( cset_key_t( child.diffset(), child.parent()->hashkey() ), cset_val_t( child.itemset(), child.sup() ) ) );
+    c_set.insert( child.hashkey(), child.itemset(), child.sup() );
 }
 
+template< typename diffset_type, typename item_type >
 /*!
- * \brief is_null
- * \param node
+ * \brief save
+ * \param c_set
+ * \param child
+ */
+inline void save(StreamingCSet< item_type > & c_set, const BasicNode< diffset_type, item_type > & child)
+{
+    save( c_set.c_set, child );
+    const auto & itemset = child.itemset();
+    if ( itemset.size() >= c_set.min_len ) {
+        c_set.writer( itemset.data(), itemset.data() + itemset.size(), child.sup() );
+    }
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief save
+ * \param c_set
+ * \param child
+ */
+inline void save(BasicConcurrentCSet< item_type > & c_set, const BasicNode< diffset_type, item_type > & child)
+{
+    c_set.insert( child.hashkey(), child.itemset(), child.sup() );
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief save
+ * \param c_set
+ * \param child
+ */
+inline void save(TopKCSet< cset_type > & c_set, const BasicNode< diffset_type, item_type > & child)
+{
+    save( c_set.c_set, child );
+    if ( child.itemset().size() >= c_set.min_len ) {
+        c_set.supports.offer( child.hashkey(), child.sup() );
+    }
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief join_tids fills the diffset of the join of curr and other, its right sibling
+ * \param curr
+ * \param other
+ * \param candidate
+ * \param limit largest diffset of a frequent candidate, the join stops past it
+ */
+inline void join_tids(const BasicNode< diffset_type, item_type > & curr, const BasicNode< diffset_type, item_type > & other, BasicNode< diffset_type, item_type > & candidate, const std::size_t limit)
+{
+    diffset_difference( curr.diffset(), other.diffset(), candidate.diffset(), limit );
+}
+
+template< typename item_type >
+/*!
+ * \brief join_tids fills the tids of the join of curr and other, its right sibling
+ * A sibling's diffset is its tidset's complement within the tidset of the
+ * parent, so a join with a tidset yields a tidset: t(PXY) = t(PX) - d(PY).
+ * Only two diffsets yield a diffset, against curr, and only that join is
+ * bounded.
+ * \param curr
+ * \param other
+ * \param candidate
+ * \param limit largest diffset of a frequent candidate, the join stops past it
+ */
+inline void join_tids(const BasicNode< Diffset, item_type > & curr, const BasicNode< Diffset, item_type > & other, BasicNode< Diffset, item_type > & candidate, const std::size_t limit)
+{
+    if ( curr.is_tidset() ) {
+        if ( other.is_tidset() ) {
+            tidset_intersection( curr.diffset(), other.diffset(), candidate.diffset() );
+        }
+        else {
+            diffset_difference( other.diffset(), curr.diffset(), candidate.diffset() );
+        }
+    }
+    else if ( other.is_tidset() ) {
+        // t(PY) - d(PX)
+        diffset_difference( curr.diffset(), other.diffset(), candidate.diffset() );
+    }
+    else {
+        diffset_difference( curr.diffset(), other.diffset(), candidate.diffset(), limit );
+    }
+    candidate.set_tidset( curr.is_tidset() || other.is_tidset() );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief shrink_tids bitmaps always hold diffsets
+ */
+inline void shrink_tids(const BasicNode< diffset_type, item_type > &, BasicNode< diffset_type, item_type > &)
+{
+}
+
+template< typename item_type >
+/*!
+ * \brief shrink_tids switches a generator from its tidset to its diffset against curr once that is smaller
+ * The diffset is taken from the tidset of curr, so a tidset below a
+ * diffset stays one; the children of either form are joined alike.
+ * \param curr
+ * \param candidate attached to curr
+ */
+inline void shrink_tids(const BasicNode< Diffset, item_type > & curr, BasicNode< Diffset, item_type > & candidate)
+{
+    if ( candidate.is_tidset() && curr.is_tidset() && ( 2 * candidate.sup() >= curr.sup() ) ) {
+        static thread_local Diffset diffset;
+        diffset_difference( candidate.diffset(), curr.diffset(), diffset );
+        candidate.diffset().swap( diffset );
+        candidate.set_tidset( false );
+    }
+}
+
+/*!
+ * \brief holds_tidsets
+ * \return
+ */
+inline bool holds_tidsets(const Diffset &)
+{
+    return true;
+}
+
+/*!
+ * \brief holds_tidsets
  * \return
  */
-inline bool is_null(const Node & node)
+inline bool holds_tidsets(const BitDiffset &)
+{
+    return false;
+}
+
+template< typename cset_type, typename node_type >
+/*!
+ * \brief explores
+ * \param c_set
+ * \param curr
+ * \param other
+ * \return false if the join of curr and other is not to be mined at all
+ */
+inline bool explores(const cset_type &, const node_type &, const node_type &)
 {
-    return ( node.diffset().empty() || node.itemset().empty() );
+    return true;
 }
 
+template< typename diffset_type, typename item_type, typename cset_type >
 /*!
  * \brief get_next_generator
  * \param curr
  * \param other
  * \param c_set
  * \param min_sup
- * \return
+ * \param candidate node filled in place
+ * \param counters of the calling thread
+ * \return true if candidate is a generator
  */
-inline Node get_next_generator(const Node & curr, const Node & other, const CSet & c_set, const unsigned int min_sup)
+inline bool get_next_generator(const BasicNode< diffset_type, item_type > & curr, const BasicNode< diffset_type, item_type > & other, const cset_type & c_set, const unsigned int min_sup, BasicNode< diffset_type, item_type > & candidate, SearchCounters & counters)
 {
-    Diffset cand_diffset = diffset_difference( curr.diffset(), other.diffset() );
-    const unsigned int cand_sup = curr.sup() - cand_diffset.size();
+    if ( ! explores( c_set, curr, other ) ) {
+        return false;
+    }
+    ++ counters.candidates;
+    // A diffset past curr.sup() - min_sup is not finished, the candidate is infrequent anyway
+    join_tids( curr, other, candidate, curr.sup() - min_sup );
+    const unsigned int cand_sup = candidate.is_tidset() ? candidate.diffset().size() : ( curr.sup() - candidate.diffset().size() );
     // Check support
     if ( cand_sup < min_sup ) {
-        return Node(); // Return null
+        ++ counters.rejected_support;
+        return false;
     }
 
     // Check equality
-    Itemset cand_itemset = itemset_union( curr.itemset(), other.itemset() );
     const bool equal_to_curr = curr.sup() == cand_sup;
     const bool equal_to_other = other.sup() == cand_sup;
 
     if ( equal_to_curr || equal_to_other ) {
-        return Node(); // Return null
+        counters.rejected_equal_curr += equal_to_curr;
+        counters.rejected_equal_other += ! equal_to_curr;
+        return false;
     }
-    const Node cand_node( std::move(cand_itemset), std::move(cand_diffset), &curr );
-    if ( is_subsumed( c_set, cand_node ) ) {
-        return Node();
+    itemset_union( curr.itemset(), other.itemset(), candidate.itemset() );
+    candidate.attach( &curr );
+    if ( is_subsumed( c_set, candidate ) ) {
+        ++ counters.rejected_subsumed;
+        return false;
     }
-    return cand_node;
+    shrink_tids( curr, candidate );
+    return true;
 }
 
 
-template< typename node_iterator >
+template< typename node_iterator, typename cset_type, typename node_type >
 /*!
- * \brief talky_g_extend
+ * \brief add_generators adds the generators of curr and its right siblings as children of curr
  * \param curr
  * \param right_margin
  * \param c_set
  * \param min_sup
+ * \param region region the children are taken from
+ * \param order of the children
+ */
+inline void add_generators(const node_iterator & curr, const node_iterator & right_margin, const cset_type &c_set, const unsigned int min_sup, NodeRegion< node_type > & region, const SiblingOrder order)
+{
+    auto & current_child = (*(*curr));
+    SearchCounters & counters = SearchCounters::local();
+    const unsigned int current_min_sup = min_support( c_set, min_sup );
+    for ( auto it = curr - 1; std::distance( right_margin, it ) >= 0; --it ) {
+        const auto & other = (*(*it));
+        node_type & candidate = region.acquire();
+        if ( get_next_generator( current_child, other, c_set, current_min_sup, candidate, counters ) ) {
+            counters.count_node( candidate.itemset().size() );
+            current_child.add_child( &candidate );
+        }
+        else {
+            region.release_last();
+        }
+    }
+    current_child.order_children( order );
+}
+
+/*!
+ * \brief The NoCheckpoint struct
+ * Checkpoint policy of a traversal that is never saved.
+ */
+struct NoCheckpoint
+{
+    template< typename stack_type >
+    inline void operator ()( const stack_type & ) const
+    {
+    }
+};
+
+template< typename node_type, typename cset_type, typename checkpoint_type >
+/*!
+ * \brief talky_g_traverse mines the subtrees below the nodes on stack
+ * The traversal keeps its path in stack instead of the call stack, so the
+ * depth of the tree is not limited by the thread's stack and the whole
+ * state can be saved between two steps. The children of every node on
+ * stack are already generated. A step takes the next child of the last
+ * frame, from Left to Right, saves it and pushes its own children; a frame
+ * without children left is popped and its region reset. A child that fell
+ * below the minimal support of c_set since it was generated is dropped
+ * with its subtree.
+ * \param stack
+ * \param depth depth of the node of the first frame
+ * \param c_set
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param arena
+ * \param order of the children
+ * \param checkpoint called with stack before every step
  */
-inline void talky_g_extend(node_iterator & curr, const node_iterator & right_margin, CSet &c_set, const unsigned int min_sup)
+inline void talky_g_traverse(std::vector< TraversalFrame< node_type > > & stack, const unsigned int depth, cset_type &c_set, const unsigned int min_sup, const unsigned int max_len, NodeArena< node_type > & arena, const SiblingOrder order, checkpoint_type & checkpoint)
 {
-    Node & current_child = (*(*curr));
-    if ( std::distance( right_margin, curr ) >= 1 ) {
-        for ( auto it = curr - 1; std::distance( right_margin, it ) >= 0; --it ) {
-            const Node & other = (*(*it));
-            const auto generator = get_next_generator( current_child, other, c_set, min_sup );
-            if ( ! is_null( generator ) ) {
-                current_child.add_child( generator );
+    while ( ! stack.empty() ) {
+        checkpoint( stack );
+        TraversalFrame< node_type > & frame = stack.back();
+        const unsigned int node_depth = depth + stack.size() - 1;
+        node_type & node = *frame.node;
+        if ( ! frame.next ) {
+            // Only the generators in c_set outlive the subtree
+            node.clear_children();
+            arena.region( node_depth + 1 ).reset();
+            stack.pop_back();
+            continue;
+        }
+        const auto & children = node.children();
+        const std::size_t index = -- frame.next;
+        node_type & child = *children[ index ];
+        if ( child.sup() < min_support( c_set, min_sup ) ) {
+            continue;
+        }
+        save( c_set, child );
+        if ( ( index + 1 < children.size() ) && within_length( node_depth + 2, max_len ) ) {
+            const auto curr = children.crbegin() + ( children.size() - 1 - index );
+            add_generators( curr, children.crbegin(), c_set, min_sup, arena.region( node_depth + 2 ), order );
+            if ( ! child.children().empty() ) {
+                stack.push_back( TraversalFrame< node_type >( &child, child.children().size() ) );
             }
         }
-        // Loop over the children of curr from Left to Right
-        for ( auto it = current_child.children().crbegin(); it != current_child.children().crend(); ++ it ) {
-            const Node & child = (*(*it));
-            save( c_set, child );
-            talky_g_extend( it, current_child.children().crbegin(), c_set, min_sup );
+    }
+}
+
+template< typename node_iterator, typename cset_type, typename node_type >
+/*!
+ * \brief talky_g_extend mines the subtree of curr, already saved
+ * \param curr
+ * \param right_margin
+ * \param c_set
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param arena
+ * \param depth depth of curr
+ * \param order of the children
+ */
+inline void talky_g_extend(node_iterator & curr, const node_iterator & right_margin, cset_type &c_set, const unsigned int min_sup, const unsigned int max_len, NodeArena< node_type > & arena, const unsigned int depth, const SiblingOrder order)
+{
+    auto & current_child = (*(*curr));
+    if ( ( std::distance( right_margin, curr ) >= 1 ) && within_length( depth + 1, max_len ) ) {
+        add_generators( curr, right_margin, c_set, min_sup, arena.region( depth + 1 ), order );
+        std::vector< TraversalFrame< node_type > > stack( 1, TraversalFrame< node_type >( &current_child, current_child.children().size() ) );
+        NoCheckpoint checkpoint;
+        talky_g_traverse( stack, depth, c_set, min_sup, max_len, arena, order, checkpoint );
+    }
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief make_root_node
+ * \param transaction_counter
+ * \return node of the empty itemset
+ */
+inline BasicNode< diffset_type, item_type > make_root_node( const TID transaction_counter )
+{
+    // Hashkeys are sums of tids, whether taken from a tidset or from the parent and a diffset
+    const unsigned int sum_of_trans_id = std::uint64_t( transaction_counter ) * ( std::uint64_t( transaction_counter ) + 1 ) / 2;
+    return BasicNode< diffset_type, item_type >( typename BasicNode< diffset_type, item_type >::itemset_type(), diffset_type(), transaction_counter, sum_of_trans_id );
+}
+
+template< typename item_type, typename tid_range >
+/*!
+ * \brief assign_tids
+ * \param node
+ * \param tids
+ * \param is_tidset whether tids is the tidset of node or its diffset against the parent
+ */
+inline void assign_tids( BasicNode< Diffset, item_type > & node, const tid_range & tids, const TID, const bool is_tidset )
+{
+    node.diffset().assign( tids.cbegin(), tids.cend() );
+    node.set_tidset( is_tidset );
+}
+
+template< typename item_type, typename tid_range >
+/*!
+ * \brief assign_tids
+ * Bitmaps hold diffsets only: a tidset is taken as the one of a child of
+ * the root and complemented against all transactions.
+ * \param node
+ * \param tids
+ * \param transaction_counter
+ * \param is_tidset whether tids is the tidset of node or its diffset against the parent
+ */
+inline void assign_tids( BasicNode< BitDiffset, item_type > & node, const tid_range & tids, const TID transaction_counter, const bool is_tidset )
+{
+    if ( ! is_tidset ) {
+        node.diffset() = BitDiffset( tids, transaction_counter );
+        return;
+    }
+    Diffset diffset;
+    diffset.reserve( transaction_counter - tids.size() );
+    auto it = tids.cbegin();
+    for ( TID tid = 1; tid <= transaction_counter; ++ tid ) {
+        if ( ( tids.cend() != it ) && ( *it == tid ) ) {
+            ++ it;
+        }
+        else {
+            diffset.push_back( tid );
         }
     }
+    node.diffset() = BitDiffset( diffset, transaction_counter );
 }
 
 /*!
- * \brief talky_g
- * \param database
+ * \brief prefer_bitmap
+ * A sorted tidset or diffset takes 32 bits per tid, a BitDiffset one bit
+ * per transaction: bitmaps are chosen when the frequent items' tids, in
+ * whichever form the vertical database keeps them, hold on average more
+ * than one transaction in 32.
+ * \param vertical
  * \param min_sup
  * \return
  */
-inline CSet talky_g( const Database & database, const unsigned int min_sup )
+inline bool prefer_bitmap( const VerticalDatabase & vertical, const unsigned int min_sup )
 {
-    ItemMap item_map;
-    // For each itemset
-    TID transaction_counter = 1;
-    std::for_each( database.cbegin(), database.cend(), [&] ( const Itemset & itemset ) {
-        // For each item in the itemset
-        std::for_each( itemset.cbegin(), itemset.cend(), [&]( const Item & item ) {
-            // If there is such item increase it's support
-            const auto got = item_map.find( item );
-            if ( item_map.cend() != got ) {
-                got->second.push_back( transaction_counter );
-            }
-            else {
-                Tidset new_tidset( 1 );
-                new_tidset.at( 0 ) = transaction_counter;
-                item_map.insert( std::make_pair( item, new_tidset ) );
-            }
-        } );
-        ++ transaction_counter;
+    std::size_t n_frequent = 0;
+    std::size_t tid_sizes = 0;
+    for ( std::size_t index = 0; index < vertical.size(); ++ index ) {
+        if ( min_sup <= vertical.supports[ index ] ) {
+            ++ n_frequent;
+            tid_sizes += vertical.item_tids( index ).size();
+        }
+    }
+    return n_frequent && ( tid_sizes * 32 >= n_frequent * std::size_t( vertical.transaction_counter ) );
+}
+
+template< typename diffset_type, typename miner_type >
+/*!
+ * \brief with_item_type runs miner with the narrowest item type holding every dense item id
+ * Up to 256 items, itemsets are bitmasks of the fewest words holding them.
+ * \param vertical
+ * \param miner has run< diffset_type, item_type >()
+ * \return what run returns
+ */
+inline auto with_item_type( const VerticalDatabase & vertical, const miner_type & miner ) -> decltype( miner.template run< diffset_type, Item >() )
+{
+    if ( vertical.size() <= 64 ) {
+        return miner.template run< diffset_type, SmallItem< 1 > >();
+    }
+    if ( vertical.size() <= 128 ) {
+        return miner.template run< diffset_type, SmallItem< 2 > >();
+    }
+    if ( vertical.size() <= 256 ) {
+        return miner.template run< diffset_type, SmallItem< 4 > >();
+    }
+    if ( vertical.size() <= std::numeric_limits< std::uint16_t >::max() + 1u ) {
+        return miner.template run< diffset_type, std::uint16_t >();
+    }
+    return miner.template run< diffset_type, Item >();
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief fill_tree adds the frequent items as children of root_node
+ * An item is known by its dense id, its position in vertical.
+ * \param vertical
+ * \param min_sup
+ * \param root_node
+ * \param region region of the root's children
+ * \param order of the root's children
+ */
+inline void fill_tree( const VerticalDatabase & vertical, const unsigned int min_sup, BasicNode< diffset_type, item_type > & root_node, NodeRegion< BasicNode< diffset_type, item_type > > & region, const SiblingOrder order )
+{
+    ScopedPhase phase( "tree_fill" );
+    SearchCounters & counters = SearchCounters::local();
+    for ( std::size_t index = 0; index < vertical.size(); ++ index ) {
+        if ( min_sup <= vertical.supports[ index ] ) {
+            counters.count_node( 1 );
+            auto & child = region.acquire();
+            child.itemset().assign( 1, item_type( index ) );
+            assign_tids( child, vertical.item_tids( index ), vertical.transaction_counter, vertical.is_tidset( index ) );
+            child.attach( &root_node );
+            root_node.add_child( &child );
+        }
+    }
+    root_node.order_children( order );
+}
+
+template< typename node_type, typename item_type >
+/*!
+ * \brief save_checkpoint
+ * A checkpoint holds the generators saved so far, in the order they were
+ * saved, then every frame of the stack: how many children are still to be
+ * mined and the itemset, form and tids of every child. The node of a frame is
+ * not stored, it is the next child of the frame before it, or the root.
+ * \param filename
+ * \param header
+ * \param c_set
+ * \param stack
+ */
+inline void save_checkpoint( const std::string & filename, const CheckpointHeader & header, const BasicCSet< item_type > & c_set, const std::vector< TraversalFrame< node_type > > & stack )
+{
+    CheckpointWriter writer( filename, header );
+    writer.put< std::uint64_t >( c_set.size() );
+    c_set.for_each_entry( [&writer]( const int hashkey, const unsigned int support, const item_type * first, const item_type * last ) {
+        writer.put< std::int32_t >( hashkey );
+        writer.put< std::uint32_t >( support );
+        writer.put< std::uint32_t >( last - first );
+        writer.put( first, last - first );
     } );
-    --transaction_counter;
-//    std::cerr << "transaction_counter = " << transaction_counter << std::endl;
-
-    // Translate tidset into diffset
-    std::for_each( item_map.begin(), item_map.end(), [&]( ItemMap::reference key_value ) {
-        const auto tidset = std::move( key_value.second );
-        // Transfort to a diffset
-        for ( auto index = 1; index <= transaction_counter; ++ index ) {
-            if ( tidset.cend() == std::find( tidset.cbegin(), tidset.cend(), index ) ) {
-                key_value.second.push_back( index );
+    writer.put< std::uint64_t >( stack.size() );
+    Diffset tids;
+    for ( const auto & frame : stack ) {
+        const auto & children = frame.node->children();
+        writer.put< std::uint64_t >( frame.next );
+        writer.put< std::uint64_t >( children.size() );
+        for ( const auto child : children ) {
+            writer.put< std::uint32_t >( child->itemset().size() );
+            writer.put( child->itemset().data(), child->itemset().size() );
+            tids.assign( child->diffset().cbegin(), child->diffset().cend() );
+            writer.put< std::uint8_t >( child->is_tidset() );
+            writer.put< std::uint32_t >( tids.size() );
+            writer.put( tids.data(), tids.size() );
+        }
+    }
+    writer.commit();
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief restore_checkpoint rebuilds the state save_checkpoint saved
+ * Support and hashkey of every node follow from its parent and tids, as
+ * they did when it was generated.
+ * \param filename
+ * \param header of the run
+ * \param c_set empty, receives the saved generators
+ * \param root_node
+ * \param arena
+ * \param stack empty, receives the frames
+ */
+inline void restore_checkpoint( const std::string & filename, const CheckpointHeader & header, BasicCSet< item_type > & c_set, BasicNode< diffset_type, item_type > & root_node, NodeArena< BasicNode< diffset_type, item_type > > & arena, std::vector< TraversalFrame< BasicNode< diffset_type, item_type > > > & stack )
+{
+    typedef BasicNode< diffset_type, item_type > node_type;
+    CheckpointReader reader( filename );
+    if ( ! ( reader.header() == header ) ) {
+        throw std::runtime_error( "Checkpoint was written by another run: " + filename );
+    }
+    std::vector < item_type > itemset;
+    const std::uint64_t n_generators = reader.get< std::uint64_t >();
+    for ( std::uint64_t generator = 0; generator < n_generators; ++ generator ) {
+        const int hashkey = reader.get< std::int32_t >();
+        const unsigned int support = reader.get< std::uint32_t >();
+        itemset.resize( reader.get< std::uint32_t >() );
+        reader.get( itemset.data(), itemset.size() );
+        c_set.insert( hashkey, itemset, support );
+    }
+    const std::uint64_t n_frames = reader.get< std::uint64_t >();
+    Diffset tids;
+    node_type * node = &root_node;
+    for ( std::uint64_t depth = 0; depth < n_frames; ++ depth ) {
+        const std::uint64_t next = reader.get< std::uint64_t >();
+        const std::uint64_t n_children = reader.get< std::uint64_t >();
+        if ( ! node || ( next > n_children ) ) {
+            throw std::runtime_error( "Corrupt checkpoint: " + filename );
+        }
+        NodeRegion< node_type > & region = arena.region( depth + 1 );
+        for ( std::uint64_t index = 0; index < n_children; ++ index ) {
+            node_type & child = region.acquire();
+            itemset.resize( reader.get< std::uint32_t >() );
+            reader.get( itemset.data(), itemset.size() );
+            child.itemset().assign( itemset.cbegin(), itemset.cend() );
+            const bool is_tidset = reader.get< std::uint8_t >();
+            if ( is_tidset && depth && ! holds_tidsets( child.diffset() ) ) {
+                throw std::runtime_error( "Checkpoint holds tidsets below the items, resume with --diffset vector: " + filename );
             }
+            tids.resize( reader.get< std::uint32_t >() );
+            reader.get( tids.data(), tids.size() );
+            assign_tids( child, tids, TID( header.transaction_counter ), is_tidset );
+            child.attach( node );
+            node->add_child( &child );
+        }
+        stack.push_back( TraversalFrame< node_type >( node, next ) );
+        node = ( next < n_children ) ? node->children()[ next ] : nullptr;
+    }
+}
+
+template< typename diffset_type, typename item_type, typename cset_type >
+/*!
+ * \brief talky_g_mine
+ * \param vertical
+ * \param min_sup
+ * \param max_len longest itemset generated, 0 for no bound
+ * \param c_set
+ * \param order of the children of every node
+ * \param checkpoint where the state is saved, and whether the run resumes from it
+ */
+inline void talky_g_mine( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int max_len, cset_type & c_set, const SiblingOrder order, const CheckpointSettings & checkpoint = CheckpointSettings() )
+{
+    typedef BasicNode< diffset_type, item_type > node_type;
+    NodeArena< node_type > arena;
+    auto root_node = make_root_node< diffset_type, item_type >( vertical.transaction_counter );
+    std::vector< TraversalFrame< node_type > > stack;
+    const CheckpointHeader header = CheckpointHeader::make( sizeof( item_type ), min_sup, max_len, std::uint32_t( order ), vertical.transaction_counter, vertical.size() );
+    if ( checkpoint.resume && CheckpointReader::exists( checkpoint.filename ) ) {
+        restore_checkpoint( checkpoint.filename, header, saved_generators( c_set ), root_node, arena, stack );
+        replay( c_set );
+    }
+    else {
+        fill_tree( vertical, min_sup, root_node, arena.region( 1 ), order );
+        stack.push_back( TraversalFrame< node_type >( &root_node, root_node.children().size() ) );
+    }
+    if ( ! checkpoint.enabled() ) {
+        NoCheckpoint no_checkpoint;
+        talky_g_traverse( stack, 0, c_set, min_sup, max_len, arena, order, no_checkpoint );
+        return;
+    }
+    CheckpointTimer timer( checkpoint.interval );
+    auto periodic_checkpoint = [&]( const std::vector< TraversalFrame< node_type > > & stack ) {
+        if ( timer.due() ) {
+            save_checkpoint( checkpoint.filename, header, saved_generators( c_set ), stack );
         }
+    };
+    talky_g_traverse( stack, 0, c_set, min_sup, max_len, arena, order, periodic_checkpoint );
+    // A finished run leaves nothing to resume
+    std::remove( checkpoint.filename.c_str() );
+}
+
+/*!
+ * \brief saves_subsets_first
+ * Support and item frequency orders mine every generator before its
+ * supersets, as the traversal requires. Diffset size order puts siblings in
+ * descending support order instead, so its result is swept with
+ * remove_subsumed rather than trusted.
+ * \param order
+ * \return
+ */
+inline bool saves_subsets_first( const SiblingOrder order )
+{
+    return SiblingOrder::DiffsetSize != order;
+}
+
+template< typename item_type >
+/*!
+ * \brief relabel
+ * \param c_set generators of dense item ids
+ * \param labels label of every dense item id
+ * \return the generators under their labels
+ */
+inline CSet relabel( const BasicCSet< item_type > & c_set, const std::vector < Item > & labels )
+{
+    CSet labelled;
+    Itemset itemset;
+    c_set.for_each_class( [&]( const int hashkey, const unsigned int support, const item_type * first, const item_type * last ) {
+        itemset.clear();
+        for ( ; first != last; ++ first ) {
+            itemset.push_back( labels[ *first ] );
+        }
+        std::sort( itemset.begin(), itemset.end() );
+        labelled.insert( hashkey, itemset, support );
     } );
-    // Fill the tree
-    const unsigned int sum_of_trans_id = transaction_counter * (transaction_counter - 1) / 2;
-    Node root_node( Itemset(), Diffset(), transaction_counter, sum_of_trans_id );
-    {
-        std::for_each( item_map.cbegin(), item_map.cend(), [&]( ItemMap::const_reference key_value ) {
-            if ( min_sup <= (transaction_counter - key_value.second.size()) ) {
-                Itemset itemset;
-                itemset.push_back( key_value.first );
-                Diffset diffset = key_value.second;
-                root_node.add_child( std::move( itemset ), std::move( diffset ) );
+    return labelled;
+}
+
+template< typename cset_type >
+/*!
+ * \brief write_generators writes the generators bounds reports
+ * \param c_set final generators
+ * \param bounds
+ * \param writer
+ */
+inline void write_generators( const cset_type & c_set, const SearchBounds & bounds, LabelWriter & writer )
+{
+    unsigned int reported_sup = 0;
+    if ( bounds.top_k ) {
+        std::vector < unsigned int > supports;
+        c_set.for_each( [&]( const typename cset_type::itemset_type::value_type * first, const typename cset_type::itemset_type::value_type * last, const unsigned int support ) {
+            if ( std::size_t( last - first ) >= bounds.min_len ) {
+                supports.push_back( support );
             }
         } );
+        reported_sup = kth_support( supports, bounds.top_k );
     }
+    c_set.for_each( [&]( const typename cset_type::itemset_type::value_type * first, const typename cset_type::itemset_type::value_type * last, const unsigned int support ) {
+        if ( ( std::size_t( last - first ) >= bounds.min_len ) && ( support >= reported_sup ) ) {
+            writer( first, last, support );
+        }
+    } );
+}
+
+template< typename diffset_type >
+/*!
+ * \brief talky_g
+ * \param vertical
+ * \param min_sup
+ * \param order of the children of every node
+ * \return
+ */
+inline CSet talky_g( const VerticalDatabase & vertical, const unsigned int min_sup, const SiblingOrder order = SiblingOrder::Support )
+{
     auto c_set = CSet();
-    // Loop over children of root Right to Left
-    for ( auto it = root_node.children().crbegin(); it != root_node.children().crend(); ++ it ) {
-        Node & current_child = (*(*it));
-        save( c_set, current_child );
-        talky_g_extend( it, root_node.children().crbegin(), c_set, min_sup );
+    talky_g_mine< diffset_type, Item >( vertical, min_sup, 0, c_set, order );
+    if ( ! saves_subsets_first( order ) ) {
+        c_set.remove_subsumed();
     }
-    return c_set;
+    return relabel( c_set, vertical.items );
+}
+
+template< typename diffset_type, typename item_type >
+/*!
+ * \brief talky_g streams the generators to sink while mining
+ * \param vertical
+ * \param min_sup
+ * \param sink
+ * \param order of the children of every node
+ * \param checkpoint where the state is saved, and whether the run resumes from it
+ * \param bounds generators to report
+ * \return statistics of the generator index
+ */
+inline CSetStatistics talky_g( const VerticalDatabase & vertical, const unsigned int min_sup, GeneratorSink & sink, const SiblingOrder order = SiblingOrder::Support, const CheckpointSettings & checkpoint = CheckpointSettings(), const SearchBounds & bounds = SearchBounds() )
+{
+    auto c_set = BasicCSet< item_type >();
+    LabelWriter writer( vertical.items, sink );
+    if ( saves_subsets_first( order ) && ( 0 == bounds.top_k ) ) {
+        StreamingCSet< item_type > streaming_c_set( c_set, writer, bounds.min_len );
+        talky_g_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, streaming_c_set, order, checkpoint );
+        return c_set.statistics();
+    }
+    if ( bounds.top_k ) {
+        // The result is only known once the search is over
+        TopKSupports supports( bounds.top_k );
+        TopKCSet< BasicCSet< item_type > > top_k_c_set( c_set, supports, bounds.min_len );
+        talky_g_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, top_k_c_set, order, checkpoint );
+    }
+    else {
+        talky_g_mine< diffset_type, item_type >( vertical, min_sup, bounds.max_len, c_set, order, checkpoint );
+    }
+    if ( ! saves_subsets_first( order ) ) {
+        c_set.remove_subsumed();
+    }
+    write_generators( c_set, bounds, writer );
+    return c_set.statistics();
+}
+
+/*!
+ * \brief talky_g
+ * \param database
+ * \param min_sup
+ * \return
+ */
+inline CSet talky_g( const Database & database, const unsigned int min_sup )
+{
+    VerticalDatabase vertical;
+    VerticalDatabaseBuilder::build( database, min_sup, 1, vertical );
+    return talky_g< Diffset >( vertical, min_sup );
 }
 }
 
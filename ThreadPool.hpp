@@ -0,0 +1,324 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief The ThreadPool class
+ * Work-stealing pool. Every worker owns a deque: it pushes and pops its own
+ * tasks at the back (depth first, cache warm) and steals from the front of
+ * the other deques (oldest, usually biggest, subtrees first).
+ * The thread that creates the pool is worker 0 and takes part in the work
+ * while it waits on a TaskGroup; so does any other thread that is not one
+ * of the pool's own, which a worker of another pool may be.
+ */
+class ThreadPool
+{
+public:
+    typedef std::function< void() > Task;
+
+    /*!
+     * \brief ThreadPool
+     * \param n_threads total number of threads including the caller
+     */
+    explicit ThreadPool( const unsigned int n_threads ) :
+        _pending( 0 ),
+        _done( false )
+    {
+        const unsigned int size = n_threads ? n_threads : 1;
+        for ( unsigned int index = 0; index < size; ++ index ) {
+            _queues.push_back( std::unique_ptr< WorkQueue >( new WorkQueue() ) );
+        }
+        for ( unsigned int index = 1; index < size; ++ index ) {
+            _workers.push_back( std::thread( &ThreadPool::worker_loop, this, index ) );
+        }
+    }
+
+    ThreadPool( const ThreadPool & ) = delete;
+    ThreadPool & operator = ( const ThreadPool & ) = delete;
+
+    /*!
+     * \brief ~ThreadPool
+     */
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard< std::mutex > lock( _wake_mutex );
+            _done = true;
+        }
+        _wake.notify_all();
+        for ( auto & worker : _workers ) {
+            worker.join();
+        }
+    }
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline unsigned int size() const
+    {
+        return _queues.size();
+    }
+
+    /*!
+     * \brief submit
+     * \param task
+     */
+    inline void submit( Task && task )
+    {
+        WorkQueue & queue = *_queues.at( worker_index() % _queues.size() );
+        {
+            std::lock_guard< std::mutex > lock( queue.mutex );
+            queue.tasks.push_back( std::move( task ) );
+        }
+        {
+            std::lock_guard< std::mutex > lock( _wake_mutex );
+            ++ _pending;
+        }
+        _wake.notify_one();
+    }
+
+    /*!
+     * \brief run_pending_task
+     * \return false if there was nothing to run
+     */
+    inline bool run_pending_task()
+    {
+        Task task;
+        if ( ! take_task( worker_index() % _queues.size(), task ) ) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    template < typename predicate_type >
+    /*!
+     * \brief wait_for_task blocks until a task is pending or done() holds
+     * \param done checked whenever notify() is called
+     */
+    inline void wait_for_task( const predicate_type & done )
+    {
+        std::unique_lock< std::mutex > lock( _wake_mutex );
+        _wake.wait( lock, [this, &done] { return _done || ( _pending > 0 ) || done(); } );
+    }
+
+    /*!
+     * \brief notify wakes the threads in wait_for_task to check their condition again
+     */
+    inline void notify()
+    {
+        {
+            std::lock_guard< std::mutex > lock( _wake_mutex );
+        }
+        _wake.notify_all();
+    }
+
+private:
+    /*!
+     * \brief The WorkQueue struct
+     */
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque< Task > tasks;
+    };
+
+    /*!
+     * \brief The Worker struct
+     * Pool a thread works for, and its index there.
+     */
+    struct Worker
+    {
+        const ThreadPool * pool;
+        unsigned int index;
+    };
+
+    /*!
+     * \brief worker
+     * \return the calling thread's
+     */
+    static Worker & worker()
+    {
+        static thread_local Worker worker = { nullptr, 0 };
+        return worker;
+    }
+
+    /*!
+     * \brief worker_index
+     * \return the calling thread's index in this pool, 0 for a thread that is not one of its workers
+     */
+    inline unsigned int worker_index() const
+    {
+        const Worker & current = worker();
+        return ( this == current.pool ) ? current.index : 0;
+    }
+
+    /*!
+     * \brief take_task
+     * \param index
+     * \param task
+     * \return
+     */
+    inline bool take_task( const unsigned int index, Task & task )
+    {
+        {
+            WorkQueue & own = *_queues[ index ];
+            std::lock_guard< std::mutex > lock( own.mutex );
+            if ( ! own.tasks.empty() ) {
+                task = std::move( own.tasks.back() );
+                own.tasks.pop_back();
+                return task_taken();
+            }
+        }
+        for ( unsigned int offset = 1; offset < _queues.size(); ++ offset ) {
+            WorkQueue & victim = *_queues[ ( index + offset ) % _queues.size() ];
+            std::lock_guard< std::mutex > lock( victim.mutex );
+            if ( ! victim.tasks.empty() ) {
+                task = std::move( victim.tasks.front() );
+                victim.tasks.pop_front();
+                return task_taken();
+            }
+        }
+        return false;
+    }
+
+    /*!
+     * \brief task_taken
+     * \return
+     */
+    inline bool task_taken()
+    {
+        std::lock_guard< std::mutex > lock( _wake_mutex );
+        -- _pending;
+        return true;
+    }
+
+    /*!
+     * \brief worker_loop
+     * \param index
+     */
+    void worker_loop( const unsigned int index )
+    {
+        worker().pool = this;
+        worker().index = index;
+        while ( true ) {
+            if ( run_pending_task() ) {
+                continue;
+            }
+            std::unique_lock< std::mutex > lock( _wake_mutex );
+            _wake.wait( lock, [this] { return _done || _pending > 0; } );
+            if ( _done ) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector < std::unique_ptr < WorkQueue > > _queues;
+    std::vector < std::thread > _workers;
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    unsigned int _pending;
+    bool _done;
+};
+
+/*!
+ * \brief The TaskGroup class
+ * Fork/join helper: wait() keeps the calling thread busy with pending tasks
+ * until every task of the group has finished, and sleeps while there is
+ * none to take.
+ */
+class TaskGroup
+{
+public:
+    /*!
+     * \brief TaskGroup
+     * \param pool
+     */
+    explicit TaskGroup( ThreadPool & pool ) :
+        _pool( pool ),
+        _unfinished( 0 ) {}
+
+    TaskGroup( const TaskGroup & ) = delete;
+    TaskGroup & operator = ( const TaskGroup & ) = delete;
+
+    /*!
+     * \brief ~TaskGroup
+     */
+    ~TaskGroup()
+    {
+        while ( _unfinished.load() ) {
+            help();
+        }
+    }
+
+    /*!
+     * \brief run
+     * \param task
+     */
+    inline void run( ThreadPool::Task && task )
+    {
+        ++ _unfinished;
+        std::shared_ptr< ThreadPool::Task > shared_task( new ThreadPool::Task( std::move( task ) ) );
+        _pool.submit( [this, shared_task] {
+            try {
+                ( *shared_task )();
+            }
+            catch ( ... ) {
+                std::lock_guard< std::mutex > lock( _error_mutex );
+                if ( ! _error ) {
+                    _error = std::current_exception();
+                }
+            }
+            // The group may be gone once the last task is counted out, the pool is not
+            ThreadPool & pool = _pool;
+            if ( 1 == _unfinished -- ) {
+                pool.notify();
+            }
+        } );
+    }
+
+    /*!
+     * \brief wait
+     */
+    inline void wait()
+    {
+        while ( _unfinished.load() ) {
+            help();
+        }
+        if ( _error ) {
+            std::exception_ptr error = _error;
+            _error = std::exception_ptr();
+            std::rethrow_exception( error );
+        }
+    }
+
+private:
+    /*!
+     * \brief help
+     */
+    inline void help()
+    {
+        if ( ! _pool.run_pending_task() ) {
+            _pool.wait_for_task( [this] { return 0 == _unfinished.load(); } );
+        }
+    }
+
+private:
+    ThreadPool & _pool;
+    std::atomic< unsigned int > _unfinished;
+    std::mutex _error_mutex;
+    std::exception_ptr _error;
+};
+
+#endif // THREADPOOL_HPP
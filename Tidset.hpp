@@ -4,6 +4,7 @@
 #include <vector>
 #include <istream>
 #include <algorithm>
+#include <numeric>
 
 #include "Diffset.hpp"
 
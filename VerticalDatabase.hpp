@@ -0,0 +1,579 @@
+#ifndef VERTICALDATABASE_HPP
+#define VERTICALDATABASE_HPP
+
+#include "Database.hpp"
+#include "Diffset.hpp"
+#include "ThreadPool.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <unordered_map>
+
+/*!
+ * \brief The DiffsetView class
+ * Tids of one item held by a VerticalDatabase.
+ */
+class DiffsetView
+{
+public:
+    typedef const TID * const_iterator;
+
+    /*!
+     * \brief DiffsetView
+     * \param first
+     * \param last
+     */
+    DiffsetView( const TID * first, const TID * last ) :
+        _first( first ),
+        _last( last ) {}
+
+    inline const_iterator begin() const
+    {
+        return _first;
+    }
+
+    inline const_iterator end() const
+    {
+        return _last;
+    }
+
+    inline const_iterator cbegin() const
+    {
+        return _first;
+    }
+
+    inline const_iterator cend() const
+    {
+        return _last;
+    }
+
+    inline std::size_t size() const
+    {
+        return _last - _first;
+    }
+
+    inline bool empty() const
+    {
+        return _first == _last;
+    }
+
+private:
+    const TID * _first;
+    const TID * _last;
+};
+
+/*!
+ * \brief The VerticalDatabase struct
+ * Frequent items of a database, each with its support and either its
+ * tidset or its diffset against the whole transaction set, whichever is
+ * smaller, ready to become children of the root. Items are ordered by
+ * ascending support and mined under their position, a dense id; items
+ * holds the label every dense id stands for.
+ * The tids are stored back to back, either in the struct itself or in a
+ * mapped cache file (see VerticalDatabaseCache).
+ */
+struct VerticalDatabase
+{
+    /*!
+     * \brief VerticalDatabase
+     */
+    VerticalDatabase() :
+        transaction_counter( 0 ),
+        _offsets( 1, 0 ),
+        _mapped_offsets( nullptr ),
+        _mapped_tids( nullptr ) {}
+
+    /*!
+     * \brief size
+     * \return
+     */
+    inline std::size_t size() const
+    {
+        return items.size();
+    }
+
+    /*!
+     * \brief is_tidset
+     * \param index
+     * \return true if the item is stored as its tidset, the rarer half of the items
+     */
+    inline bool is_tidset( const std::size_t index ) const
+    {
+        return stores_tidset( supports[ index ], transaction_counter );
+    }
+
+    /*!
+     * \brief stores_tidset
+     * \param support
+     * \param transaction_counter
+     * \return true if the tidset of an item of this support is smaller than its diffset
+     */
+    static inline bool stores_tidset( const unsigned int support, const TID transaction_counter )
+    {
+        return 2 * std::uint64_t( support ) < std::uint64_t( transaction_counter );
+    }
+
+    /*!
+     * \brief item_tids
+     * \param index
+     * \return the tidset of the item if is_tidset( index ), its diffset otherwise
+     */
+    inline DiffsetView item_tids( const std::size_t index ) const
+    {
+        return DiffsetView( tids() + offsets()[ index ], tids() + offsets()[ index + 1 ] );
+    }
+
+    /*!
+     * \brief offsets
+     * \return size() + 1 offsets into tids()
+     */
+    inline const std::uint64_t * offsets() const
+    {
+        return _mapping ? _mapped_offsets : _offsets.data();
+    }
+
+    /*!
+     * \brief tids
+     * \return the tids of all items back to back
+     */
+    inline const TID * tids() const
+    {
+        return _mapping ? _mapped_tids : _tids.data();
+    }
+
+    /*!
+     * \brief n_tids
+     * \return
+     */
+    inline std::size_t n_tids() const
+    {
+        return offsets()[ size() ];
+    }
+
+    /*!
+     * \brief allocate_tids makes owned room for the tids of every item
+     * \param sizes one per item
+     */
+    inline void allocate_tids( const std::vector < std::uint64_t > & sizes )
+    {
+        _mapping.reset();
+        _offsets.assign( 1, 0 );
+        for ( const auto & size : sizes ) {
+            _offsets.push_back( _offsets.back() + size );
+        }
+        _tids.assign( _offsets.back(), 0 );
+    }
+
+    /*!
+     * \brief item_data
+     * \param index
+     * \return first tid of an item, to be filled
+     */
+    inline TID * item_data( const std::size_t index )
+    {
+        return _tids.data() + _offsets[ index ];
+    }
+
+    /*!
+     * \brief map uses tids held by a mapped file
+     * \param mapping
+     * \param offsets
+     * \param tids
+     */
+    inline void map( const std::shared_ptr< const MappedFile > & mapping, const std::uint64_t * offsets, const TID * tids )
+    {
+        _offsets.assign( 1, 0 );
+        _tids.clear();
+        _mapping = mapping;
+        _mapped_offsets = offsets;
+        _mapped_tids = tids;
+    }
+
+    TID transaction_counter;
+    std::vector < Item > items;
+    std::vector < unsigned int > supports;
+
+private:
+    std::vector < std::uint64_t > _offsets;
+    std::vector < TID > _tids;
+    std::shared_ptr< const MappedFile > _mapping;
+    const std::uint64_t * _mapped_offsets;
+    const TID * _mapped_tids;
+};
+
+/*!
+ * \brief The VerticalDatabaseBuilder class
+ * Builds a VerticalDatabase in linear time: a counting pass sizes every
+ * tidset exactly, a second pass fills them, and an item in more than
+ * half of the transactions is stored as the complement of its tidset,
+ * taken with one merge. Both passes over the transactions are split by
+ * transaction range, the complements by item.
+ */
+class VerticalDatabaseBuilder
+{
+private:
+    /*!
+     * \brief min_range_size transactions below which a range is not worth a task
+     */
+    static constexpr std::size_t min_range_size = 4096;
+
+    /*!
+     * \brief npos
+     */
+    static constexpr unsigned int npos = std::numeric_limits< unsigned int >::max();
+
+    /*!
+     * \brief The ItemCount struct
+     */
+    struct ItemCount
+    {
+        ItemCount() :
+            count( 0 ),
+            last_tid( 0 ) {}
+
+        unsigned int count;
+        TID last_tid;
+    };
+
+    typedef std::unordered_map< Item, ItemCount, item_hash > CountMap;
+
+    /*!
+     * \brief The ItemIndex class maps a frequent item to its position, or npos
+     */
+    class ItemIndex
+    {
+    public:
+        /*!
+         * \brief ItemIndex
+         * \param items frequent items
+         */
+        explicit ItemIndex( const std::vector < Item > & items ) :
+            _min( items.empty() ? 0 : *std::min_element( items.cbegin(), items.cend() ) )
+        {
+            const long long span = items.empty() ? 0 : ( static_cast< long long >( *std::max_element( items.cbegin(), items.cend() ) ) - _min + 1 );
+            if ( span <= static_cast< long long >( 16 * items.size() + 1024 ) ) {
+                _dense.assign( span, static_cast< unsigned int >( npos ) );
+                for ( unsigned int index = 0; index < items.size(); ++ index ) {
+                    _dense[ items[ index ] - _min ] = index;
+                }
+            }
+            else {
+                for ( unsigned int index = 0; index < items.size(); ++ index ) {
+                    _sparse.insert( std::make_pair( items[ index ], index ) );
+                }
+            }
+        }
+
+        /*!
+         * \brief find
+         * \param item
+         * \return
+         */
+        inline unsigned int find( const Item item ) const
+        {
+            if ( _sparse.empty() ) {
+                const long long offset = static_cast< long long >( item ) - _min;
+                return ( offset >= 0 && offset < static_cast< long long >( _dense.size() ) ) ? _dense[ offset ] : npos;
+            }
+            const auto got = _sparse.find( item );
+            return ( _sparse.cend() == got ) ? npos : got->second;
+        }
+
+    private:
+        Item _min;
+        std::vector < unsigned int > _dense;
+        std::unordered_map< Item, unsigned int, item_hash > _sparse;
+    };
+
+public:
+    /*!
+     * \brief operator ()
+     * \param database
+     * \param min_sup items below it are dropped
+     * \param n_threads
+     * \param vertical
+     */
+    inline void operator ()( const Database & database, const unsigned int min_sup, const unsigned int n_threads, VerticalDatabase & vertical ) const
+    {
+        const std::size_t n_transactions = database.size();
+        std::size_t n_ranges = n_threads ? n_threads : 1;
+        n_ranges = std::max< std::size_t >( 1, std::min( n_ranges, n_transactions / min_range_size ) );
+        std::vector < std::size_t > bounds( n_ranges + 1 );
+        for ( std::size_t range = 0; range <= n_ranges; ++ range ) {
+            bounds[ range ] = n_transactions * range / n_ranges;
+        }
+        ThreadPool pool( n_threads );
+
+        // Count the transactions of every item, per range
+        std::vector < CountMap > range_counts( n_ranges );
+        {
+            TaskGroup group( pool );
+            for ( std::size_t range = 0; range < n_ranges; ++ range ) {
+                group.run( [&, range] {
+                    CountMap & counts = range_counts[ range ];
+                    for ( std::size_t index = bounds[ range ]; index < bounds[ range + 1 ]; ++ index ) {
+                        const TID tid = index + 1;
+                        for ( const auto & item : database[ index ] ) {
+                            ItemCount & item_count = counts[ item ];
+                            if ( item_count.last_tid != tid ) {
+                                item_count.last_tid = tid;
+                                ++ item_count.count;
+                            }
+                        }
+                    }
+                } );
+            }
+            group.wait();
+        }
+        std::unordered_map< Item, unsigned int, item_hash > supports;
+        for ( const auto & counts : range_counts ) {
+            for ( const auto & key_value : counts ) {
+                supports[ key_value.first ] += key_value.second.count;
+            }
+        }
+        vertical = VerticalDatabase();
+        vertical.transaction_counter = n_transactions;
+        for ( const auto & key_value : supports ) {
+            if ( key_value.second >= min_sup ) {
+                vertical.items.push_back( key_value.first );
+            }
+        }
+        // Dense ids in ascending support order, the order of the root's children
+        std::sort( vertical.items.begin(), vertical.items.end(), [&]( const Item & l, const Item & r ) {
+            const unsigned int l_support = supports.at( l );
+            const unsigned int r_support = supports.at( r );
+            return ( l_support < r_support ) || ( ( l_support == r_support ) && ( l < r ) );
+        } );
+        const std::size_t n_items = vertical.items.size();
+        const ItemIndex item_index( vertical.items );
+
+        // Exact-size tidsets, every range writes behind the ranges before it
+        std::vector < Tidset > tidsets( n_items );
+        std::vector < std::vector < unsigned int > > offsets( n_ranges, std::vector < unsigned int >( n_items, 0 ) );
+        vertical.supports.resize( n_items );
+        for ( std::size_t item = 0; item < n_items; ++ item ) {
+            unsigned int offset = 0;
+            for ( std::size_t range = 0; range < n_ranges; ++ range ) {
+                offsets[ range ][ item ] = offset;
+                const auto got = range_counts[ range ].find( vertical.items[ item ] );
+                offset += ( range_counts[ range ].cend() == got ) ? 0 : got->second.count;
+            }
+            vertical.supports[ item ] = offset;
+            tidsets[ item ].resize( offset );
+        }
+        range_counts.clear();
+        {
+            TaskGroup group( pool );
+            for ( std::size_t range = 0; range < n_ranges; ++ range ) {
+                group.run( [&, range] {
+                    std::vector < unsigned int > & cursors = offsets[ range ];
+                    const std::vector < unsigned int > starts( cursors );
+                    for ( std::size_t index = bounds[ range ]; index < bounds[ range + 1 ]; ++ index ) {
+                        const TID tid = index + 1;
+                        for ( const auto & item : database[ index ] ) {
+                            const unsigned int position = item_index.find( item );
+                            if ( npos == position ) {
+                                continue;
+                            }
+                            unsigned int & cursor = cursors[ position ];
+                            Tidset & tidset = tidsets[ position ];
+                            if ( ( cursor == starts[ position ] ) || ( tidset[ cursor - 1 ] != tid ) ) {
+                                tidset[ cursor ++ ] = tid;
+                            }
+                        }
+                    }
+                } );
+            }
+            group.wait();
+        }
+        offsets.clear();
+
+        // Keep the rare items' tidsets, complement the others with one merge against 1..n
+        std::vector < std::uint64_t > sizes( n_items );
+        for ( std::size_t item = 0; item < n_items; ++ item ) {
+            sizes[ item ] = vertical.is_tidset( item ) ? vertical.supports[ item ] : ( vertical.transaction_counter - vertical.supports[ item ] );
+        }
+        vertical.allocate_tids( sizes );
+        {
+            TaskGroup group( pool );
+            const std::size_t n_chunks = std::min< std::size_t >( n_items, 4 * pool.size() );
+            for ( std::size_t chunk = 0; chunk < n_chunks; ++ chunk ) {
+                group.run( [&, chunk] {
+                    for ( std::size_t item = chunk; item < n_items; item += n_chunks ) {
+                        if ( vertical.is_tidset( item ) ) {
+                            std::copy( tidsets[ item ].cbegin(), tidsets[ item ].cend(), vertical.item_data( item ) );
+                        }
+                        else {
+                            complement( tidsets[ item ], vertical.transaction_counter, vertical.item_data( item ) );
+                        }
+                        Tidset().swap( tidsets[ item ] );
+                    }
+                } );
+            }
+            group.wait();
+        }
+    }
+
+    /*!
+     * \brief build
+     * \param database
+     * \param min_sup
+     * \param n_threads
+     * \param vertical
+     */
+    static void build( const Database & database, const unsigned int min_sup, const unsigned int n_threads, VerticalDatabase & vertical )
+    {
+        VerticalDatabaseBuilder builder;
+        builder( database, min_sup, n_threads, vertical );
+    }
+
+    /*!
+     * \brief complement
+     * \param tidset sorted tids
+     * \param transaction_counter
+     * \param diffset tids of 1..transaction_counter missing in tidset
+     */
+    static void complement( const Tidset & tidset, const TID transaction_counter, Diffset & diffset )
+    {
+        diffset.resize( transaction_counter - tidset.size() );
+        complement( tidset, transaction_counter, diffset.data() );
+    }
+
+    template < typename tid_range >
+    /*!
+     * \brief complement
+     * \param tidset sorted tids
+     * \param transaction_counter
+     * \param diffset room for transaction_counter - tidset.size() tids
+     */
+    static void complement( const tid_range & tidset, const TID transaction_counter, TID * diffset )
+    {
+        complement( tidset.cbegin(), tidset.cend(), 1, transaction_counter, diffset );
+    }
+
+    template < typename tid_iterator >
+    /*!
+     * \brief complement
+     * \param first sorted tids of from..to
+     * \param last
+     * \param from
+     * \param to
+     * \param diffset room for the tids of from..to missing in first..last
+     * \return end of the tids written
+     */
+    static TID * complement( tid_iterator first, const tid_iterator last, const TID from, const TID to, TID * diffset )
+    {
+        for ( TID tid = from; tid <= to; ++ tid ) {
+            if ( ( first != last ) && ( *first == tid ) ) {
+                ++ first;
+            }
+            else {
+                *diffset ++ = tid;
+            }
+        }
+        return diffset;
+    }
+
+    /*!
+     * \brief append adds new transactions behind those of a vertical database
+     * Both vertical databases must keep every item, as built with min_sup 1.
+     * An item that keeps its form only has the tids of the new transactions
+     * appended, its old tids are copied; an item that changes form is
+     * complemented once.
+     * \param history vertical database of the old transactions
+     * \param delta vertical database of the new transactions alone
+     * \param n_threads
+     * \param vertical of the old transactions followed by the new ones
+     */
+    static void append( const VerticalDatabase & history, const VerticalDatabase & delta, const unsigned int n_threads, VerticalDatabase & vertical )
+    {
+        std::unordered_map< Item, unsigned int, item_hash > history_index;
+        std::unordered_map< Item, unsigned int, item_hash > delta_index;
+        std::unordered_map< Item, unsigned int, item_hash > supports;
+        for ( unsigned int index = 0; index < history.size(); ++ index ) {
+            history_index.insert( std::make_pair( history.items[ index ], index ) );
+            supports[ history.items[ index ] ] += history.supports[ index ];
+        }
+        for ( unsigned int index = 0; index < delta.size(); ++ index ) {
+            delta_index.insert( std::make_pair( delta.items[ index ], index ) );
+            supports[ delta.items[ index ] ] += delta.supports[ index ];
+        }
+        vertical = VerticalDatabase();
+        vertical.transaction_counter = history.transaction_counter + delta.transaction_counter;
+        for ( const auto & key_value : supports ) {
+            vertical.items.push_back( key_value.first );
+        }
+        std::sort( vertical.items.begin(), vertical.items.end(), [&]( const Item & l, const Item & r ) {
+            const unsigned int l_support = supports.at( l );
+            const unsigned int r_support = supports.at( r );
+            return ( l_support < r_support ) || ( ( l_support == r_support ) && ( l < r ) );
+        } );
+        const std::size_t n_items = vertical.items.size();
+        vertical.supports.resize( n_items );
+        std::vector < std::uint64_t > sizes( n_items );
+        for ( std::size_t item = 0; item < n_items; ++ item ) {
+            vertical.supports[ item ] = supports.at( vertical.items[ item ] );
+            sizes[ item ] = vertical.is_tidset( item ) ? vertical.supports[ item ] : ( vertical.transaction_counter - vertical.supports[ item ] );
+        }
+        vertical.allocate_tids( sizes );
+        const TID offset = history.transaction_counter;
+        ThreadPool pool( n_threads );
+        TaskGroup group( pool );
+        const std::size_t n_chunks = std::min< std::size_t >( n_items, 4 * pool.size() );
+        for ( std::size_t chunk = 0; chunk < n_chunks; ++ chunk ) {
+            group.run( [&, chunk] {
+                Tidset old_tids;
+                Tidset new_tids;
+                for ( std::size_t item = chunk; item < n_items; item += n_chunks ) {
+                    const bool is_tidset = vertical.is_tidset( item );
+                    // Old tids in the form of the item, an item new to the history has none
+                    old_tids.clear();
+                    const auto in_history = history_index.find( vertical.items[ item ] );
+                    if ( history_index.cend() != in_history ) {
+                        const DiffsetView tids = history.item_tids( in_history->second );
+                        if ( history.is_tidset( in_history->second ) == is_tidset ) {
+                            old_tids.assign( tids.cbegin(), tids.cend() );
+                        }
+                        else {
+                            old_tids.resize( history.transaction_counter - tids.size() );
+                            complement( tids, history.transaction_counter, old_tids.data() );
+                        }
+                    }
+                    else if ( ! is_tidset ) {
+                        old_tids.resize( history.transaction_counter );
+                        std::iota( old_tids.begin(), old_tids.end(), TID( 1 ) );
+                    }
+                    // New tids, in the numbering of the whole database
+                    new_tids.clear();
+                    const auto in_delta = delta_index.find( vertical.items[ item ] );
+                    if ( delta_index.cend() != in_delta ) {
+                        const DiffsetView tids = delta.item_tids( in_delta->second );
+                        if ( delta.is_tidset( in_delta->second ) ) {
+                            new_tids.assign( tids.cbegin(), tids.cend() );
+                        }
+                        else {
+                            new_tids.resize( delta.transaction_counter - tids.size() );
+                            complement( tids, delta.transaction_counter, new_tids.data() );
+                        }
+                        for ( auto & tid : new_tids ) {
+                            tid += offset;
+                        }
+                    }
+                    TID * out = std::copy( old_tids.cbegin(), old_tids.cend(), vertical.item_data( item ) );
+                    if ( is_tidset ) {
+                        std::copy( new_tids.cbegin(), new_tids.cend(), out );
+                    }
+                    else {
+                        complement( new_tids.cbegin(), new_tids.cend(), offset + 1, vertical.transaction_counter, out );
+                    }
+                }
+            } );
+        }
+        group.wait();
+    }
+};
+
+#endif // VERTICALDATABASE_HPP
@@ -0,0 +1,205 @@
+#ifndef VERTICALDATABASECACHE_HPP
+#define VERTICALDATABASECACHE_HPP
+
+#include "VerticalDatabase.hpp"
+#include "BufferedWriter.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+/*!
+ * \brief The VerticalDatabaseCache class
+ * Saves a VerticalDatabase to a file that a later run maps instead of
+ * parsing and building again. The file is a header followed by 8 byte
+ * aligned sections: items, supports, tid offsets and the tids of all items
+ * back to back, in the byte order of the machine that wrote it. Only the
+ * items and supports are copied on load, the tids are used in place.
+ * A cache built with some min_sup serves every run with a min_sup at least
+ * as high; the size and modification time of the database it was built
+ * from are recorded, so a changed database is rebuilt.
+ */
+class VerticalDatabaseCache
+{
+public:
+    /*!
+     * \brief version of the file layout
+     */
+    static constexpr std::uint32_t version = 2;
+
+    /*!
+     * \brief The Header struct
+     */
+    struct Header
+    {
+        char magic[ 8 ];
+        std::uint32_t version;
+        std::uint32_t item_size;
+        std::uint32_t tid_size;
+        std::uint32_t min_sup;
+        std::uint64_t transaction_counter;
+        std::uint64_t n_items;
+        std::uint64_t n_tids;
+        std::uint64_t source_size;
+        std::uint64_t source_mtime;
+    };
+
+    /*!
+     * \brief save
+     * \param filename
+     * \param vertical
+     * \param min_sup the vertical database was built with
+     * \param database_filename it was built from
+     */
+    static void save( const std::string & filename, const VerticalDatabase & vertical, const unsigned int min_sup, const std::string & database_filename )
+    {
+        BufferedWriter writer( filename );
+        write_index( writer, vertical.transaction_counter, vertical.items, vertical.supports, vertical.offsets(), min_sup, database_filename );
+        writer.write( reinterpret_cast< const char * >( vertical.tids() ), vertical.n_tids() * sizeof( TID ) );
+        writer.close();
+    }
+
+    /*!
+     * \brief write_index writes everything but the tids, which are to follow item by item
+     * \param writer at the start of the file
+     * \param transaction_counter
+     * \param items
+     * \param supports
+     * \param offsets items.size() + 1 offsets into the tids
+     * \param min_sup the vertical database was built with
+     * \param database_filename it was built from
+     */
+    static void write_index( BufferedWriter & writer, const TID transaction_counter, const std::vector < Item > & items, const std::vector < unsigned int > & supports,
+                             const std::uint64_t * offsets, const unsigned int min_sup, const std::string & database_filename )
+    {
+        Header header;
+        make_header( transaction_counter, items.size(), offsets[ items.size() ], min_sup, database_filename, header );
+        writer.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+        write_section( writer, items.data(), items.size() );
+        write_section( writer, supports.data(), items.size() );
+        write_section( writer, offsets, items.size() + 1 );
+        pad( writer );
+    }
+
+    /*!
+     * \brief load
+     * \param filename
+     * \param database_filename the run is for
+     * \param min_sup of the run
+     * \param vertical
+     * \return false if there is no usable cache
+     */
+    static bool load( const std::string & filename, const std::string & database_filename, const unsigned int min_sup, VerticalDatabase & vertical )
+    {
+        std::shared_ptr< const MappedFile > file;
+        try {
+            file.reset( new MappedFile( filename ) );
+        }
+        catch ( const std::runtime_error & ) {
+            return false;
+        }
+        Header header;
+        if ( file->size() < sizeof( header ) ) {
+            return false;
+        }
+        std::memcpy( &header, file->data(), sizeof( header ) );
+        Header expected;
+        make_header( 0, 0, 0, min_sup, database_filename, expected );
+        if ( std::memcmp( header.magic, expected.magic, sizeof( header.magic ) ) || ( header.version != version )
+             || ( header.item_size != sizeof( Item ) ) || ( header.tid_size != sizeof( TID ) ) || ( header.min_sup > min_sup ) ) {
+            return false;
+        }
+        if ( expected.source_mtime
+             && ( ( header.source_size != expected.source_size ) || ( header.source_mtime != expected.source_mtime ) ) ) {
+            return false;
+        }
+        std::size_t position = section_start( sizeof( header ) );
+        const std::size_t items = position;
+        position = section_start( position + header.n_items * sizeof( Item ) );
+        const std::size_t supports = position;
+        position = section_start( position + header.n_items * sizeof( unsigned int ) );
+        const std::size_t offsets = position;
+        position = section_start( position + ( header.n_items + 1 ) * sizeof( std::uint64_t ) );
+        const std::size_t tids = position;
+        if ( tids + header.n_tids * sizeof( TID ) != file->size() ) {
+            return false;
+        }
+        vertical = VerticalDatabase();
+        vertical.transaction_counter = header.transaction_counter;
+        const Item * const first_item = reinterpret_cast< const Item * >( file->data() + items );
+        vertical.items.assign( first_item, first_item + header.n_items );
+        const unsigned int * const first_support = reinterpret_cast< const unsigned int * >( file->data() + supports );
+        vertical.supports.assign( first_support, first_support + header.n_items );
+        vertical.map( file,
+                      reinterpret_cast< const std::uint64_t * >( file->data() + offsets ),
+                      reinterpret_cast< const TID * >( file->data() + tids ) );
+        return true;
+    }
+
+private:
+    /*!
+     * \brief section_start
+     * \param position
+     * \return position rounded up to the alignment of the sections
+     */
+    static inline std::size_t section_start( const std::size_t position )
+    {
+        return ( position + 7 ) & ~ std::size_t( 7 );
+    }
+
+    /*!
+     * \brief pad writes zeros up to the start of the next section
+     * \param writer
+     */
+    static void pad( BufferedWriter & writer )
+    {
+        static const char padding[ 8 ] = {};
+        writer.write( padding, section_start( writer.size() ) - writer.size() );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief write_section pads to the next section and writes count values
+     * \param writer
+     * \param values
+     * \param count
+     */
+    static void write_section( BufferedWriter & writer, const value_type * values, const std::size_t count )
+    {
+        pad( writer );
+        writer.write( reinterpret_cast< const char * >( values ), count * sizeof( value_type ) );
+    }
+
+    /*!
+     * \brief make_header
+     * \param transaction_counter
+     * \param n_items
+     * \param n_tids
+     * \param min_sup
+     * \param database_filename
+     * \param header
+     */
+    static void make_header( const TID transaction_counter, const std::uint64_t n_items, const std::uint64_t n_tids, const unsigned int min_sup, const std::string & database_filename, Header & header )
+    {
+        std::memset( &header, 0, sizeof( header ) );
+        std::memcpy( header.magic, "TKGVDB\0", sizeof( header.magic ) );
+        header.version = version;
+        header.item_size = sizeof( Item );
+        header.tid_size = sizeof( TID );
+        header.min_sup = min_sup;
+        header.transaction_counter = transaction_counter;
+        header.n_items = n_items;
+        header.n_tids = n_tids;
+        struct stat status;
+        if ( 0 == ::stat( database_filename.c_str(), &status ) ) {
+            header.source_size = status.st_size;
+            header.source_mtime = std::uint64_t( status.st_mtim.tv_sec ) * 1000000000ULL + status.st_mtim.tv_nsec;
+        }
+    }
+};
+
+#endif // VERTICALDATABASECACHE_HPP
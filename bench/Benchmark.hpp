@@ -0,0 +1,172 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief The BenchmarkRecord class
+ * One result, written as a single line JSON object so a run can be
+ * appended to a log and compared with the runs of other commits.
+ */
+class BenchmarkRecord
+{
+public:
+    /*!
+     * \brief BenchmarkRecord
+     * \param benchmark
+     * \param variant
+     */
+    BenchmarkRecord( const std::string & benchmark, const std::string & variant )
+    {
+        add( "benchmark", benchmark );
+        add( "variant", variant );
+    }
+
+    /*!
+     * \brief add
+     * \param key
+     * \param value
+     * \return
+     */
+    inline BenchmarkRecord & add( const std::string & key, const std::string & value )
+    {
+        _fields.push_back( std::make_pair( key, '"' + value + '"' ) );
+        return *this;
+    }
+
+    /*!
+     * \brief add
+     * \param key
+     * \param value
+     * \return
+     */
+    inline BenchmarkRecord & add( const std::string & key, const char * value )
+    {
+        return add( key, std::string( value ) );
+    }
+
+    template < typename value_type >
+    /*!
+     * \brief add
+     * \param key
+     * \param value a number
+     * \return
+     */
+    inline BenchmarkRecord & add( const std::string & key, const value_type value )
+    {
+        std::ostringstream os;
+        os << value;
+        _fields.push_back( std::make_pair( key, os.str() ) );
+        return *this;
+    }
+
+    /*!
+     * \brief operator <<
+     * \param os
+     * \param record
+     * \return
+     */
+    friend std::ostream & operator << ( std::ostream & os, const BenchmarkRecord & record )
+    {
+        os << '{';
+        for ( std::size_t index = 0; index < record._fields.size(); ++ index ) {
+            os << ( index ? ", " : "" ) << '"' << record._fields[ index ].first << "\": " << record._fields[ index ].second;
+        }
+        return os << "}\n";
+    }
+
+private:
+    std::vector < std::pair< std::string, std::string > > _fields;
+};
+
+/*!
+ * \brief The Measurement struct
+ */
+struct Measurement
+{
+    std::size_t iterations;     //!< per batch
+    double ns_per_op;           //!< median of the batches
+    double min_ns_per_op;
+};
+
+/*!
+ * \brief The Benchmark class
+ * Times a kernel: the number of iterations per batch is doubled until a
+ * batch takes min_batch, then n_batches batches are timed and the median
+ * and the best time per iteration kept. Kernels return a value that is
+ * folded into checksum(), so the compiler cannot drop their work.
+ */
+class Benchmark
+{
+public:
+    /*!
+     * \brief Benchmark
+     * \param min_batch
+     * \param n_batches
+     */
+    Benchmark( const std::chrono::nanoseconds min_batch = std::chrono::milliseconds( 20 ), const unsigned int n_batches = 5 ) :
+        _min_batch( min_batch ),
+        _n_batches( n_batches ),
+        _checksum( 0 ) {}
+
+    template < typename kernel_type >
+    /*!
+     * \brief measure
+     * \param kernel called as kernel( iterations ), returns a checksum
+     * \return
+     */
+    inline Measurement measure( const kernel_type & kernel )
+    {
+        Measurement measurement;
+        measurement.iterations = 1;
+        while ( time( kernel, measurement.iterations ) < _min_batch ) {
+            measurement.iterations *= 2;
+        }
+        std::vector < double > ns_per_op;
+        for ( unsigned int batch = 0; batch < _n_batches; ++ batch ) {
+            ns_per_op.push_back( double( time( kernel, measurement.iterations ).count() ) / measurement.iterations );
+        }
+        std::sort( ns_per_op.begin(), ns_per_op.end() );
+        measurement.ns_per_op = ns_per_op[ ns_per_op.size() / 2 ];
+        measurement.min_ns_per_op = ns_per_op.front();
+        return measurement;
+    }
+
+    /*!
+     * \brief checksum
+     * \return
+     */
+    inline std::uint64_t checksum() const
+    {
+        return _checksum;
+    }
+
+private:
+    template < typename kernel_type >
+    /*!
+     * \brief time
+     * \param kernel
+     * \param iterations
+     * \return
+     */
+    inline std::chrono::nanoseconds time( const kernel_type & kernel, const std::size_t iterations )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        _checksum += kernel( iterations );
+        return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start );
+    }
+
+private:
+    std::chrono::nanoseconds _min_batch;
+    unsigned int _n_batches;
+    std::uint64_t _checksum;
+};
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,172 @@
+#ifndef QUESTGENERATOR_HPP
+#define QUESTGENERATOR_HPP
+
+#include "Database.hpp"
+#include "Typedefs.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <vector>
+
+/*!
+ * \brief The QuestParameters struct
+ * Shape of a synthetic database. Density is transaction_length / n_items.
+ */
+struct QuestParameters
+{
+    QuestParameters() :
+        n_transactions( 10000 ),
+        transaction_length( 10 ),
+        n_items( 1000 ),
+        n_patterns( 200 ),
+        pattern_length( 4 ),
+        correlation( 0.5 ),
+        corruption( 0.5 ),
+        seed( 1 ) {}
+
+    std::size_t n_transactions;
+    double transaction_length;  //!< mean items per transaction
+    unsigned int n_items;
+    unsigned int n_patterns;    //!< potentially frequent itemsets transactions are made of
+    double pattern_length;      //!< mean items per pattern
+    double correlation;         //!< mean fraction of a pattern taken from the previous one
+    double corruption;          //!< mean probability of dropping one more item of a pattern
+    std::uint64_t seed;
+};
+
+/*!
+ * \brief The QuestGenerator class
+ * Synthetic transactions in the style of the IBM Quest generator (Agrawal
+ * and Srikant, 1994). A pool of patterns is drawn first: pattern sizes are
+ * Poisson distributed, every pattern shares an exponentially distributed
+ * fraction of its items with the previous one, and gets an exponentially
+ * distributed weight and a normally distributed corruption level.
+ * A transaction of Poisson distributed size is then filled with patterns
+ * picked by weight, each losing items while a uniform draw stays under its
+ * corruption level. A pattern that overflows the transaction is kept for
+ * the next one half of the time.
+ */
+class QuestGenerator
+{
+public:
+    /*!
+     * \brief QuestGenerator
+     * \param parameters
+     */
+    explicit QuestGenerator( const QuestParameters & parameters ) :
+        _parameters( parameters ),
+        _random( parameters.seed )
+    {
+        make_patterns();
+    }
+
+    /*!
+     * \brief generate
+     * \param database receives n_transactions transactions of sorted, distinct items
+     */
+    inline void generate( Database & database )
+    {
+        database = Database();
+        database.reserve( _parameters.n_transactions, std::size_t( _parameters.n_transactions * _parameters.transaction_length ) );
+        std::poisson_distribution< unsigned int > length( std::max( _parameters.transaction_length - 1, 0.0 ) );
+        std::uniform_real_distribution< double > uniform( 0, 1 );
+        std::vector < Item > transaction;
+        std::vector < Item > items;
+        const Pattern * pending = nullptr;
+        for ( std::size_t tid = 0; tid < _parameters.n_transactions; ++ tid ) {
+            const std::size_t size = 1 + length( _random );
+            transaction.clear();
+            while ( transaction.size() < size ) {
+                const Pattern & pattern = pending ? *pending : _patterns[ _pick( _random ) ];
+                pending = nullptr;
+                items = pattern.items;
+                while ( ! items.empty() && ( uniform( _random ) < pattern.corruption ) ) {
+                    items.erase( items.begin() + std::uniform_int_distribution< std::size_t >( 0, items.size() - 1 )( _random ) );
+                }
+                if ( ! transaction.empty() && ( transaction.size() + items.size() > size ) && ( uniform( _random ) < 0.5 ) ) {
+                    pending = &pattern;
+                    break;
+                }
+                transaction.insert( transaction.end(), items.cbegin(), items.cend() );
+            }
+            std::sort( transaction.begin(), transaction.end() );
+            transaction.erase( std::unique( transaction.begin(), transaction.end() ), transaction.end() );
+            for ( const auto item : transaction ) {
+                database.push_item( item );
+            }
+            database.end_transaction();
+        }
+    }
+
+    /*!
+     * \brief write writes a database in the "tid;item;item;..." format DatabaseReader reads
+     * \param database
+     * \param os
+     */
+    static void write( const Database & database, std::ostream & os )
+    {
+        for ( std::size_t index = 0; index < database.size(); ++ index ) {
+            os << index;
+            for ( const auto & item : database[ index ] ) {
+                os << ';' << item;
+            }
+            os << '\n';
+        }
+    }
+
+private:
+    /*!
+     * \brief The Pattern struct
+     */
+    struct Pattern
+    {
+        std::vector < Item > items;
+        double corruption;
+    };
+
+    /*!
+     * \brief make_patterns
+     */
+    inline void make_patterns()
+    {
+        std::poisson_distribution< unsigned int > length( std::max( _parameters.pattern_length - 1, 0.0 ) );
+        std::exponential_distribution< double > shared( 1 / std::max( _parameters.correlation, 1e-9 ) );
+        std::exponential_distribution< double > weight( 1 );
+        std::normal_distribution< double > corruption( _parameters.corruption, std::sqrt( 0.1 ) );
+        std::uniform_int_distribution< Item > item( 0, Item( _parameters.n_items ) - 1 );
+        std::vector < double > weights;
+        const unsigned int n_patterns = std::max( _parameters.n_patterns, 1u );
+        for ( unsigned int index = 0; index < n_patterns; ++ index ) {
+            Pattern pattern;
+            const std::size_t size = std::min< std::size_t >( 1 + length( _random ), _parameters.n_items );
+            if ( index ) {
+                std::vector < Item > previous = _patterns.back().items;
+                std::shuffle( previous.begin(), previous.end(), _random );
+                const std::size_t n_shared = std::min( { previous.size(), size, std::size_t( std::lround( shared( _random ) * size ) ) } );
+                pattern.items.assign( previous.cbegin(), previous.cbegin() + n_shared );
+            }
+            while ( pattern.items.size() < size ) {
+                const Item candidate = item( _random );
+                if ( pattern.items.cend() == std::find( pattern.items.cbegin(), pattern.items.cend(), candidate ) ) {
+                    pattern.items.push_back( candidate );
+                }
+            }
+            // A pattern that always loses every item would never end a transaction
+            pattern.corruption = std::min( std::max( corruption( _random ), 0.0 ), 0.9 );
+            _patterns.push_back( pattern );
+            weights.push_back( weight( _random ) );
+        }
+        _pick = std::discrete_distribution< std::size_t >( weights.cbegin(), weights.cend() );
+    }
+
+private:
+    QuestParameters _parameters;
+    std::mt19937_64 _random;
+    std::vector < Pattern > _patterns;
+    std::discrete_distribution< std::size_t > _pick;
+};
+
+#endif // QUESTGENERATOR_HPP
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Benchmarks of the Talky-G kernels and of whole runs
+#
+#-------------------------------------------------
+
+QT       -= core
+QT       -= gui
+
+TARGET = talky-g-bench
+CONFIG   += console
+CONFIG   -= app_bundle
+CONFIG   += thread
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp
+
+HEADERS += \
+    Benchmark.hpp \
+    QuestGenerator.hpp
+
+QMAKE_CXX = g++-4.7
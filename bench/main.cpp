@@ -0,0 +1,573 @@
+#include "Benchmark.hpp"
+#include "QuestGenerator.hpp"
+
+#include "Talky-G.hpp"
+#include "ParallelTalky-G.hpp"
+#include "DatabaseReader.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief The CountingSink class drops the generators, only counting them
+ */
+class CountingSink : public GeneratorSink
+{
+public:
+    void close() {}
+
+protected:
+    void write( const Item *, const Item *, const unsigned int ) {}
+};
+
+/*!
+ * \brief The BenchOptions struct
+ */
+struct BenchOptions
+{
+    BenchOptions() :
+        generate( false ),
+        n_threads( 1 )
+    {
+        quest.n_transactions = 20000;
+        min_sups.push_back( 0.02 );
+        min_sups.push_back( 0.01 );
+        min_sups.push_back( 0.005 );
+    }
+
+    bool generate;
+    QuestParameters quest;
+    std::vector < double > min_sups;   //!< fractions of the transactions, or absolute when above 1
+    unsigned int n_threads;
+    std::string database_filename;
+    std::string output_filename;
+};
+
+/*!
+ * \brief report
+ * \param record
+ * \param measurement
+ */
+void report( BenchmarkRecord record, const Measurement & measurement )
+{
+    record.add( "iterations", measurement.iterations )
+            .add( "ns_per_op", measurement.ns_per_op )
+            .add( "min_ns_per_op", measurement.min_ns_per_op );
+    std::cout << record << std::flush;
+}
+
+/*!
+ * \brief random_tids
+ * \param random
+ * \param size
+ * \param transaction_counter
+ * \return size distinct sorted tids below transaction_counter
+ */
+Diffset random_tids( std::mt19937_64 & random, const std::size_t size, const TID transaction_counter )
+{
+    std::vector < bool > taken( transaction_counter, false );
+    std::uniform_int_distribution< TID > tid( 0, transaction_counter - 1 );
+    Diffset tids;
+    while ( tids.size() < size ) {
+        const TID candidate = tid( random );
+        if ( ! taken[ candidate ] ) {
+            taken[ candidate ] = true;
+            tids.push_back( candidate );
+        }
+    }
+    std::sort( tids.begin(), tids.end() );
+    return tids;
+}
+
+template< typename diffset_type >
+/*!
+ * \brief check_bounded_difference joins as the miner does, curr with a support just above the candidate's diffset
+ * \param left diffset of curr
+ * \param right diffset of other
+ * \param min_sup
+ * \param random
+ * \return false if the bounded difference decides the frequency otherwise than the unbounded one
+ */
+bool check_bounded_difference( const diffset_type & left, const diffset_type & right, const unsigned int min_sup, std::mt19937_64 & random )
+{
+    diffset_type full;
+    Talky_G::diffset_difference( left, right, full );
+    if ( count_mistakes( left, right ) != full.size() ) {
+        return false;
+    }
+    // The candidate is frequent from curr_sup = full.size() + min_sup on
+    const std::size_t curr_sup = std::max< std::size_t >( min_sup, full.size() + std::uniform_int_distribution< unsigned int >( 0, 2 * min_sup )( random ) );
+    diffset_type bounded;
+    Talky_G::diffset_difference( left, right, bounded, curr_sup - min_sup );
+    if ( bounded.size() > curr_sup ) {
+        return false;
+    }
+    if ( ( curr_sup - bounded.size() >= min_sup ) != ( curr_sup - full.size() >= min_sup ) ) {
+        return false;
+    }
+    return ( curr_sup - full.size() < min_sup ) || std::equal( full.begin(), full.end(), bounded.begin() );
+}
+
+/*!
+ * \brief check_bounded_differences compares the bounded diffset_difference with the unbounded one at small min_sup
+ * \param random
+ * \return false, after naming the representation, if they disagree
+ */
+bool check_bounded_differences( std::mt19937_64 & random )
+{
+    const TID transaction_counter = 1024;
+    std::uniform_int_distribution< std::size_t > size( 0, 400 );
+    for ( unsigned int round = 0; round < 2000; ++ round ) {
+        const Diffset left = random_tids( random, size( random ), transaction_counter );
+        const Diffset right = random_tids( random, size( random ), transaction_counter );
+        const BitDiffset bit_left( left, transaction_counter );
+        const BitDiffset bit_right( right, transaction_counter );
+        for ( unsigned int min_sup = 1; min_sup <= 4; ++ min_sup ) {
+            if ( ! check_bounded_difference( left, right, min_sup, random ) ) {
+                std::cerr << "Bounded diffset_difference differs, vector, min_sup " << min_sup << std::endl;
+                return false;
+            }
+            if ( ! check_bounded_difference( bit_left, bit_right, min_sup, random ) ) {
+                std::cerr << "Bounded diffset_difference differs, bitmap, min_sup " << min_sup << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief bench_diffsets times diffset_difference, tidset_intersection, BitDiffset::difference_size and Node::mistakes
+ * \param benchmark
+ * \param random
+ */
+void bench_diffsets( Benchmark & benchmark, std::mt19937_64 & random )
+{
+    const TID transaction_counter = 1 << 16;
+    for ( const std::size_t size : { std::size_t( 256 ), std::size_t( 4096 ), std::size_t( 32768 ) } ) {
+        const Diffset left = random_tids( random, size, transaction_counter );
+        const Diffset right = random_tids( random, size, transaction_counter );
+        Diffset result;
+        report( BenchmarkRecord( "diffset_difference", "vector" ).add( "size", size ).add( "kernels", SetKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::diffset_difference( left, right, result );
+                checksum += result.size();
+            }
+            return checksum;
+        } ) );
+        report( BenchmarkRecord( "diffset_difference", "vector" ).add( "size", size ).add( "limit", size / 8 ).add( "kernels", SetKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::diffset_difference( left, right, result, size / 8 );
+                checksum += result.size();
+            }
+            return checksum;
+        } ) );
+        report( BenchmarkRecord( "tidset_intersection", "vector" ).add( "size", size ).add( "kernels", SetKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::tidset_intersection( left, right, result );
+                checksum += result.size();
+            }
+            return checksum;
+        } ) );
+        const BitDiffset bit_left( left, transaction_counter );
+        const BitDiffset bit_right( right, transaction_counter );
+        BitDiffset bit_result;
+        report( BenchmarkRecord( "diffset_difference", "bitmap" ).add( "size", size ).add( "kernels", BitKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::diffset_difference( bit_left, bit_right, bit_result );
+                checksum += bit_result.size();
+            }
+            return checksum;
+        } ) );
+        report( BenchmarkRecord( "diffset_difference", "bitmap" ).add( "size", size ).add( "limit", size / 8 ).add( "kernels", BitKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::diffset_difference( bit_left, bit_right, bit_result, size / 8 );
+                checksum += bit_result.size();
+            }
+            return checksum;
+        } ) );
+        report( BenchmarkRecord( "difference_size", "bitmap" ).add( "size", size ).add( "kernels", BitKernels::get().name ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                checksum += BitDiffset::difference_size( bit_left, bit_right );
+            }
+            return checksum;
+        } ) );
+    }
+    for ( const std::size_t size : { std::size_t( 64 ), std::size_t( 1024 ), std::size_t( 32768 ) } ) {
+        const Node left( Itemset(), random_tids( random, size, transaction_counter ), 0, 0 );
+        const Diffset right = random_tids( random, size, transaction_counter );
+        report( BenchmarkRecord( "mistakes", "vector" ).add( "size", size ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                checksum += left.mistakes( right );
+            }
+            return checksum;
+        } ) );
+        const BasicNode< BitDiffset > bit_left( Itemset(), BitDiffset( left.diffset(), transaction_counter ), 0, 0 );
+        const BitDiffset bit_right( right, transaction_counter );
+        report( BenchmarkRecord( "mistakes", "bitmap" ).add( "size", size ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                checksum += bit_left.mistakes( bit_right );
+            }
+            return checksum;
+        } ) );
+    }
+}
+
+/*!
+ * \brief bench_itemsets times itemset_union and is_subsumed
+ * \param benchmark
+ * \param random
+ */
+void bench_itemsets( Benchmark & benchmark, std::mt19937_64 & random )
+{
+    // Siblings share all items but the last one
+    for ( const std::size_t size : { std::size_t( 4 ), std::size_t( 16 ), std::size_t( 64 ) } ) {
+        Itemset left;
+        for ( std::size_t index = 0; index + 1 < size; ++ index ) {
+            left.push_back( Item( 2 * index ) );
+        }
+        Itemset right = left;
+        left.push_back( Item( 2 * size ) );
+        right.push_back( Item( 2 * size + 1 ) );
+        Itemset result;
+        report( BenchmarkRecord( "itemset_union", "vector" ).add( "size", size ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                Talky_G::itemset_union( left, right, result );
+                checksum += result.size();
+            }
+            return checksum;
+        } ) );
+    }
+    // Small classes of short generators, queried with longer candidates
+    std::uniform_int_distribution< Item > item( 0, 199 );
+    std::uniform_int_distribution< unsigned int > support( 1, 4 );
+    for ( const std::size_t n_generators : { std::size_t( 1000 ), std::size_t( 100000 ) } ) {
+        std::uniform_int_distribution< int > hashkey( 0, int( n_generators / 16 ) );
+        const auto random_itemset = [&]( const std::size_t size ) {
+            Itemset itemset;
+            while ( itemset.size() < size ) {
+                itemset.push_back( item( random ) );
+                std::sort( itemset.begin(), itemset.end() );
+                itemset.erase( std::unique( itemset.begin(), itemset.end() ), itemset.end() );
+            }
+            return itemset;
+        };
+        CSet c_set;
+        for ( std::size_t generator = 0; generator < n_generators; ++ generator ) {
+            c_set.insert( hashkey( random ), random_itemset( 1 + generator % 3 ), support( random ) );
+        }
+        std::vector < Node > candidates;
+        for ( std::size_t candidate = 0; candidate < 1024; ++ candidate ) {
+            candidates.push_back( Node( random_itemset( 5 ), Diffset(), support( random ), hashkey( random ) ) );
+        }
+        report( BenchmarkRecord( "is_subsumed", "cset" ).add( "generators", n_generators ),
+                benchmark.measure( [&]( const std::size_t iterations ) {
+            std::size_t checksum = 0;
+            for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+                checksum += Talky_G::is_subsumed( c_set, candidates[ iteration % candidates.size() ] );
+            }
+            return checksum;
+        } ) );
+    }
+}
+
+/*!
+ * \brief bench_database times parsing and building the vertical database
+ * \param benchmark
+ * \param text database in the input format
+ * \param min_sup
+ */
+void bench_database( Benchmark & benchmark, const std::string & text, const unsigned int min_sup )
+{
+    report( BenchmarkRecord( "parse", "serial" ).add( "bytes", text.size() ),
+            benchmark.measure( [&]( const std::size_t iterations ) {
+        std::size_t checksum = 0;
+        for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+            Database database;
+            DatabaseReader< n_of_fields >::parse( text.data(), text.data() + text.size(), database );
+            checksum += database.items().size();
+        }
+        return checksum;
+    } ) );
+    Database database;
+    DatabaseReader< n_of_fields >::parse( text.data(), text.data() + text.size(), database );
+    report( BenchmarkRecord( "vertical_build", "serial" ).add( "transactions", database.size() ).add( "min_sup", min_sup ),
+            benchmark.measure( [&]( const std::size_t iterations ) {
+        std::size_t checksum = 0;
+        for ( std::size_t iteration = 0; iteration < iterations; ++ iteration ) {
+            VerticalDatabase vertical;
+            VerticalDatabaseBuilder::build( database, min_sup, 1, vertical );
+            checksum += vertical.n_tids();
+        }
+        return checksum;
+    } ) );
+}
+
+template < typename diffset_type, typename item_type >
+/*!
+ * \brief mine_dense
+ * \param vertical
+ * \param min_sup
+ * \param n_threads
+ * \return number of generators
+ */
+std::size_t mine_dense( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int n_threads )
+{
+    CountingSink sink;
+    if ( n_threads > 1 ) {
+        Talky_G::talky_g_parallel< diffset_type, item_type >( vertical, min_sup, n_threads, sink );
+    }
+    else {
+        Talky_G::talky_g< diffset_type, item_type >( vertical, min_sup, sink );
+    }
+    return sink.count();
+}
+
+template < typename diffset_type >
+/*!
+ * \brief mine picks the narrowest item type, as the miner does
+ * \param vertical
+ * \param min_sup
+ * \param n_threads
+ * \return number of generators
+ */
+std::size_t mine( const VerticalDatabase & vertical, const unsigned int min_sup, const unsigned int n_threads )
+{
+    if ( vertical.size() <= std::numeric_limits< std::uint8_t >::max() + 1u ) {
+        return mine_dense< diffset_type, std::uint8_t >( vertical, min_sup, n_threads );
+    }
+    if ( vertical.size() <= std::numeric_limits< std::uint16_t >::max() + 1u ) {
+        return mine_dense< diffset_type, std::uint16_t >( vertical, min_sup, n_threads );
+    }
+    return mine_dense< diffset_type, Item >( vertical, min_sup, n_threads );
+}
+
+/*!
+ * \brief bench_mining times whole runs at every min_sup
+ * \param database
+ * \param min_sups
+ * \param n_threads
+ */
+void bench_mining( const Database & database, const std::vector < unsigned int > & min_sups, const unsigned int n_threads )
+{
+    Benchmark benchmark( std::chrono::nanoseconds( 0 ), 3 );
+    std::vector < unsigned int > thread_counts( 1, 1 );
+    if ( n_threads > 1 ) {
+        thread_counts.push_back( n_threads );
+    }
+    for ( const auto min_sup : min_sups ) {
+        VerticalDatabase vertical;
+        VerticalDatabaseBuilder::build( database, min_sup, 1, vertical );
+        for ( const auto threads : thread_counts ) {
+            std::size_t generators = 0;
+            const Measurement vector = benchmark.measure( [&]( const std::size_t ) {
+                return generators = mine< Diffset >( vertical, min_sup, threads );
+            } );
+            report( BenchmarkRecord( "talky_g", "vector" ).add( "min_sup", min_sup ).add( "threads", threads ).add( "generators", generators ), vector );
+            const Measurement bitmap = benchmark.measure( [&]( const std::size_t ) {
+                return generators = mine< BitDiffset >( vertical, min_sup, threads );
+            } );
+            report( BenchmarkRecord( "talky_g", "bitmap" ).add( "min_sup", min_sup ).add( "threads", threads ).add( "generators", generators ), bitmap );
+        }
+    }
+}
+
+/*!
+ * \brief read_options
+ * \param argc
+ * \param argv
+ * \param options
+ * \return false if the command line does not match the usage
+ */
+bool read_options( int argc, const char * argv[], BenchOptions & options )
+{
+    if ( argc < 2 ) {
+        return false;
+    }
+    const std::string mode( argv[ 1 ] );
+    if ( ( mode != "generate" ) && ( mode != "run" ) ) {
+        return false;
+    }
+    options.generate = ( mode == "generate" );
+    double density = 0;
+    std::vector < std::string > positional;
+    for ( int index = 2; index < argc; ++ index ) {
+        const std::string arg( argv[ index ] );
+        if ( ( arg.size() > 2 ) && ( 0 == arg.compare( 0, 2, "--" ) ) ) {
+            if ( ++ index == argc ) {
+                return false;
+            }
+            const std::string value( argv[ index ] );
+            if ( arg == "--rows" ) {
+                options.quest.n_transactions = std::stoul( value );
+            }
+            else if ( arg == "--length" ) {
+                options.quest.transaction_length = std::stod( value );
+            }
+            else if ( arg == "--items" ) {
+                options.quest.n_items = std::stoul( value );
+            }
+            else if ( arg == "--density" ) {
+                density = std::stod( value );
+            }
+            else if ( arg == "--patterns" ) {
+                options.quest.n_patterns = std::stoul( value );
+            }
+            else if ( arg == "--pattern-length" ) {
+                options.quest.pattern_length = std::stod( value );
+            }
+            else if ( arg == "--correlation" ) {
+                options.quest.correlation = std::stod( value );
+            }
+            else if ( arg == "--corruption" ) {
+                options.quest.corruption = std::stod( value );
+            }
+            else if ( arg == "--seed" ) {
+                options.quest.seed = std::stoull( value );
+            }
+            else if ( arg == "--min-sup" ) {
+                options.min_sups.clear();
+                std::istringstream is( value );
+                std::string min_sup;
+                while ( std::getline( is, min_sup, ',' ) ) {
+                    options.min_sups.push_back( std::stod( min_sup ) );
+                }
+            }
+            else if ( arg == "--threads" ) {
+                options.n_threads = std::stoul( value );
+            }
+            else if ( arg == "--database" ) {
+                options.database_filename = value;
+            }
+            else {
+                return false;
+            }
+        }
+        else {
+            positional.push_back( arg );
+        }
+    }
+    if ( density < 0 || density > 1 ) {
+        throw std::invalid_argument( "--density must be between 0 and 1" );
+    }
+    if ( density > 0 ) {
+        options.quest.n_items = std::max( 1u, static_cast< unsigned int >( options.quest.transaction_length / density ) );
+    }
+    if ( ( 0 == options.quest.n_items ) || ( options.quest.transaction_length < 1 ) ) {
+        throw std::invalid_argument( "--items and --length must be positive" );
+    }
+    if ( options.generate ) {
+        if ( positional.size() != 1 ) {
+            return false;
+        }
+        options.output_filename = positional.front();
+        return true;
+    }
+    return positional.empty();
+}
+
+/*!
+ * \brief print_usage
+ */
+void print_usage()
+{
+    std::cerr << "Usage: generate [dataset options] output.dat\n"
+              << "       run [dataset options] [--database input.dat] [--min-sup s,s,...] [--threads N]\n"
+              << "Dataset options: [--rows N] [--length L] [--items N | --density D] [--patterns N]\n"
+              << "                 [--pattern-length L] [--correlation C] [--corruption C] [--seed S]\n"
+              << "run writes one JSON object per line; a min_sup up to 1 is a fraction of the transactions" << std::endl;
+}
+
+/*!
+ * \brief main
+ * \param argc
+ * \param argv
+ * \return
+ */
+int main( int argc, const char * argv[] )
+{
+    BenchOptions options;
+    try {
+        if ( ! read_options( argc, argv, options ) ) {
+            print_usage();
+            return -1;
+        }
+    }
+    catch ( const std::logic_error & le ) {
+        std::cerr << "Invalid argument: " << le.what() << '\n';
+        print_usage();
+        return -1;
+    }
+    Database database;
+    std::string text;
+    if ( options.database_filename.empty() ) {
+        QuestGenerator( options.quest ).generate( database );
+        std::ostringstream os;
+        QuestGenerator::write( database, os );
+        text = os.str();
+    }
+    else {
+        std::ifstream data_stream( options.database_filename, std::ios::binary );
+        if ( ! data_stream.is_open() ) {
+            std::cerr << "Cannot open file: " << options.database_filename << std::endl;
+            return -1;
+        }
+        text.assign( ( std::istreambuf_iterator< char >( data_stream ) ), std::istreambuf_iterator< char >() );
+        DatabaseReader< n_of_fields >::parse( text.data(), text.data() + text.size(), database );
+    }
+    if ( options.generate ) {
+        std::ofstream output( options.output_filename, std::ios::binary );
+        output << text;
+        if ( ! output ) {
+            std::cerr << "Cannot write file: " << options.output_filename << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    std::vector < unsigned int > min_sups;
+    for ( const auto min_sup : options.min_sups ) {
+        min_sups.push_back( std::max( 1u, static_cast< unsigned int >( min_sup > 1 ? min_sup : min_sup * database.size() ) ) );
+    }
+    std::cout << BenchmarkRecord( "dataset", options.database_filename.empty() ? "quest" : options.database_filename )
+                 .add( "transactions", database.size() )
+                 .add( "items", database.items().size() )
+                 .add( "kernels", BitKernels::get().name )
+              << std::flush;
+    std::mt19937_64 random( options.quest.seed );
+    std::mt19937_64 check_random( options.quest.seed );
+    if ( ! check_bounded_differences( check_random ) ) {
+        return -1;
+    }
+    Benchmark benchmark;
+    bench_diffsets( benchmark, random );
+    bench_itemsets( benchmark, random );
+    bench_database( benchmark, text, min_sups.empty() ? 1 : *std::min_element( min_sups.cbegin(), min_sups.cend() ) );
+    bench_mining( database, min_sups, options.n_threads );
+    std::cerr << "checksum " << benchmark.checksum() << std::endl;
+    return 0;
+}
@@ -1,8 +1,20 @@
 #include "Talky-G.hpp"
+#include "ParallelTalky-G.hpp"
+#include "IncrementalTalky-G.hpp"
+#include "OutOfCoreTalky-G.hpp"
+#include "ShardedTalky-G.hpp"
+#include "Closures.hpp"
 #include "CSet.hpp"
-#include "ResultSaver.hpp"
 #include "DatabaseReader.hpp"
 #include "Typedefs.hpp"
+#include "Options.hpp"
+#include "GeneratorSink.hpp"
+#include "VerticalDatabaseCache.hpp"
+#include "OutOfCore.hpp"
+#include "MiningServer.hpp"
+#include "ShardMerge.hpp"
+#include "IncrementalState.hpp"
+#include "SearchStatistics.hpp"
 
 #include <stdexcept>
 
@@ -10,9 +22,29 @@
 #include <future>
 
 #include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
 
 void print_usage();
 
+int convert( const Options & options );
+
+int serve( const Options & options );
+
+int merge( const Options & options );
+
+std::unique_ptr< GeneratorSink > open_sink( const std::string & filename, const Options & options );
+
+std::string sweep_filename( const std::string & result_filename, const unsigned int min_sup );
+
+template < typename diffset_type >
+int mine( const VerticalDatabase & vertical, const Options & options, const std::chrono::high_resolution_clock::time_point & t1, GeneratorSink & sink, const Talky_G::IncrementalUpdate * update );
+
+template < typename diffset_type, typename item_type >
+int mine_dense( const VerticalDatabase & vertical, const Options & options, const std::chrono::high_resolution_clock::time_point & t1, GeneratorSink & sink, const Talky_G::IncrementalUpdate * update );
+
 /*!
  * \brief main
  * \param argc
@@ -21,72 +53,396 @@ void print_usage();
  */
 int main( int argc, const char * argv[] )
 {
-    if ( argc != 4 ) {
-        print_usage();
-        return -1;
-    }
-    std::vector < std::string > argv_vector( argc - 1 );
-    auto argv_index = argc - 1;
-    while ( argv_index -- ) {
-        argv_vector[ argv_index ] = std::string( argv[ argv_index + 1 ] );
-    }
-    /*
-    std::cout << "Input args: \n";
-    std::for_each ( argv_vector.cbegin(), argv_vector.cend(), []( const std::string & str ) {
-        std::cout << str << ' ';
-    } );
-    std::cout << std::endl;
-    */
-    // Read support
-    unsigned int min_sup = 0;
+    Options options;
     try {
-        min_sup = std::stoi( argv_vector.at( 0 ) );
+        if ( ! OptionsReader::read_options( argc, argv, options ) ) {
+            print_usage();
+            return -1;
+        }
     }
     catch ( const std::invalid_argument & ia ) {
         std::cerr << "Invalid argument: " << ia.what() << '\n';
         print_usage();
         return -1;
     }
-    // Read database
-    Database database;
-    {
-        std::ifstream data_stream;
-        const std::string & database_filename = argv_vector.at( 1 );
-        data_stream.open( database_filename );
-        if ( data_stream.is_open() ) {
-            DatabaseReader< n_of_fields >::read_database( data_stream, database );
-            //            std::cerr << "Database was read" << std::endl;
+    if ( options.to_text ) {
+        return convert( options );
+    }
+    if ( options.serve ) {
+        return serve( options );
+    }
+    if ( options.merge ) {
+        return merge( options );
+    }
+    const unsigned int min_sup = options.min_sup;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    VerticalDatabase vertical;
+    GeneratorList previous;
+    std::unique_ptr< Talky_G::DeltaIndex > delta_index;
+    std::unique_ptr< Talky_G::IncrementalUpdate > update;
+    if ( options.append ) {
+        // Append the new transactions to the vertical database of the state
+        try {
+            VerticalDatabase history;
+            unsigned int state_min_sup = 0;
+            {
+                ScopedPhase phase( "state_load" );
+                IncrementalState::load( options.state, history, state_min_sup, previous );
+            }
+            Database database;
+            {
+                ScopedPhase phase( "parse" );
+                DatabaseReader< n_of_fields >::read_database( options.database_filename, database, options.n_threads );
+            }
+            t1 = std::chrono::high_resolution_clock::now();
+            VerticalDatabase delta;
+            {
+                ScopedPhase phase( "vertical_build" );
+                VerticalDatabaseBuilder::build( database, 1, options.n_threads, delta );
+                Database().swap( database );
+                VerticalDatabaseBuilder::append( history, delta, options.n_threads, vertical );
+            }
+            // The previous generators only help if they were mined with min_sup and the new transactions are few
+            if ( ( state_min_sup == min_sup ) && ( Talky_G::max_delta_share * std::uint64_t( delta.transaction_counter ) <= std::uint64_t( history.transaction_counter ) ) ) {
+                delta_index.reset( new Talky_G::DeltaIndex( vertical, delta ) );
+                update.reset( new Talky_G::IncrementalUpdate( *delta_index, previous ) );
+            }
+            std::cout << "Appended " << delta.transaction_counter << " transactions to " << history.transaction_counter
+                      << ( update ? ", mining what they touch" : ", mining all of them" ) << std::endl;
         }
-        else {
-            std::cerr << "Cannot open file: " << database_filename << std::endl;
+        catch ( const std::runtime_error & re ) {
+            std::cerr << re.what() << std::endl;
             print_usage();
             return -1;
         }
-        //        std::cerr << "Database size: " << database.size() << std::endl;
-        //        std::cerr << database << std::endl;
     }
-    const auto t1 = std::chrono::high_resolution_clock::now();
-    const auto c_set = Talky_G::talky_g( database, min_sup );
+    else {
+        // Map the cached vertical database, or read the database and build it
+        // A state keeps every item, for the items the next transactions make frequent
+        const unsigned int build_min_sup = options.state.empty() ? min_sup : 1;
+        // Out of core, the vertical database is a cache in the directory of the run
+        const std::string cache_filename = options.out_of_core.enabled() ? options.out_of_core.vertical_filename() : options.db_cache;
+        bool cached = false;
+        if ( ! cache_filename.empty() ) {
+            ScopedPhase phase( "cache_load" );
+            cached = VerticalDatabaseCache::load( cache_filename, options.database_filename, build_min_sup, vertical );
+        }
+        if ( ! cached && options.out_of_core.enabled() ) {
+            try {
+                {
+                    ScopedPhase phase( "vertical_build" );
+                    OutOfCoreBuilder< n_of_fields >::build( options.database_filename, build_min_sup, options.out_of_core.memory_budget, cache_filename );
+                }
+                ScopedPhase phase( "cache_load" );
+                cached = VerticalDatabaseCache::load( cache_filename, options.database_filename, build_min_sup, vertical );
+            }
+            catch ( const std::runtime_error & re ) {
+                std::cerr << re.what() << std::endl;
+                print_usage();
+                return -1;
+            }
+            if ( ! cached ) {
+                std::cerr << "Cannot load vertical database: " << cache_filename << std::endl;
+                return -1;
+            }
+        }
+        if ( ! cached ) {
+            Database database;
+            try {
+                ScopedPhase phase( "parse" );
+                DatabaseReader< n_of_fields >::read_database( options.database_filename, database, options.n_threads );
+                //        std::cerr << "Database size: " << database.size() << std::endl;
+            }
+            catch ( const std::runtime_error & re ) {
+                std::cerr << re.what() << std::endl;
+                print_usage();
+                return -1;
+            }
+            t1 = std::chrono::high_resolution_clock::now();
+            {
+                ScopedPhase phase( "vertical_build" );
+                VerticalDatabaseBuilder::build( database, build_min_sup, options.n_threads, vertical );
+                Database().swap( database );
+            }
+            if ( ! options.db_cache.empty() ) {
+                try {
+                    ScopedPhase phase( "cache_save" );
+                    VerticalDatabaseCache::save( options.db_cache, vertical, build_min_sup, options.database_filename );
+                }
+                catch ( const std::runtime_error & re ) {
+                    std::cerr << "Cannot write cache: " << re.what() << std::endl;
+                }
+            }
+        }
+    }
+    // Open the result once the input has loaded, generators are written while they are found
+    std::unique_ptr< GeneratorSink > sink;
+    try {
+        if ( options.sweep.empty() ) {
+            sink = open_sink( options.result_filename, options );
+        }
+        else {
+            std::unique_ptr< SweepSink > sweep_sink( new SweepSink() );
+            for ( const auto sweep_sup : options.sweep ) {
+                sweep_sink->add( sweep_sup, open_sink( sweep_filename( options.result_filename, sweep_sup ), options ) );
+            }
+            sink = std::move( sweep_sink );
+        }
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        print_usage();
+        return -1;
+    }
+    // A run with a state also keeps every generator for the next one
+    GeneratorList generators( sink.get() );
+    GeneratorSink & mining_sink = options.state.empty() ? *sink : generators;
+    bool use_bitmap = ( DiffsetRepresentation::Bitmap == options.diffset_representation );
+    if ( DiffsetRepresentation::Auto == options.diffset_representation ) {
+        use_bitmap = Talky_G::prefer_bitmap( vertical, min_sup );
+    }
+    const int result = use_bitmap ? mine< BitDiffset >( vertical, options, t1, mining_sink, update.get() )
+                                  : mine< Diffset >( vertical, options, t1, mining_sink, update.get() );
+    if ( ( 0 != result ) || options.state.empty() ) {
+        return result;
+    }
+    try {
+        ScopedPhase phase( "state_save" );
+        IncrementalState::save( options.state, vertical, min_sup, generators );
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * \brief open_sink
+ * \param filename
+ * \param options
+ * \return sink writing filename in the format of options
+ */
+std::unique_ptr< GeneratorSink > open_sink( const std::string & filename, const Options & options )
+{
+    if ( OutputFormat::Binary == options.output_format ) {
+        return std::unique_ptr< GeneratorSink >( new BinarySink( filename, options.write_mode ) );
+    }
+    return std::unique_ptr< GeneratorSink >( new TextSink( filename, options.write_mode ) );
+}
+
+/*!
+ * \brief sweep_filename
+ * \param result_filename
+ * \param min_sup
+ * \return where a sweep writes the result of min_sup
+ */
+std::string sweep_filename( const std::string & result_filename, const unsigned int min_sup )
+{
+    return result_filename + '.' + std::to_string( min_sup );
+}
+
+/*!
+ * \brief convert writes a binary result in the text format
+ * \param options
+ * \return
+ */
+int convert( const Options & options )
+{
+    std::ifstream binary_stream( options.database_filename, std::ios::binary );
+    if ( ! binary_stream.is_open() ) {
+        std::cerr << "Cannot open file: " << options.database_filename << std::endl;
+        print_usage();
+        return -1;
+    }
+    try {
+        TextSink sink( options.result_filename, options.write_mode );
+        if ( ! BinaryResultConverter::convert( binary_stream, sink ) ) {
+            std::cerr << "Not a binary result: " << options.database_filename << std::endl;
+            return -1;
+        }
+        sink.close();
+        std::cout << "Number of frequent generators: " << sink.count() << std::endl;
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * \brief serve loads the databases and answers queries against them until told to quit
+ * \param options
+ * \return
+ */
+int serve( const Options & options )
+{
+    MiningQuery defaults;
+    defaults.bounds = options.bounds;
+    defaults.order = options.sibling_order;
+    MiningServer server( options.n_threads, options.cache_size, defaults, options.diffset_representation );
+    try {
+        for ( const auto & database : options.databases ) {
+            ScopedPhase phase( "load" );
+            server.load( database );
+        }
+        std::cerr << "Serving " << options.databases.size() << " databases" << std::endl;
+        if ( options.socket.empty() ) {
+            server.serve( std::cin, STDOUT_FILENO );
+        }
+        else {
+            server.listen( options.socket );
+        }
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * \brief merge writes the generators of a run from the results of its shards
+ * \param options
+ * \return
+ */
+int merge( const Options & options )
+{
+    try {
+        ShardMerger merger;
+        {
+            ScopedPhase phase( "parse" );
+            for ( const auto & filename : options.shard_results ) {
+                merger.read( filename );
+            }
+        }
+        std::unique_ptr< GeneratorSink > sink = open_sink( options.result_filename, options );
+        {
+            ScopedPhase phase( "merge" );
+            merger.merge( options.bounds.min_len, *sink );
+        }
+        sink->close();
+        std::cout << "Merged " << merger.count() << " itemsets of " << options.shard_results.size() << " shards" << std::endl;
+        std::cout << "Number of frequent generators: " << sink->count() << std::endl;
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * \brief The DenseMiner struct
+ * Arguments of mine_dense, run with the item type with_item_type picks.
+ */
+struct DenseMiner
+{
+    template < typename diffset_type, typename item_type >
+    int run() const
+    {
+        return mine_dense< diffset_type, item_type >( vertical, options, t1, sink, update );
+    }
+
+    const VerticalDatabase & vertical;
+    const Options & options;
+    const std::chrono::high_resolution_clock::time_point & t1;
+    GeneratorSink & sink;
+    const Talky_G::IncrementalUpdate * update;
+};
+
+template < typename diffset_type >
+/*!
+ * \brief mine picks the narrowest item type holding every dense item id
+ * \param vertical
+ * \param options
+ * \param t1 start of the mining
+ * \param sink receives the generators
+ * \param update new transactions to mine incrementally, or nullptr to mine everything
+ * \return
+ */
+int mine( const VerticalDatabase & vertical, const Options & options, const std::chrono::high_resolution_clock::time_point & t1, GeneratorSink & sink, const Talky_G::IncrementalUpdate * update )
+{
+    const DenseMiner miner = { vertical, options, t1, sink, update };
+    return Talky_G::with_item_type< diffset_type >( vertical, miner );
+}
+
+template < typename diffset_type, typename item_type >
+/*!
+ * \brief mine_dense
+ * \param vertical
+ * \param options
+ * \param t1 start of the mining
+ * \param sink receives the generators
+ * \param update new transactions to mine incrementally, or nullptr to mine everything
+ * \return
+ */
+int mine_dense( const VerticalDatabase & vertical, const Options & options, const std::chrono::high_resolution_clock::time_point & t1, GeneratorSink & sink, const Talky_G::IncrementalUpdate * update )
+{
+    const unsigned int min_sup = options.min_sup;
+    CSetStatistics statistics;
+    std::size_t n_closed = 0;
+    try {
+        {
+            ScopedPhase phase( "mining" );
+            if ( update ) {
+                statistics = Talky_G::talky_g_update< diffset_type, item_type >( vertical, *update, min_sup, options.n_threads, sink, options.sibling_order );
+            }
+            else if ( ! options.closures.empty() ) {
+                std::unique_ptr< GeneratorSink > closed_sink = open_sink( options.closures, options );
+                Talky_G::ClosureWriter closures( vertical.items, *closed_sink, options.closures + ".map", options.write_mode );
+                statistics = Talky_G::talky_g_closures< diffset_type, item_type >( vertical, min_sup, sink, closures, options.sibling_order, options.bounds );
+                closures.close();
+                n_closed = closures.count();
+            }
+            else if ( options.shard.enabled() ) {
+                statistics = Talky_G::talky_g_shard< diffset_type, item_type >( vertical, min_sup, sink, options.sibling_order, options.bounds.max_len, options.shard );
+            }
+            else if ( options.out_of_core.enabled() ) {
+                statistics = Talky_G::talky_g_out_of_core< diffset_type, item_type >( vertical, min_sup, sink, options.sibling_order, options.bounds, options.out_of_core );
+            }
+            else {
+                statistics = ( options.n_threads > 1 ) ? Talky_G::talky_g_parallel< diffset_type, item_type >( vertical, min_sup, options.n_threads, sink, options.sibling_order, options.bounds )
+                                                       : Talky_G::talky_g< diffset_type, item_type >( vertical, min_sup, sink, options.sibling_order, options.checkpoint, options.bounds );
+            }
+        }
+        ScopedPhase phase( "save" );
+        sink.close();
+    }
+    catch ( const std::runtime_error & re ) {
+        std::cerr << re.what() << std::endl;
+        return -1;
+    }
     const auto t2 = std::chrono::high_resolution_clock::now();
     std::cout << "Talky_G Diffset took\n"
               << std::chrono::duration_cast<std::chrono::hours>(t2 - t1).count() << " h\n"
               << std::chrono::duration_cast<std::chrono::minutes>(t2 - t1).count() << " m\n"
               << std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count() << " sec\n"
               << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " msec\n";
-    std::cout << "Number of frequent generators: " << c_set.size() << std::endl;
-    // Save results
-    {
-        std::ofstream c_set_stream;
-        const std::string & result_filename( argv_vector.at( 2 ) );
-        c_set_stream.open( result_filename );
-        if ( c_set_stream.is_open() ) {
-            ResultSaver::save(  c_set_stream, c_set );
-            //            std::cout << "Results was saved" << std::endl;
+    std::cout << "Number of frequent generators: " << sink.count() << std::endl;
+    if ( ! options.closures.empty() ) {
+        std::cout << "Number of frequent closed itemsets: " << n_closed << std::endl;
+    }
+    if ( const SweepSink * sweep_sink = dynamic_cast< const SweepSink * >( &sink ) ) {
+        for ( std::size_t index = 0; index < sweep_sink->size(); ++ index ) {
+            std::cout << "  min_sup " << sweep_sink->min_sup( index ) << ": " << sweep_sink->sink( index ).count() << std::endl;
+        }
+    }
+    if ( options.cset_report ) {
+        std::cout << statistics;
+    }
+    if ( ! options.stats_filename.empty() ) {
+        if ( options.stats_filename == "-" ) {
+            write_statistics( std::cout, sink.count(), SearchCounters::total(), statistics );
         }
         else {
-            std::cerr << "Cannot open file: " << result_filename << std::endl;
-            print_usage();
-            return -1;
+            std::ofstream stats_stream( options.stats_filename );
+            write_statistics( stats_stream, sink.count(), SearchCounters::total(), statistics );
+            if ( ! stats_stream ) {
+                std::cerr << "Cannot write statistics: " << options.stats_filename << std::endl;
+                return -1;
+            }
         }
     }
     return 0;
@@ -97,5 +453,17 @@ int main( int argc, const char * argv[] )
  */
 void print_usage()
 {
-    std::cerr << "Usage: min_sup input.dat output.res" << std::endl;
+    std::cerr << "Usage: [--threads N] [--diffset auto|vector|bitmap] [--cset-report] [--format text|binary] [--write buffered|direct|mmap] [--db-cache file] [--order support|diffset|frequency] [--stats file|-]\n"
+              << "       [--min-len N] [--max-len N] [--top-k K]\n"
+              << "       [--checkpoint file [--checkpoint-interval seconds] [--resume]] min_sup input.dat output.res\n"
+              << "       [options] --sweep s1,s2,... input.dat output.res (writes output.res.s1, output.res.s2, ...)\n"
+              << "       [options] --state prefix [--append] min_sup input.dat output.res (with --append, input.dat holds the new transactions)\n"
+              << "       [options] --out-of-core dir [--memory-budget MB] min_sup input.dat output.res (mines from dir/vertical.vdb, serially)\n"
+              << "       [options] --closures closed.res min_sup input.dat output.res (closed.res.map: the index in closed.res of the closure of every generator)\n"
+              << "       [options] --shard i/N min_sup input.dat shard_i.res (mines every N-th root class, serially)\n"
+              << "       [--format text|binary] [--write buffered|direct|mmap] [--min-len N] --merge output.res shard_0.res ... shard_N-1.res\n"
+              << "       [--threads N] [--diffset auto|vector|bitmap] [--order ...] [--min-len N] [--max-len N] [--top-k K] --serve [--socket path] [--cache N] input.dat ...\n"
+              << "         (queries, one per line: mine input.dat min_sup [--min-len N] [--max-len N] [--top-k K] [--order ...], databases, quit;\n"
+              << "          standard input is answered one query at a time, the clients of --socket concurrently on N threads)\n"
+              << "       --to-text [--write buffered|direct|mmap] input.bin output.res" << std::endl;
 }